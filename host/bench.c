@@ -0,0 +1,223 @@
+// Host benchmark runner for scan_all_paths().
+//
+//   bench [-r WARM_RUNS] [-k] [-b] [-s] [-v] [-l off|info|trace] [-a DIR] [-i N]
+//
+// Runs one cold pass (empty index, nothing registered), WARM_RUNS warm
+// passes over the same library and, with -b, a "reboot" pass (index kept,
+// title cache and mounts gone, known titles restored from mount.lnk first). Build a library first with genlib, e.g.
+//   genlib -o /data/homebrew -n 500 -d 2 -f 8 -j 200
+// -k keeps the index and /user, /system_ex state from an earlier run,
+// -s scans devices serially on the calling thread. -a copies one more game
+// into DIR (e.g. a folder deep inside a junk tree the directory cache has
+// pruned) after the warm passes and checks that the next pass installs it.
+// -i copies N fresh games into IMPORT_DIR the same way and times the pass
+// that imports them as one batch (SM_HOST_REG_DELAY_MS sets the simulated
+// registration time).
+// -l runs the daemon's logger at that level (debug.log and stdout, so
+// redirect it) to compare scan passes with logging on and off.
+
+#define _XOPEN_SOURCE 700
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <ftw.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include "shadowmount.h"
+#include "scan.h"
+#include "cache.h"
+#include "index.h"
+#include "dircache.h"
+#include "restore.h"
+#include "walk.h"
+#include "log.h"
+#include "stats.h"
+#include "arena.h"
+
+static int remove_entry(const char* path, const struct stat* st, int flag, struct FTW* ftw) {
+    (void)st; (void)flag;
+    if (ftw->level == 0) return 0;
+    remove(path);
+    return 0;
+}
+
+static void clear_dir(const char* path) {
+    nftw(path, remove_entry, 32, FTW_DEPTH | FTW_PHYS);
+}
+
+#define DEEP_TITLE_ID "DEEP00001"
+#define IMPORT_DIR    "/data/homebrew/bench_import"
+
+static bool write_text(const char* path, const char* text) {
+    FILE* f = fopen(path, "w");
+    if (!f) return false;
+    fputs(text, f);
+    return fclose(f) == 0;
+}
+
+// A settled game (old mtimes) added below dir; dir itself changes mtime
+static bool add_game(const char* dir, const char* folder, const char* title_id, const char* title_name) {
+    char game[MAX_PATH], path[sizeof(game) + sizeof("/sce_sys/param.json")];
+    char param[512];
+    snprintf(game, sizeof(game), "%s/%s", dir, folder);
+    snprintf(path, sizeof(path), "%s/sce_sys", game);
+    if (mkdir(game, 0777) != 0 || mkdir(path, 0777) != 0) return false;
+    snprintf(path, sizeof(path), "%s/sce_sys/param.json", game);
+    snprintf(param, sizeof(param), "{\n  \"applicationDrmType\": \"standard\",\n"
+             "  \"localizedParameters\": { \"defaultLanguage\": \"en-US\", "
+             "\"en-US\": { \"titleName\": \"%s\" } },\n"
+             "  \"titleId\": \"%s\"\n}\n", title_name, title_id);
+    if (!write_text(path, param)) return false;
+    struct timeval old[2] = { { time(NULL) - 3600, 0 }, { time(NULL) - 3600, 0 } };
+    utimes(path, old);
+    snprintf(path, sizeof(path), "%s/sce_sys", game);
+    utimes(path, old);
+    utimes(game, old);
+    return true;
+}
+
+static long peak_rss_kb(void) {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_maxrss;
+}
+
+static void run_pass(const char* label) {
+    g_installed_count = 0;
+    g_mounted_count = 0;
+    unsigned long long params = stats_get(STAT_PARAM_READS);
+    unsigned long long regs = stats_get(STAT_REGISTRATIONS) + stats_get(STAT_REGISTRATION_FAILURES);
+
+    long long t0 = monotonic_us();
+    scan_all_paths();
+    long long us = monotonic_us() - t0;
+
+    struct WalkStats ws;
+    walk_get_stats(&ws);
+    int hits, misses, pruned, listed;
+    index_get_pass_stats(&hits, &misses);
+    dircache_get_pass_stats(&pruned, &listed);
+    printf("%-7s %9.2fms  open %6lu  dirread %6lu  stat %6lu  param %5llu  index %5d/%-5d  cached %5d/%-5d  "
+           "installed %4d  mounted %4d  reg %4llu  peak %6ld KB  stack %3zu KB\n",
+           label, us / 1000.0, ws.opens, ws.reads, ws.stats,
+           stats_get(STAT_PARAM_READS) - params, hits, hits + misses, pruned, pruned + listed,
+           g_installed_count, g_mounted_count,
+           stats_get(STAT_REGISTRATIONS) + stats_get(STAT_REGISTRATION_FAILURES) - regs, peak_rss_kb(),
+           scan_get_stack_peak() / 1024);
+}
+
+// N fresh games in a new folder, then one pass imports them all
+static int import_batch(int n) {
+    if (mkdir(IMPORT_DIR, 0777) != 0) {
+        perror(IMPORT_DIR);
+        return 1;
+    }
+    char folder[32], title_id[MAX_TITLE_ID], title_name[32];
+    for (int i = 0; i < n; i++) {
+        snprintf(folder, sizeof(folder), "Import_%03d", i);
+        snprintf(title_id, sizeof(title_id), "IMPT%05d", i);
+        snprintf(title_name, sizeof(title_name), "Import %d", i);
+        if (!add_game(IMPORT_DIR, folder, title_id, title_name)) {
+            perror(folder);
+            return 1;
+        }
+    }
+    unsigned long long regs = stats_get(STAT_REGISTRATIONS);
+    long long t0 = monotonic_us();
+    run_pass("import");
+    long long us = monotonic_us() - t0;
+    int found = 0;
+    for (int i = 0; i < n; i++) {
+        snprintf(title_id, sizeof(title_id), "IMPT%05d", i);
+        if (is_installed(title_id)) found++;
+    }
+    printf("import %d title(s) in %.2fms (%.2fms per title), %d installed, %llu registered\n",
+           n, us / 1000.0, n > 0 ? us / 1000.0 / n : 0.0, found, stats_get(STAT_REGISTRATIONS) - regs);
+    return found == n ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    int warm_runs = 3, import_count = 0;
+    bool keep = false, reboot = false, serial = false, verbose = false;
+    const char* deep_dir = NULL;
+    const char* log_level = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "r:kbsva:l:i:")) != -1) {
+        switch (opt) {
+            case 'r': warm_runs = atoi(optarg); break;
+            case 'k': keep = true; break;
+            case 'b': reboot = true; break;
+            case 's': serial = true; break;
+            case 'v': verbose = true; break;
+            case 'a': deep_dir = optarg; break;
+            case 'l': log_level = optarg; break;
+            case 'i': import_count = atoi(optarg); break;
+            default:
+                fprintf(stderr, "usage: bench [-r WARM_RUNS] [-k] [-b] [-s] [-v] [-l off|info|trace] [-a DIR] [-i N]\n");
+                return 2;
+        }
+    }
+
+    mkdir(LOG_DIR, 0777);
+    if (log_level) {
+        enum log_level lvl = strcmp(log_level, "trace") == 0 ? LOG_LEVEL_TRACE :
+                             strcmp(log_level, "info") == 0 ? LOG_LEVEL_INFO : LOG_LEVEL_OFF;
+        log_init(LOG_FILE);
+        log_set_level(lvl);     // After log_init(), which applies LOG_LEVEL_FILE
+    } else {
+        log_set_level(verbose ? LOG_LEVEL_INFO : LOG_LEVEL_OFF);
+    }
+    mkdir("/user", 0777);
+    mkdir("/user/app", 0777);
+    mkdir("/user/appmeta", 0777);
+    mkdir("/system_ex", 0777);
+    mkdir("/system_ex/app", 0777);
+    // Left over from an earlier -i run: its games must not be in the cold pass
+    clear_dir(IMPORT_DIR);
+    rmdir(IMPORT_DIR);
+    if (!keep) {
+        unlink(INDEX_FILE);
+        unlink(DIRCACHE_FILE);
+        clear_dir("/user/app");
+        clear_dir("/user/appmeta");
+        clear_dir("/system_ex/app");
+    }
+    index_load(INDEX_FILE);
+    dircache_load(DIRCACHE_FILE);
+    scan_set_deterministic(serial);
+
+    run_pass(keep ? "resume" : "cold");
+    for (int i = 0; i < warm_runs; i++) run_pass("warm");
+
+    int status = 0;
+    if (deep_dir) {
+        if (!add_game(deep_dir, "Deep_Game", DEEP_TITLE_ID, "Deep Game")) {
+            perror(deep_dir);
+            return 1;
+        }
+        run_pass("deep");
+        bool found = is_installed(DEEP_TITLE_ID);
+        printf("deep game %s under %s: %s\n", DEEP_TITLE_ID, deep_dir, found ? "found" : "MISSED");
+        if (!found) status = 1;
+    }
+
+    if (import_count > 0 && import_batch(import_count) != 0) status = 1;
+
+    if (reboot) {
+        // Mounts and the session cache do not survive a reboot; the index does
+        title_cache_clear();
+        clear_dir("/system_ex/app");
+        long long t0 = monotonic_us();
+        int restored = restore_known_mounts();
+        printf("restore %9.2fms  %d title(s) remounted from mount.lnk\n", (monotonic_us() - t0) / 1000.0, restored);
+        run_pass("reboot");
+    }
+
+    log_shutdown();
+    printf("peak RSS %ld KB, interned %zu KB\n", peak_rss_kb(), intern_memory() / 1024);
+    return status;
+}
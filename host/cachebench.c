@@ -0,0 +1,126 @@
+// Title cache microbenchmark.
+//
+//   cachebench [-r ROUNDS] [-o DIR] [SIZE...]
+//
+// For each library size (default 100, 1000 and 10000 titles) times, per
+// operation: title_cache_claim() of new titles, title_id lookups (hits and
+// misses), game folder lookups, title_cache_remove_tree() of a tenth of the
+// game folders (a deleted game) and of DIR itself with the rest below it (a
+// folder of games renamed away). Game folders are named under DIR, default
+// /tmp/cachebench; nothing is created on disk. Each figure is the best of
+// ROUNDS.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "shadowmount.h"
+#include "cache.h"
+#include "log.h"
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static void folder_of(char* out, size_t size, const char* dir, int i) {
+    snprintf(out, size, "%s/Game%05d", dir, i);
+}
+
+static void title_of(char* out, size_t size, int i) {
+    snprintf(out, size, "CUSA%05d", i);
+}
+
+struct Result {
+    double claim, hit, miss, find, remove, tree;
+};
+
+static void min_into(double* best, double v) {
+    if (*best == 0 || v < *best) *best = v;
+}
+
+static void run_round(int n, const char* dir, struct Result* r) {
+    char path[MAX_PATH], id[MAX_TITLE_ID], name[MAX_TITLE_NAME];
+    title_cache_clear();
+
+    double t0 = now_ns();
+    for (int i = 0; i < n; i++) {
+        folder_of(path, sizeof(path), dir, i);
+        title_of(id, sizeof(id), i);
+        snprintf(name, sizeof(name), "Game %d", i);
+        title_cache_claim(path, id, name);
+    }
+    min_into(&r->claim, (now_ns() - t0) / n);
+
+    int found = 0;
+    t0 = now_ns();
+    for (int i = 0; i < n; i++) {
+        title_of(id, sizeof(id), i);
+        found += title_cache_contains(id);
+    }
+    min_into(&r->hit, (now_ns() - t0) / n);
+
+    t0 = now_ns();
+    for (int i = 0; i < n; i++) {
+        title_of(id, sizeof(id), n + i);
+        found += title_cache_contains(id);
+    }
+    min_into(&r->miss, (now_ns() - t0) / n);
+
+    t0 = now_ns();
+    for (int i = 0; i < n; i++) {
+        folder_of(path, sizeof(path), dir, i);
+        found += title_cache_find_path(path, id, name);
+    }
+    min_into(&r->find, (now_ns() - t0) / n);
+    if (found != 2 * n) fprintf(stderr, "cachebench: %d of %d lookups found\n", found, 2 * n);
+
+    int gone = 0;
+    t0 = now_ns();
+    for (int i = 0; i < n; i += 10) {
+        folder_of(path, sizeof(path), dir, i);
+        gone += title_cache_remove_tree(path);
+    }
+    min_into(&r->remove, (now_ns() - t0) / ((n + 9) / 10));
+    int left = (int)title_cache_count();
+
+    t0 = now_ns();
+    int below = title_cache_remove_tree(dir);
+    min_into(&r->tree, now_ns() - t0);
+    if (gone != (n + 9) / 10 || left != n - gone || below != left || title_cache_count() != 0) {
+        fprintf(stderr, "cachebench: removed %d, then %d of %d below %s\n", gone, below, left, dir);
+    }
+}
+
+int main(int argc, char** argv) {
+    int rounds = 5;
+    const char* dir = "/tmp/cachebench";
+    int opt;
+    while ((opt = getopt(argc, argv, "r:o:")) != -1) {
+        switch (opt) {
+        case 'r': rounds = atoi(optarg); break;
+        case 'o': dir = optarg; break;
+        default:
+            fprintf(stderr, "usage: cachebench [-r ROUNDS] [-o DIR] [SIZE...]\n");
+            return 2;
+        }
+    }
+    static const int default_sizes[] = { 100, 1000, 10000 };
+    log_set_level(LOG_LEVEL_OFF);
+
+    printf("%8s %10s %10s %10s %10s %12s %12s\n",
+           "titles", "claim", "hit", "miss", "by path", "remove", "remove tree");
+    int count = optind < argc ? argc - optind : (int)(sizeof(default_sizes) / sizeof(default_sizes[0]));
+    for (int s = 0; s < count; s++) {
+        int n = optind < argc ? atoi(argv[optind + s]) : default_sizes[s];
+        if (n <= 0) continue;
+        struct Result r = {0};
+        for (int i = 0; i < rounds; i++) run_round(n, dir, &r);
+        printf("%8d %8.0fns %8.0fns %8.0fns %8.0fns %10.0fns %10.2fms\n",
+               n, r.claim, r.hit, r.miss, r.find, r.remove, r.tree / 1e6);
+    }
+    return 0;
+}
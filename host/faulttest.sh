@@ -0,0 +1,143 @@
+#!/bin/sh
+# Install journal crash test for the host build (make -C host fault-test).
+#
+# For every fault point, builds three fresh games on /mnt/usb0, kills the
+# daemon with SM_HOST_FAULT at that step of the first install, starts it
+# again and checks that every install was resumed or rolled back: all
+# titles linked, copied and registered (the one whose source was removed
+# after the crash unmounted, with no partial install left), sce_sys assets
+# identical, an empty journal and no temp files left in /user/app. In the
+# nolnk case every resumed mount.lnk write fails: those installs must be
+# failed, not registered without their tracker.
+#
+# It wipes /data, /user, /system_ex and /mnt/usb0: run it in a container.
+
+cd "$(dirname "$0")" || exit 1
+BIN=${BIN:-./shadowmount-host}
+CASES=${CASES:-"begin mounted copy files tracker register register:2 files:2 copy:gone tracker:gone register:torn files:nolnk"}
+IDS="PPSA00200 PPSA00201 PPSA00202"
+SM=/data/shadowmount
+failed=0
+
+make_game() {
+    mkdir -p "$1/sce_sys/trophy2" "$1/sce_sys/pics"
+    cat > "$1/sce_sys/param.json" <<EOF
+{
+  "applicationCategoryType": 0,
+  "applicationDrmType": "upgradable",
+  "localizedParameters": {
+    "defaultLanguage": "en-US",
+    "en-US": { "titleName": "$3" }
+  },
+  "titleId": "$2"
+}
+EOF
+    echo icon > "$1/sce_sys/icon0.png"
+    head -c 100000 /dev/urandom > "$1/sce_sys/trophy2/trophy00.ucp"
+    head -c 3000000 /dev/urandom > "$1/sce_sys/pics/pic1.png"
+    find "$1" -exec touch -d "1 hour ago" {} +
+}
+
+setup() {
+    rm -rf /data /user /system_ex /mnt/usb0
+    mkdir -p /data/homebrew /user/app /system_ex/app $SM /mnt/usb0/homebrew
+    n=0
+    for id in $IDS; do
+        make_game /mnt/usb0/homebrew/Game$n $id "Game $n"
+        n=$((n + 1))
+    done
+    echo trace > $SM/log_level
+}
+
+# Runs the daemon until it has settled, then stops it through the STOP file
+run_settled() {
+    "$BIN" >/dev/null 2>&1 &
+    pid=$!
+    sleep 3
+    touch $SM/STOP
+    wait $pid
+}
+
+fail() {
+    echo "  FAIL: $*"
+    ok=0
+}
+
+for spec in $CASES; do
+    point=${spec%%:*}
+    rest=${spec#"$point"}
+    rest=${rest#:}
+    hit=1
+    mode=
+    case "$rest" in
+        gone|torn|nolnk) mode=$rest ;;
+        "") ;;
+        *) hit=$rest ;;
+    esac
+    echo "== $point (hit $hit)${mode:+, $mode}"
+    ok=1
+    setup
+
+    SM_HOST_FAULT=$point:$hit timeout 20 "$BIN" >/dev/null 2>/tmp/faulttest.err
+    status=$?
+    [ $status -eq 99 ] || fail "crash run exited with $status, not at the fault"
+    [ -s $SM/install.journal ] || fail "no journal left by the crash"
+
+    expect=$IDS
+    case "$mode" in
+        gone)
+            rm -rf /mnt/usb0/homebrew/Game1
+            expect="PPSA00200 PPSA00202"
+            ;;
+        torn)
+            truncate -s -3 $SM/install.journal
+            ;;
+        nolnk)
+            # A directory in the way of the temp file fails the write
+            for id in $IDS; do mkdir -p /user/app/$id/mount.lnk.tmp; done
+            expect=
+            ;;
+    esac
+    mv $SM/debug.log $SM/debug.crash.log 2>/dev/null
+    run_settled
+
+    grep -q "\[JOURNAL\] Recovery:" $SM/debug.log || fail "no journal recovery on restart"
+    for id in $IDS; do
+        case " $expect " in
+            *" $id "*)
+                [ -L /system_ex/app/$id ] || fail "$id not linked"
+                [ -d /user/appmeta/$id ] || fail "$id not registered"
+                [ -f /user/app/$id/sce_sys/param.json ] || fail "$id param.json not copied"
+                n=${id#PPSA0020}
+                cmp -s /mnt/usb0/homebrew/Game$n/sce_sys/pics/pic1.png /user/app/$id/sce_sys/pics/pic1.png ||
+                    fail "$id assets differ from the source"
+                ;;
+            *)
+                if [ "$mode" = nolnk ]; then
+                    grep -q "$id: mount.lnk not written" $SM/debug.log || fail "$id tracker write did not fail"
+                    [ -e /user/app/$id/mount.lnk ] && fail "$id tracker written"
+                    [ -d /user/appmeta/$id ] && fail "$id registered without a tracker"
+                    continue
+                fi
+                # The empty mount point stays, as after any unmount. A title
+                # that got past the tracker stays installed, drive away.
+                [ -L /system_ex/app/$id ] && fail "$id still mounted after rollback"
+                [ -e /user/app/$id ] && [ ! -d /user/appmeta/$id ] &&
+                    fail "$id partial install left after rollback"
+                ;;
+        esac
+    done
+    [ -s $SM/install.journal ] && fail "journal not empty after recovery"
+    temps=$(find /user/app -name '*.smtmp' | wc -l)
+    [ "$temps" -eq 0 ] || fail "$temps temp file(s) left in /user/app"
+
+    if [ $ok -eq 1 ]; then
+        grep -h "\[JOURNAL\] Recovery:" $SM/debug.log | sed 's/^.*\[JOURNAL\]/  ok:/'
+    else
+        failed=$((failed + 1))
+        grep -h "\[JOURNAL\]" $SM/debug.log | sed 's/^/    /'
+    fi
+done
+
+echo "faulttest: $failed failing case(s)"
+[ $failed -eq 0 ]
@@ -0,0 +1,172 @@
+// Synthetic game library generator for host benchmarks.
+//
+//   genlib -o DIR -n GAMES [-d DEPTH] [-f FANOUT] [-p PARAM_BYTES] [-j JUNK] [-s SEED]
+//
+// Games are spread round-robin over a tree of DEPTH levels with FANOUT
+// folders per level (group_N/...). Each game gets a param.json of roughly
+// PARAM_BYTES (more localized titles), an icon, a trophy file and an empty
+// eboot.bin. JUNK non-game folders (with files and a subfolder) are mixed in.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+static const char* LANGS[] = {
+    "ar-AE", "cs-CZ", "da-DK", "de-DE", "el-GR", "en-GB", "es-419", "es-ES", "fi-FI", "fr-CA",
+    "fr-FR", "hu-HU", "id-ID", "it-IT", "ja-JP", "ko-KR", "nl-NL", "no-NO", "pl-PL", "pt-BR",
+    "pt-PT", "ro-RO", "ru-RU", "sv-SE", "th-TH", "tr-TR", "vi-VN", "zh-Hans", "zh-Hant",
+};
+#define LANG_COUNT ((int)(sizeof(LANGS) / sizeof(LANGS[0])))
+
+static int mkdirs(const char* path) {
+    char tmp[1024];
+    snprintf(tmp, sizeof(tmp), "%s", path);
+    for (char* p = tmp + 1; *p; p++) {
+        if (*p != '/') continue;
+        *p = '\0';
+        if (mkdir(tmp, 0777) < 0 && errno != EEXIST) return -1;
+        *p = '/';
+    }
+    return (mkdir(tmp, 0777) < 0 && errno != EEXIST) ? -1 : 0;
+}
+
+static int write_file(const char* path, const char* data, size_t len) {
+    FILE* f = fopen(path, "wb");
+    if (!f) return -1;
+    size_t n = fwrite(data, 1, len, f);
+    return (fclose(f) == 0 && n == len) ? 0 : -1;
+}
+
+static int write_random(const char* path, size_t len, unsigned* seed) {
+    char buf[4096];
+    FILE* f = fopen(path, "wb");
+    if (!f) return -1;
+    while (len > 0) {
+        size_t n = len < sizeof(buf) ? len : sizeof(buf);
+        for (size_t i = 0; i < n; i++) buf[i] = (char)rand_r(seed);
+        fwrite(buf, 1, n, f);
+        len -= n;
+    }
+    return fclose(f);
+}
+
+// Real-shaped param.json padded with localized titles up to ~target bytes
+static size_t make_param(char* out, size_t size, const char* title_id, int index, size_t target, unsigned* seed) {
+    size_t len = 0;
+    const char* drm = (rand_r(seed) % 2) ? "upgradable" : "standard";
+    len += snprintf(out + len, size - len,
+        "{\n  \"ageLevel\": { \"default\": 12 },\n  \"applicationCategoryType\": 0,\n"
+        "  \"applicationDrmType\": \"%s\",\n  \"attribute\": 0,\n"
+        "  \"contentId\": \"UP0000-%s_00-BENCHMARK0000000\",\n  \"contentVersion\": \"01.000.000\",\n"
+        "  \"localizedParameters\": {\n    \"defaultLanguage\": \"en-US\",\n"
+        "    \"en-US\": { \"titleName\": \"Bench Game %d\" }",
+        drm, title_id, index);
+    for (int l = 0; l < LANG_COUNT && len + 200 < target && len + 200 < size; l++) {
+        len += snprintf(out + len, size - len, ",\n    \"%s\": { \"titleName\": \"Bench Game %d (%s)\" }",
+                        LANGS[l], index, LANGS[l]);
+    }
+    len += snprintf(out + len, size - len,
+        "\n  },\n  \"masterVersion\": \"01.00\",\n  \"titleId\": \"%s\",\n  \"userDefinedParam1\": 0,\n"
+        "  \"versionFileUri\": \"\"", title_id);
+    if (len + 64 < target && target < size) {
+        size_t pad = target - len - 64;
+        len += snprintf(out + len, size - len, ",\n  \"pubtools\": \"");
+        memset(out + len, 'x', pad);
+        len += pad;
+        len += snprintf(out + len, size - len, "\"");
+    }
+    len += snprintf(out + len, size - len, "\n}\n");
+    return len;
+}
+
+// Path of the index-th item spread over the group tree
+static void group_path(char* out, size_t size, const char* root, int index, int depth, int fanout) {
+    size_t len = (size_t)snprintf(out, size, "%s", root);
+    int n = index;
+    for (int d = 0; d < depth; d++) {
+        len += (size_t)snprintf(out + len, size - len, "/group_%d", n % fanout);
+        n /= fanout;
+    }
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: genlib -o DIR -n GAMES [-d DEPTH] [-f FANOUT] [-p PARAM_BYTES] [-j JUNK] [-s SEED]\n");
+}
+
+int main(int argc, char** argv) {
+    const char* root = NULL;
+    int games = 0, depth = 1, fanout = 8, junk = 0;
+    size_t param_bytes = 3000;
+    unsigned seed = 1;
+    int opt;
+    while ((opt = getopt(argc, argv, "o:n:d:f:p:j:s:")) != -1) {
+        switch (opt) {
+            case 'o': root = optarg; break;
+            case 'n': games = atoi(optarg); break;
+            case 'd': depth = atoi(optarg); break;
+            case 'f': fanout = atoi(optarg); break;
+            case 'p': param_bytes = (size_t)atol(optarg); break;
+            case 'j': junk = atoi(optarg); break;
+            case 's': seed = (unsigned)atoi(optarg); break;
+            default: usage(); return 2;
+        }
+    }
+    if (!root || games < 0 || depth < 0 || fanout < 1) { usage(); return 2; }
+
+    static char param[256 * 1024];
+    if (param_bytes > sizeof(param) - 1024) param_bytes = sizeof(param) - 1024;
+    char dir[1024], path[1200], title_id[16];
+    struct timeval t0, t1;
+    gettimeofday(&t0, NULL);
+
+    for (int i = 0; i < games; i++) {
+        group_path(dir, sizeof(dir), root, i, depth, fanout);
+        snprintf(title_id, sizeof(title_id), "BNCH%05d", i);
+        size_t dl = strlen(dir);
+        snprintf(dir + dl, sizeof(dir) - dl, "/Game_%05d", i);
+
+        snprintf(path, sizeof(path), "%s/sce_sys/trophy2", dir);
+        if (mkdirs(path) != 0) { perror(path); return 1; }
+        snprintf(path, sizeof(path), "%s/sce_sys/param.json", dir);
+        size_t len = make_param(param, sizeof(param), title_id, i, param_bytes, &seed);
+        if (write_file(path, param, len) != 0) { perror(path); return 1; }
+        snprintf(path, sizeof(path), "%s/sce_sys/icon0.png", dir);
+        write_random(path, 16 * 1024, &seed);
+        snprintf(path, sizeof(path), "%s/sce_sys/trophy2/trophy00.ucp", dir);
+        write_random(path, 48 * 1024, &seed);
+        snprintf(path, sizeof(path), "%s/eboot.bin", dir);
+        write_file(path, "", 0);
+
+        // Backdate so the daemon's stability check treats the game as settled
+        struct timeval old[2] = { { t0.tv_sec - 3600, 0 }, { t0.tv_sec - 3600, 0 } };
+        snprintf(path, sizeof(path), "%s/sce_sys", dir);
+        utimes(path, old);
+        utimes(dir, old);
+    }
+
+    for (int i = 0; i < junk; i++) {
+        group_path(dir, sizeof(dir), root, i, depth, fanout);
+        size_t dl = strlen(dir);
+        snprintf(dir + dl, sizeof(dir) - dl, "/junk_%05d/nested", i);
+        if (mkdirs(dir) != 0) { perror(dir); return 1; }
+        for (int f = 0; f < 3; f++) {
+            snprintf(path, sizeof(path), "%s/file_%d.bin", dir, f);
+            write_file(path, "junk", 4);
+        }
+        // Old folders, like a library that has been sitting on the drive
+        struct timeval old[2] = { { t0.tv_sec - 3600, 0 }, { t0.tv_sec - 3600, 0 } };
+        utimes(dir, old);
+        *strrchr(dir, '/') = '\0';
+        utimes(dir, old);
+    }
+
+    gettimeofday(&t1, NULL);
+    printf("genlib: %d game(s), %d junk folder(s) under %s (depth %d, fanout %d, param ~%zu bytes) in %ldms\n",
+           games, junk, root, depth, fanout, param_bytes,
+           (t1.tv_sec - t0.tv_sec) * 1000 + (t1.tv_usec - t0.tv_usec) / 1000);
+    return 0;
+}
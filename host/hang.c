@@ -0,0 +1,96 @@
+// Hung drive simulator, loaded with LD_PRELOAD into shadowmount-host:
+//
+//   SM_HOST_HANG=/mnt/usb1 LD_PRELOAD=host/hang.so host/shadowmount-host
+//
+// While the flag file exists (SM_HOST_HANG_FLAG, default /tmp/sm_hang),
+// stat, open and opendir of anything under SM_HOST_HANG block like calls
+// into a half-detached USB drive; removing the flag lets them finish.
+// Calls relative to a directory fd are resolved through /proc/self/fd.
+// Naming a folder inside a drive (e.g. /mnt/usb1/homebrew/Stuck) lets the
+// health probes of the drive and its roots answer and hangs the scan walk
+// once it gets there; hangtest.sh runs that scenario.
+
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+static int under_hung(int dir_fd, const char* path) {
+    const char* root = getenv("SM_HOST_HANG");
+    if (!root || !*root || !path) return 0;
+    char full[PATH_MAX];
+    if (path[0] != '/' && dir_fd != AT_FDCWD) {
+        char link[64];
+        snprintf(link, sizeof(link), "/proc/self/fd/%d", dir_fd);
+        ssize_t n = readlink(link, full, sizeof(full) - 1);
+        if (n < 0) return 0;
+        full[n] = '\0';
+        if (*path && (size_t)n + 1 + strlen(path) < sizeof(full)) {
+            full[n] = '/';
+            strcpy(full + n + 1, path);
+        }
+        path = full;
+    }
+    size_t len = strlen(root);
+    return strncmp(path, root, len) == 0 && (path[len] == '\0' || path[len] == '/');
+}
+
+static void maybe_hang(int dir_fd, const char* path) {
+    if (!under_hung(dir_fd, path)) return;
+    const char* flag = getenv("SM_HOST_HANG_FLAG");
+    if (!flag) flag = "/tmp/sm_hang";
+    while (access(flag, F_OK) == 0) usleep(100000);
+}
+
+#define REAL(name) static __typeof__(name)* real; if (!real) real = (__typeof__(name)*)dlsym(RTLD_NEXT, #name)
+
+int stat(const char* path, struct stat* st) {
+    REAL(stat);
+    maybe_hang(AT_FDCWD, path);
+    return real(path, st);
+}
+
+int lstat(const char* path, struct stat* st) {
+    REAL(lstat);
+    maybe_hang(AT_FDCWD, path);
+    return real(path, st);
+}
+
+int fstatat(int dir_fd, const char* path, struct stat* st, int flags) {
+    REAL(fstatat);
+    maybe_hang(dir_fd, path);
+    return real(dir_fd, path, st, flags);
+}
+
+int open(const char* path, int flags, ...) {
+    REAL(open);
+    va_list ap;
+    va_start(ap, flags);
+    mode_t mode = (flags & (O_CREAT | O_TMPFILE)) ? va_arg(ap, mode_t) : 0;
+    va_end(ap);
+    maybe_hang(AT_FDCWD, path);
+    return real(path, flags, mode);
+}
+
+int openat(int dir_fd, const char* path, int flags, ...) {
+    REAL(openat);
+    va_list ap;
+    va_start(ap, flags);
+    mode_t mode = (flags & (O_CREAT | O_TMPFILE)) ? va_arg(ap, mode_t) : 0;
+    va_end(ap);
+    maybe_hang(dir_fd, path);
+    return real(dir_fd, path, flags, mode);
+}
+
+DIR* opendir(const char* path) {
+    REAL(opendir);
+    maybe_hang(AT_FDCWD, path);
+    return real(path);
+}
@@ -0,0 +1,69 @@
+#!/bin/sh
+# Hung drive test for the host build (make -C host hang-test).
+#
+# /mnt/usb0 and a tmpfs on /mnt/usb1 each hold a game; /mnt/usb1 also has
+# a folder that hangs every access (hang.so) while the drive itself still
+# answers its health probes. The first pass must install the /mnt/usb0 game
+# without waiting on /mnt/usb1, leave the stalled walk behind and quarantine
+# the drive. Once the folder answers again the late walk must come back and
+# the daemon must stop cleanly.
+#
+# It wipes /data, /user, /system_ex, /mnt/usb0 and /mnt/usb1: run it in a
+# container (the tmpfs mount needs root).
+
+cd "$(dirname "$0")" || exit 1
+BIN=${BIN:-./shadowmount-host}
+SM=/data/shadowmount
+FLAG=/tmp/sm_hang
+failed=0
+
+make_game() {
+    mkdir -p "$1/sce_sys"
+    cat > "$1/sce_sys/param.json" <<JSON
+{
+  "applicationDrmType": "standard",
+  "localizedParameters": { "defaultLanguage": "en-US", "en-US": { "titleName": "$3" } },
+  "titleId": "$2"
+}
+JSON
+    find "$1" -exec touch -d "1 hour ago" {} +
+}
+
+fail() {
+    echo "  FAIL: $*"
+    failed=$((failed + 1))
+}
+
+expect_log() {
+    grep -q "$1" $SM/debug.log || fail "no '$1' in debug.log"
+}
+
+umount /mnt/usb1 2>/dev/null
+rm -rf /data /user /system_ex /mnt/usb0 /mnt/usb1
+mkdir -p /data/homebrew /user/app /system_ex/app $SM /mnt/usb0/homebrew /mnt/usb1
+mount -t tmpfs none /mnt/usb1 || { echo "hangtest: cannot mount a tmpfs on /mnt/usb1"; exit 1; }
+mkdir -p /mnt/usb1/homebrew/Stuck/Inner
+make_game /mnt/usb0/homebrew/Game0 PPSA00200 "Game 0"
+make_game /mnt/usb1/homebrew/Game1 PPSA00201 "Game 1"
+echo debug > $SM/log_level
+
+echo "== walk hangs on /mnt/usb1"
+touch $FLAG
+SM_HOST_HANG=/mnt/usb1/homebrew/Stuck SM_HOST_HANG_FLAG=$FLAG LD_PRELOAD=./hang.so "$BIN" >/dev/null 2>&1 &
+pid=$!
+sleep 4
+[ -L /system_ex/app/PPSA00200 ] || fail "PPSA00200 not mounted while /mnt/usb1 hangs"
+expect_log "walk of /mnt/usb1/homebrew stalled"
+expect_log "/mnt/usb1 quarantined"
+expect_log "Pass done"
+
+echo "== folder answers again"
+rm -f $FLAG
+sleep 1
+expect_log "Late walk of /mnt/usb1/homebrew returned"
+touch $SM/STOP
+wait $pid || fail "daemon exited with $?"
+
+umount /mnt/usb1
+echo "hangtest: $failed failing check(s)"
+[ $failed -eq 0 ]
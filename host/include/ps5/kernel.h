@@ -0,0 +1,41 @@
+#ifndef HOST_PS5_KERNEL_H
+#define HOST_PS5_KERNEL_H
+
+// --- HOST BUILD ---
+// Stand-ins for the payload SDK kernel header so the daemon can be built and
+// exercised on Linux. Implemented in host/stubs.c.
+
+#include <stdint.h>
+#include <sys/uio.h>
+
+#ifndef MNT_RDONLY
+#define MNT_RDONLY  0x00000001
+#endif
+#ifndef MNT_FORCE
+#define MNT_FORCE   0x00080000
+#endif
+#ifndef MNT_UPDATE
+#define MNT_UPDATE  0x00010000
+#endif
+
+#define MNT_NOWAIT  2
+#define MFSNAMELEN  16
+#define MNAMELEN    1024
+
+// The FreeBSD struct statfs fields the daemon reads
+struct statfs {
+    char f_fstypename[MFSNAMELEN];
+    char f_mntfromname[MNAMELEN];
+    char f_mntonname[MNAMELEN];
+};
+
+int nmount(struct iovec* iov, unsigned int niov, int flags);
+int unmount(const char* dir, int flags);
+int kernel_set_ucred_authid(int pid, uint64_t authid);
+int getfsstat(struct statfs* buf, long bufsize, int mode);
+
+// Fake layer counters
+int host_remount_count(void);
+int host_mount_count(void);
+
+#endif
@@ -0,0 +1,141 @@
+// param.json corpus benchmark.
+//
+//   parambench [-n FILES] [-r ROUNDS] [-o DIR]
+//
+// Writes FILES real-shaped param.json files (paramgen.h) to DIR, default
+// /tmp/parambench, then times param_parse() over the corpus in memory, the
+// first param_read_at() pass (which patches every non-standard
+// applicationDrmType on disk) and ROUNDS steady-state read passes.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "shadowmount.h"
+#include "param.h"
+#include "log.h"
+#include "paramgen.h"
+
+#define BENCH_DOC_MAX (64 * 1024)
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e6 + (double)ts.tv_nsec / 1e3;
+}
+
+static void report(const char* label, double us, int files, size_t bytes) {
+    printf("  %-22s %9.1f ms  %7.2f us/file  %8.1f MB/s\n", label, us / 1e3, us / files,
+           us > 0 ? (double)bytes / us : 0.0);
+}
+
+// One param_read_at() pass over the corpus; returns the number patched
+static int read_pass(int dir_fd, int files, int* failed) {
+    int patched = 0;
+    *failed = 0;
+    for (int i = 0; i < files; i++) {
+        char rel[32], id[MAX_TITLE_ID], name[MAX_TITLE_NAME];
+        snprintf(rel, sizeof(rel), "%05d.json", i);
+        struct stat st;
+        bool drm = false;
+        if (fstatat(dir_fd, rel, &st, 0) != 0 ||
+            !param_read_at(dir_fd, rel, st.st_size, id, name, &drm)) {
+            (*failed)++;
+            continue;
+        }
+        if (drm) patched++;
+    }
+    return patched;
+}
+
+int main(int argc, char** argv) {
+    int files = 5000;
+    int rounds = 5;
+    const char* dir = "/tmp/parambench";
+    int opt;
+    while ((opt = getopt(argc, argv, "n:r:o:")) != -1) {
+        switch (opt) {
+        case 'n': files = atoi(optarg); break;
+        case 'r': rounds = atoi(optarg); break;
+        case 'o': dir = optarg; break;
+        default:
+            fprintf(stderr, "usage: parambench [-n FILES] [-r ROUNDS] [-o DIR]\n");
+            return 2;
+        }
+    }
+    if (files <= 0 || rounds <= 0) return 2;
+    log_set_level(LOG_LEVEL_OFF);
+
+    mkdir(dir, 0755);
+    int dir_fd = open(dir, O_RDONLY | O_DIRECTORY);
+    if (dir_fd < 0) {
+        perror(dir);
+        return 1;
+    }
+
+    // --- CORPUS ---
+    char** docs = calloc((size_t)files, sizeof(char*));
+    size_t* lens = calloc((size_t)files, sizeof(size_t));
+    static char doc[BENCH_DOC_MAX];
+    size_t bytes = 0;
+    for (int i = 0; i < files; i++) {
+        lens[i] = paramgen((unsigned)i, doc, sizeof(doc));
+        docs[i] = malloc(lens[i] ? lens[i] : 1);
+        memcpy(docs[i], doc, lens[i]);
+        bytes += lens[i];
+
+        char rel[32];
+        snprintf(rel, sizeof(rel), "%05d.json", i);
+        int fd = openat(dir_fd, rel, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0 || write(fd, doc, lens[i]) != (ssize_t)lens[i]) {
+            perror(rel);
+            return 1;
+        }
+        close(fd);
+    }
+    printf("parambench: %d file(s), %zu bytes in %s\n", files, bytes, dir);
+
+    // --- PARSE (in memory) ---
+    int parsed = 0;
+    double t0 = now_us();
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < files; i++) {
+            struct ParamFields f;
+            char id[MAX_TITLE_ID], name[MAX_TITLE_NAME];
+            if (!param_parse(docs[i], lens[i], &f)) continue;
+            param_copy(f.title_id, id, sizeof(id));
+            param_pick_name(&f, name, sizeof(name));
+            parsed++;
+        }
+    }
+    double t1 = now_us();
+    report("param_parse", (t1 - t0) / rounds, files, bytes);
+
+    // --- READ (file, first pass patches DRM) ---
+    int failed;
+    t0 = now_us();
+    int patched = read_pass(dir_fd, files, &failed);
+    t1 = now_us();
+    report("param_read_at first", t1 - t0, files, bytes);
+
+    int steady_patched = 0, steady_failed = 0;
+    t0 = now_us();
+    for (int r = 0; r < rounds; r++) {
+        steady_patched += read_pass(dir_fd, files, &failed);
+        steady_failed += failed;
+    }
+    t1 = now_us();
+    report("param_read_at steady", (t1 - t0) / rounds, files, bytes);
+
+    printf("  parsed %d/%d, DRM patched %d on the first pass and %d after, %d read failure(s)\n",
+           parsed / rounds, files, patched, steady_patched, steady_failed);
+    for (int i = 0; i < files; i++) free(docs[i]);
+    free(docs);
+    free(lens);
+    close(dir_fd);
+    return steady_patched == 0 && steady_failed == 0 && parsed == files * rounds ? 0 : 1;
+}
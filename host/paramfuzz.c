@@ -0,0 +1,244 @@
+// Fuzzer for the param.json tokenizer and the in-place DRM patch.
+//
+//   paramfuzz [-n ITERATIONS] [-s SEED] [FILE...]
+//
+// Mutates real-shaped seeds (paramgen.h, plus any FILE given) and checks
+// every input twice: param_parse() on an exactly sized heap copy (spans
+// inside the buffer, names NUL-terminated), then param_read_at() on a temp
+// file, which must agree with it and, when it patched applicationDrmType,
+// leave a file that parses to the same title with "standard", and must fail
+// when the file is shorter than the size it is given. Build it with
+// sanitizers to catch overreads:
+//   make -C host paramfuzz CFLAGS="-O1 -g -fsanitize=address,undefined"
+// With clang, -DPARAMFUZZ_LIBFUZZER -fsanitize=fuzzer gives a libFuzzer
+// target for the same checks instead of the built-in mutator.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "shadowmount.h"
+#include "param.h"
+#include "log.h"
+#include "paramgen.h"
+
+#define FUZZ_MAX_INPUT  (64 * 1024)
+#define FUZZ_MAX_SEEDS  64
+
+static char work_dir[] = "/tmp/paramfuzz.XXXXXX";
+static int work_fd = -1;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { fprintf(stderr, "paramfuzz: check failed at line %d: %s\n", __LINE__, #cond); dump_and_abort(data, len); } \
+} while (0)
+
+static void dump_and_abort(const uint8_t* data, size_t len) {
+    FILE* f = fopen("paramfuzz-crash.json", "wb");
+    if (f) {
+        fwrite(data, 1, len, f);
+        fclose(f);
+        fprintf(stderr, "paramfuzz: input saved to paramfuzz-crash.json\n");
+    }
+    abort();
+}
+
+static bool span_inside(struct ParamSpan s, const char* buf, size_t len) {
+    return !s.p || (s.p >= buf && s.p + s.len <= buf + len);
+}
+
+static bool span_is(struct ParamSpan s, const char* lit) {
+    return s.p && s.len == strlen(lit) && memcmp(s.p, lit, s.len) == 0;
+}
+
+static bool read_file(const char* name, char* buf, size_t size, size_t* len) {
+    int fd = openat(work_fd, name, O_RDONLY);
+    if (fd < 0) return false;
+    ssize_t n;
+    *len = 0;
+    while ((n = read(fd, buf + *len, size - *len)) > 0) *len += (size_t)n;
+    close(fd);
+    return n == 0;
+}
+
+static void check_input(const uint8_t* data, size_t len) {
+    if (len > FUZZ_MAX_INPUT) return;
+
+    // An exact copy, so sanitizers see any read past the end
+    char* buf = (char*)malloc(len ? len : 1);
+    if (!buf) return;
+    memcpy(buf, data, len);
+    struct ParamFields f;
+    bool parsed = param_parse(buf, len, &f);
+    char id[MAX_TITLE_ID], name[MAX_TITLE_NAME], tiny[8];
+    if (parsed) {
+        CHECK(f.title_id.p && f.title_id.len > 0);
+        CHECK(span_inside(f.title_id, buf, len) && span_inside(f.title_name, buf, len));
+        CHECK(span_inside(f.default_lang, buf, len) && span_inside(f.drm_type, buf, len));
+        CHECK(f.lang_count >= 0 && f.lang_count <= PARAM_MAX_LANGS);
+        for (int i = 0; i < f.lang_count; i++) {
+            CHECK(span_inside(f.langs[i], buf, len) && span_inside(f.lang_names[i], buf, len));
+            param_copy(f.lang_names[i], tiny, sizeof(tiny));
+            CHECK(memchr(tiny, '\0', sizeof(tiny)) != NULL);
+        }
+        param_copy(f.title_id, id, sizeof(id));
+        param_pick_name(&f, name, sizeof(name));
+        CHECK(memchr(id, '\0', sizeof(id)) != NULL && memchr(name, '\0', sizeof(name)) != NULL);
+    }
+    bool needs_patch = parsed && f.drm_type.p && !span_is(f.drm_type, "standard");
+    size_t drm_len = needs_patch ? f.drm_type.len : 0;
+    free(buf);
+
+    // Same bytes through the file path, DRM patch included
+    int fd = openat(work_fd, "param.json", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return;
+    bool written = write(fd, data, len) == (ssize_t)len;
+    close(fd);
+    if (!written) return;
+    char file_id[MAX_TITLE_ID], file_name[MAX_TITLE_NAME];
+    bool patched = false;
+    // A file shorter than its stat said (truncated mid-scan) must fail cleanly
+    CHECK(!param_read_at(work_fd, "param.json", (off_t)len + 1, file_id, file_name, &patched) && !patched);
+    bool read_ok = param_read_at(work_fd, "param.json", (off_t)len, file_id, file_name, &patched);
+    CHECK(read_ok == (parsed && len > 0));
+    if (!read_ok) return;
+    CHECK(strcmp(file_id, id) == 0 && strcmp(file_name, name) == 0);
+    CHECK(!patched || needs_patch);
+    if (!patched) return;
+
+    static char after[FUZZ_MAX_INPUT + 16];
+    size_t after_len;
+    CHECK(read_file("param.json", after, sizeof(after), &after_len));
+    // In place keeps the size; a shorter value grows the file to fit "standard"
+    CHECK(after_len == (drm_len >= 8 ? len : len + 8 - drm_len));
+    struct ParamFields g;
+    CHECK(param_parse(after, after_len, &g));
+    CHECK(span_is(g.drm_type, "standard"));
+    param_copy(g.title_id, file_id, sizeof(file_id));
+    CHECK(strcmp(file_id, id) == 0);
+}
+
+static bool setup(void) {
+    if (work_fd >= 0) return true;
+    log_set_level(LOG_LEVEL_OFF);
+    if (!mkdtemp(work_dir)) return false;
+    work_fd = open(work_dir, O_RDONLY | O_DIRECTORY);
+    return work_fd >= 0;
+}
+
+#ifdef PARAMFUZZ_LIBFUZZER
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t len) {
+    if (setup()) check_input(data, len);
+    return 0;
+}
+#else
+
+// --- MUTATOR ---
+static const char* const dictionary[] = {
+    "\"titleId\"", "\"title_id\"", "\"titleName\"", "\"applicationDrmType\"", "\"localizedParameters\"",
+    "\"defaultLanguage\"", "\"en-US\"", "\"upgradable\"", "\"free\"", "\"standard\"", "\"\"",
+    "{", "}", "[", "]", ":", ",", "\"", "\\", "\\u", "\\ud83c\\udfae", "\\udfae", "\\u00", "null", "true", "-1e9",
+};
+
+static uint64_t rng_state;
+
+static uint32_t rnd(uint32_t n) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return n ? (uint32_t)(rng_state % n) : 0;
+}
+
+static size_t mutate(uint8_t* buf, size_t len, size_t cap) {
+    int rounds = 1 + (int)rnd(4);
+    for (int r = 0; r < rounds; r++) {
+        size_t at = len ? rnd((uint32_t)len + 1) : 0;
+        switch (rnd(6)) {
+        case 0:     // Flip a byte
+            if (len) buf[rnd((uint32_t)len)] ^= (uint8_t)(1 + rnd(255));
+            break;
+        case 1: {   // Drop a range
+            size_t n = at < len ? 1 + rnd((uint32_t)(len - at < 64 ? len - at : 64)) : 0;
+            memmove(buf + at, buf + at + n, len - at - n);
+            len -= n;
+            break;
+        }
+        case 2: {   // Insert a token
+            const char* tok = dictionary[rnd(sizeof(dictionary) / sizeof(dictionary[0]))];
+            size_t n = strlen(tok);
+            if (len + n > cap) break;
+            memmove(buf + at + n, buf + at, len - at);
+            memcpy(buf + at, tok, n);
+            len += n;
+            break;
+        }
+        case 3: {   // Duplicate a range (deep nesting, repeated keys)
+            size_t n = at < len ? 1 + rnd((uint32_t)(len - at < 256 ? len - at : 256)) : 0;
+            if (len + n > cap) break;
+            memmove(buf + at + n, buf + at, len - at);
+            len += n;
+            break;
+        }
+        case 4:     // Truncate
+            len = at;
+            break;
+        default:    // Overwrite with a quote or backslash
+            if (len) buf[rnd((uint32_t)len)] = rnd(2) ? '"' : '\\';
+            break;
+        }
+    }
+    return len;
+}
+
+int main(int argc, char** argv) {
+    long iterations = 200000;
+    unsigned seed = 1;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:s:")) != -1) {
+        switch (opt) {
+        case 'n': iterations = atol(optarg); break;
+        case 's': seed = (unsigned)atoi(optarg); break;
+        default:
+            fprintf(stderr, "usage: paramfuzz [-n ITERATIONS] [-s SEED] [FILE...]\n");
+            return 2;
+        }
+    }
+    if (!setup()) {
+        perror("paramfuzz: work dir");
+        return 1;
+    }
+    rng_state = 0x9E3779B97F4A7C15ull ^ seed;
+
+    static uint8_t seeds[FUZZ_MAX_SEEDS][FUZZ_MAX_INPUT];
+    size_t seed_len[FUZZ_MAX_SEEDS];
+    int seed_count = 0;
+    for (int i = optind; i < argc && seed_count < FUZZ_MAX_SEEDS; i++) {
+        FILE* f = fopen(argv[i], "rb");
+        if (!f) continue;
+        seed_len[seed_count] = fread(seeds[seed_count], 1, FUZZ_MAX_INPUT, f);
+        fclose(f);
+        seed_count++;
+    }
+    for (unsigned g = 0; seed_count < FUZZ_MAX_SEEDS; g++) {
+        seed_len[seed_count] = paramgen(g, (char*)seeds[seed_count], FUZZ_MAX_INPUT);
+        if (seed_len[seed_count] > 0) seed_count++;
+    }
+    for (int i = 0; i < seed_count; i++) check_input(seeds[i], seed_len[i]);
+
+    static uint8_t input[FUZZ_MAX_INPUT];
+    for (long it = 0; it < iterations; it++) {
+        int s = (int)rnd((uint32_t)seed_count);
+        memcpy(input, seeds[s], seed_len[s]);
+        size_t len = mutate(input, seed_len[s], sizeof(input));
+        check_input(input, len);
+    }
+    unlinkat(work_fd, "param.json", 0);
+    unlinkat(work_fd, "param.json.tmp", 0);
+    rmdir(work_dir);
+    printf("paramfuzz: %ld mutated input(s) over %d seed(s), no failures\n", iterations, seed_count);
+    return 0;
+}
+#endif
@@ -0,0 +1,84 @@
+// Real-shaped param.json generator shared by paramfuzz and parambench.
+// Each index gives a different shape: compact or pretty-printed, 1 to 30
+// languages, escaped and \u-encoded names, legacy title_id, titleId before
+// or after localizedParameters, and every applicationDrmType seen in dumps.
+
+#ifndef PARAMGEN_H
+#define PARAMGEN_H
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char* const paramgen_langs[] = {
+    "ja-JP", "en-US", "fr-FR", "es-ES", "de-DE", "it-IT", "nl-NL", "pt-PT",
+    "ru-RU", "ko-KR", "zh-Hant", "zh-Hans", "fi-FI", "sv-SE", "da-DK", "no-NO",
+    "pl-PL", "pt-BR", "en-GB", "tr-TR", "es-419", "ar-AE", "fr-CA", "cs-CZ",
+    "hu-HU", "el-GR", "ro-RO", "th-TH", "vi-VN", "id-ID",
+};
+
+static const char* const paramgen_drm[] = { "standard", "upgradable", "free", "trial", "" };
+
+struct ParamGenBuf {
+    char* p;
+    size_t size;
+    size_t len;
+};
+
+static void paramgen_add(struct ParamGenBuf* b, const char* fmt, ...) {
+    if (b->len >= b->size) return;
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(b->p + b->len, b->size - b->len, fmt, ap);
+    va_end(ap);
+    if (n > 0) b->len = b->len + (size_t)n < b->size ? b->len + (size_t)n : b->size;
+}
+
+// Writes the index-th document into out; returns its length (0 if it did
+// not fit). The title id is GENP<index>.
+static size_t paramgen(unsigned index, char* out, size_t size) {
+    struct ParamGenBuf b = { out, size, 0 };
+    unsigned h = index * 2654435761u;
+    bool pretty = (h >> 3) & 1;
+    bool id_first = (h >> 5) & 1;
+    bool legacy_id = index % 17 == 5;
+    int lang_count = 1 + (int)((h >> 8) % 30);
+    const char* nl = pretty ? "\n" : "";
+    const char* in = pretty ? "  " : "";
+    const char* drm = paramgen_drm[(h >> 13) % 5];
+
+    paramgen_add(&b, "{%s", nl);
+    if (id_first) paramgen_add(&b, "%s\"%s\": \"GENP%05u\",%s", in, legacy_id ? "title_id" : "titleId", index, nl);
+    paramgen_add(&b, "%s\"ageLevel\": {\"default\": %u, \"US\": 12},%s", in, h % 18, nl);
+    paramgen_add(&b, "%s\"applicationCategoryType\": 0,%s", in, nl);
+    if (drm[0]) paramgen_add(&b, "%s\"applicationDrmType\": \"%s\",%s", in, drm, nl);
+    paramgen_add(&b, "%s\"attribute\": %u,%s", in, h & 0xffff, nl);
+    paramgen_add(&b, "%s\"conceptId\": \"%u\",%s", in, 10000000 + index, nl);
+    paramgen_add(&b, "%s\"contentId\": \"UP0000-GENP%05u_00-0000000000000000\",%s", in, index, nl);
+    paramgen_add(&b, "%s\"contentVersion\": \"01.000.000\",%s", in, nl);
+    paramgen_add(&b, "%s\"downloadDataSize\": %u,%s", in, 1048576u * (1 + h % 64), nl);
+    paramgen_add(&b, "%s\"kernel\": {\"cpuPageTableSize\": 0, \"flexibleMemorySize\": 0, \"gpuPageTableSize\": 0},%s", in, nl);
+    paramgen_add(&b, "%s\"localizedParameters\": {%s", in, nl);
+    int first = (int)(h % 30);
+    const char* default_lang = paramgen_langs[(first + (int)((h >> 17) % (unsigned)lang_count)) % 30];
+    paramgen_add(&b, "%s%s\"defaultLanguage\": \"%s\",%s", in, in, default_lang, nl);
+    for (int i = 0; i < lang_count; i++) {
+        const char* lang = paramgen_langs[(first + i) % 30];
+        // Escapes and \u sequences show up in real titles
+        const char* flavour = i % 7 == 3 ? " \\\"Deluxe\\\"" : i % 5 == 2 ? " \\u00c9dition \\ud83c\\udfae" : "";
+        paramgen_add(&b, "%s%s\"%s\": {\"titleName\": \"Generated Game %u (%s)%s\"}%s%s", in, in, lang,
+                     index, lang, flavour, i + 1 < lang_count ? "," : "", nl);
+    }
+    paramgen_add(&b, "%s},%s", in, nl);
+    paramgen_add(&b, "%s\"masterVersion\": \"01.00\",%s", in, nl);
+    paramgen_add(&b, "%s\"pubtools\": {\"creationDate\": \"2024-01-01 00:00:00\", \"toolVersion\": \"1.00\"},%s", in, nl);
+    paramgen_add(&b, "%s\"requiredSystemSoftwareVersion\": \"0x0100000000000000\",%s", in, nl);
+    paramgen_add(&b, "%s\"versionFileUri\": \"http://example.invalid/GENP%05u.json\"%s", in, index, id_first ? "" : ",");
+    paramgen_add(&b, "%s", nl);
+    if (!id_first) paramgen_add(&b, "%s\"%s\": \"GENP%05u\"%s", in, legacy_id ? "title_id" : "titleId", index, nl);
+    paramgen_add(&b, "}\n");
+    return b.len < size ? b.len : 0;
+}
+
+#endif
@@ -0,0 +1,90 @@
+// Control socket client (see src/control.h).
+//
+//   smctl [-s SOCKET] status
+//   smctl [-s SOCKET] list-titles
+//   smctl [-s SOCKET] rescan-path /mnt/ext1/etaHEN/games
+//   smctl [-s SOCKET] remount-title PPSA01234
+//   smctl [-s SOCKET] shutdown
+//
+// Prints the reply; exits 1 when the daemon answered ERR or is unreachable.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "control.h"
+
+int main(int argc, char** argv) {
+    const char* sock_path = CONTROL_SOCKET;
+    int opt;
+    while ((opt = getopt(argc, argv, "s:")) != -1) {
+        if (opt == 's') {
+            sock_path = optarg;
+        } else {
+            fprintf(stderr, "usage: smctl [-s SOCKET] COMMAND [ARG]\n");
+            return 2;
+        }
+    }
+    if (optind >= argc) {
+        fprintf(stderr, "usage: smctl [-s SOCKET] COMMAND [ARG]\n");
+        return 2;
+    }
+
+    char line[CONTROL_MAX_LINE];
+    int len = snprintf(line, sizeof(line), "%s%s%s\n", argv[optind],
+                       optind + 1 < argc ? " " : "", optind + 1 < argc ? argv[optind + 1] : "");
+    if (len < 0 || (size_t)len >= sizeof(line)) {
+        fprintf(stderr, "smctl: command too long\n");
+        return 2;
+    }
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", sock_path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        fprintf(stderr, "smctl: cannot connect to %s: %s\n", sock_path, strerror(errno));
+        return 1;
+    }
+    if (write(fd, line, (size_t)len) != len) {
+        fprintf(stderr, "smctl: send failed: %s\n", strerror(errno));
+        close(fd);
+        return 1;
+    }
+    shutdown(fd, SHUT_WR);
+
+    // First line is the status, the rest is data
+    char buf[4096];
+    ssize_t n;
+    int status = -1;
+    size_t first = 0;
+    char head[CONTROL_MAX_LINE];
+    while ((n = read(fd, buf, sizeof(buf))) > 0) {
+        ssize_t i = 0;
+        while (status < 0 && i < n) {
+            char c = buf[i++];
+            if (c != '\n' && first + 1 < sizeof(head)) { head[first++] = c; continue; }
+            if (c != '\n') continue;
+            head[first] = '\0';
+            if (strncmp(head, "OK", 2) == 0) {
+                status = 0;
+                if (head[2] == ' ') printf("%s\n", head + 3);
+            } else {
+                status = 1;
+                fprintf(stderr, "smctl: %s\n", strncmp(head, "ERR ", 4) == 0 ? head + 4 : head);
+            }
+        }
+        if (i < n) fwrite(buf + i, 1, (size_t)(n - i), stdout);
+    }
+    close(fd);
+    if (status < 0) {
+        fprintf(stderr, "smctl: no reply\n");
+        return 1;
+    }
+    return status;
+}
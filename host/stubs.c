@@ -0,0 +1,161 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <ps5/kernel.h>
+
+// --- FAKE KERNEL ---
+// nullfs mounts become symlinks (fspath -> from) so /system_ex/app/<id>
+// resolves into the source folder like the real mount. A MNT_UPDATE nmount
+// is the /system_ex remount and is only counted.
+
+static int remounts = 0;
+static int mounts = 0;
+
+static const char* iov_get(struct iovec* iov, unsigned int niov, const char* key) {
+    for (unsigned int i = 0; i + 1 < niov; i += 2) {
+        if (iov[i].iov_base && strcmp((const char*)iov[i].iov_base, key) == 0) return (const char*)iov[i + 1].iov_base;
+    }
+    return NULL;
+}
+
+int nmount(struct iovec* iov, unsigned int niov, int flags) {
+    if (flags & MNT_UPDATE) {
+        __atomic_fetch_add(&remounts, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+    const char* fstype = iov_get(iov, niov, "fstype");
+    const char* from = iov_get(iov, niov, "from");
+    const char* fspath = iov_get(iov, niov, "fspath");
+    if (!fstype || !from || !fspath || strcmp(fstype, "nullfs") != 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    struct stat st;
+    if (lstat(fspath, &st) != 0) return -1;
+    if (!S_ISDIR(st.st_mode)) {
+        errno = EBUSY;
+        return -1;
+    }
+    if (rmdir(fspath) != 0) return -1;
+    if (symlink(from, fspath) != 0) return -1;
+    __atomic_fetch_add(&mounts, 1, __ATOMIC_RELAXED);
+    return 0;
+}
+
+int unmount(const char* dir, int flags) {
+    (void)flags;
+    struct stat st;
+    if (lstat(dir, &st) != 0) return -1;
+    if (!S_ISLNK(st.st_mode)) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (unlink(dir) != 0) return -1;
+    return mkdir(dir, 0777);
+}
+
+// "/" first, then one nullfs entry per symlink under /system_ex/app
+int getfsstat(struct statfs* buf, long bufsize, int mode) {
+    (void)mode;
+    long cap = buf ? bufsize / (long)sizeof(struct statfs) : 0;
+    if (buf && cap < 1) return 0;
+    int n = 1;
+    if (buf) {
+        memset(&buf[0], 0, sizeof(buf[0]));
+        snprintf(buf[0].f_fstypename, MFSNAMELEN, "ufs");
+        snprintf(buf[0].f_mntfromname, MNAMELEN, "/dev/root");
+        snprintf(buf[0].f_mntonname, MNAMELEN, "/");
+    }
+    DIR* d = opendir("/system_ex/app");
+    if (!d) return n;
+    struct dirent* e;
+    while ((e = readdir(d)) != NULL) {
+        if (e->d_type != DT_LNK) continue;
+        if (!buf) { n++; continue; }
+        if (n >= cap) break;
+        char link[MNAMELEN];
+        memset(&buf[n], 0, sizeof(buf[n]));
+        snprintf(link, sizeof(link), "/system_ex/app/%s", e->d_name);
+        ssize_t len = readlink(link, buf[n].f_mntfromname, MNAMELEN - 1);
+        if (len < 0) continue;
+        snprintf(buf[n].f_fstypename, MFSNAMELEN, "nullfs");
+        snprintf(buf[n].f_mntonname, MNAMELEN, "%s", link);
+        n++;
+    }
+    closedir(d);
+    return n;
+}
+
+int kernel_set_ucred_authid(int pid, uint64_t authid) {
+    (void)pid; (void)authid;
+    return 0;
+}
+
+int host_remount_count(void) { return __atomic_load_n(&remounts, __ATOMIC_RELAXED); }
+int host_mount_count(void) { return __atomic_load_n(&mounts, __ATOMIC_RELAXED); }
+
+// --- FAKE SCE ---
+// Registration creates /user/appmeta/<id>, optionally after
+// SM_HOST_REG_DELAY_MS to mimic the system registering in the background.
+
+int sceUserServiceInitialize(void* params) { (void)params; return 0; }
+void sceUserServiceTerminate(void) { }
+int sceAppInstUtilInitialize(void) { return 0; }
+
+int sceKernelUsleep(unsigned int microseconds) {
+    return usleep(microseconds);
+}
+
+struct RegJob {
+    char path[1024];
+    unsigned delay_ms;
+};
+
+static void* register_later(void* arg) {
+    struct RegJob* job = (struct RegJob*)arg;
+    usleep(job->delay_ms * 1000);
+    mkdir(job->path, 0777);
+    free(job);
+    return NULL;
+}
+
+int sceAppInstUtilAppInstallTitleDir(const char* title_id, const char* install_path, void* reserved) {
+    (void)reserved;
+    char path[1024];
+    snprintf(path, sizeof(path), "%s%s/sce_sys/param.json", install_path, title_id);
+    if (access(path, F_OK) != 0) return (int)0x80990001;
+
+    mkdir("/user/appmeta", 0777);
+    snprintf(path, sizeof(path), "/user/appmeta/%s", title_id);
+    if (access(path, F_OK) == 0) return (int)0x80990002;
+
+    const char* env = getenv("SM_HOST_REG_DELAY_MS");
+    unsigned delay_ms = env ? (unsigned)atoi(env) : 0;
+    struct RegJob* job = delay_ms ? (struct RegJob*)malloc(sizeof(struct RegJob)) : NULL;
+    pthread_t t;
+    if (job) {
+        snprintf(job->path, sizeof(job->path), "%s", path);
+        job->delay_ms = delay_ms;
+        if (pthread_create(&t, NULL, register_later, job) == 0) {
+            pthread_detach(t);
+            return 0;
+        }
+        free(job);
+    }
+    mkdir(path, 0777);
+    return 0;
+}
+
+typedef struct notify_request { char unused[45]; char message[3075]; } notify_request_t;
+
+int sceKernelSendNotificationRequest(int device, notify_request_t* req, size_t size, int blocking) {
+    (void)device; (void)size; (void)blocking;
+    printf("[HOST] Notification: %s\n", req->message);
+    return 0;
+}
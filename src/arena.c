@@ -0,0 +1,225 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "shadowmount.h"
+#include "arena.h"
+#include "util.h"
+
+#define INTERN_MIN_SLOTS    256
+
+// --- ARENA ---
+// Chunked bump allocator behind the interned strings; they are never freed.
+#define ARENA_CHUNK_SIZE    (64 * 1024)
+
+struct ArenaChunk {
+    struct ArenaChunk* next;
+    size_t used;
+    size_t size;
+    char data[];
+};
+
+struct Arena {
+    struct ArenaChunk* head;
+    size_t used;        // Bytes handed out
+    size_t reserved;    // Bytes in chunks
+};
+
+// 8-byte aligned, NULL when out of memory
+static void* arena_alloc(struct Arena* a, size_t size) {
+    size = (size + 7) & ~(size_t)7;
+    if (!a->head || a->head->size - a->head->used < size) {
+        size_t chunk = size > ARENA_CHUNK_SIZE ? size : ARENA_CHUNK_SIZE;
+        struct ArenaChunk* c = (struct ArenaChunk*)malloc(sizeof(struct ArenaChunk) + chunk);
+        if (!c) return NULL;
+        c->next = a->head;
+        c->used = 0;
+        c->size = chunk;
+        a->head = c;
+        a->reserved += chunk;
+    }
+    void* p = a->head->data + a->head->used;
+    a->head->used += size;
+    a->used += size;
+    return p;
+}
+
+// --- INTERNING ---
+// Strings: open addressing on the string hash, slots hold the pointer.
+// Paths: node i (1-based) is (parent node, component); slots hold i.
+struct PathNode {
+    path_id parent;
+    uint32_t hash;
+    const char* name;
+};
+
+static struct Arena intern_arena;
+static const char** str_slots = NULL;
+static uint32_t str_slot_count = 0;
+static uint32_t str_count = 0;
+static struct PathNode* nodes = NULL;
+static uint32_t node_count = 0;
+static uint32_t node_capacity = 0;
+static uint32_t* node_slots = NULL;
+static uint32_t node_slot_count = 0;
+static pthread_mutex_t intern_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static bool grow_strings(void) {
+    uint32_t n = str_slot_count ? str_slot_count * 2 : INTERN_MIN_SLOTS;
+    const char** fresh = (const char**)calloc(n, sizeof(*fresh));
+    if (!fresh) return false;
+    for (uint32_t i = 0; i < str_slot_count; i++) {
+        if (!str_slots[i]) continue;
+        uint32_t s = fnv1a(str_slots[i], strlen(str_slots[i]), FNV1A_SEED) & (n - 1);
+        while (fresh[s]) s = (s + 1) & (n - 1);
+        fresh[s] = str_slots[i];
+    }
+    free(str_slots);
+    str_slots = fresh;
+    str_slot_count = n;
+    return true;
+}
+
+static const char* intern_locked(const char* s, size_t len) {
+    if ((str_count + 1) * 2 > str_slot_count && !grow_strings()) return NULL;
+    uint32_t mask = str_slot_count - 1;
+    uint32_t slot = fnv1a(s, len, FNV1A_SEED) & mask;
+    for (; str_slots[slot]; slot = (slot + 1) & mask) {
+        if (strncmp(str_slots[slot], s, len) == 0 && str_slots[slot][len] == '\0') return str_slots[slot];
+    }
+    char* copy = (char*)arena_alloc(&intern_arena, len + 1);
+    if (!copy) return NULL;
+    memcpy(copy, s, len);
+    copy[len] = '\0';
+    str_slots[slot] = copy;
+    str_count++;
+    return copy;
+}
+
+const char* intern_str(const char* s) {
+    pthread_mutex_lock(&intern_lock);
+    const char* p = intern_locked(s, strlen(s));
+    pthread_mutex_unlock(&intern_lock);
+    return p;
+}
+
+static uint32_t node_hash(path_id parent, const char* name, size_t len) {
+    return fnv1a(name, len, FNV1A_SEED ^ (parent * 0x9E3779B1u));
+}
+
+static bool grow_nodes(void) {
+    uint32_t n = node_slot_count ? node_slot_count * 2 : INTERN_MIN_SLOTS;
+    uint32_t* fresh = (uint32_t*)calloc(n, sizeof(uint32_t));
+    if (!fresh) return false;
+    for (uint32_t i = 0; i < node_count; i++) {
+        uint32_t s = nodes[i].hash & (n - 1);
+        while (fresh[s]) s = (s + 1) & (n - 1);
+        fresh[s] = i + 1;
+    }
+    free(node_slots);
+    node_slots = fresh;
+    node_slot_count = n;
+    return true;
+}
+
+// Child of parent called name[0..len), created when add is set
+static path_id child_locked(path_id parent, const char* name, size_t len, bool add) {
+    uint32_t hash = node_hash(parent, name, len);
+    if (node_slot_count) {
+        uint32_t mask = node_slot_count - 1;
+        for (uint32_t s = hash & mask; node_slots[s]; s = (s + 1) & mask) {
+            const struct PathNode* n = &nodes[node_slots[s] - 1];
+            if (n->hash == hash && n->parent == parent &&
+                strncmp(n->name, name, len) == 0 && n->name[len] == '\0') return node_slots[s];
+        }
+    }
+    if (!add) return 0;
+    if ((node_count + 1) * 2 > node_slot_count && !grow_nodes()) return 0;
+    if (node_count == node_capacity) {
+        uint32_t cap = node_capacity ? node_capacity * 2 : INTERN_MIN_SLOTS;
+        struct PathNode* grown = (struct PathNode*)realloc(nodes, cap * sizeof(*nodes));
+        if (!grown) return 0;
+        nodes = grown;
+        node_capacity = cap;
+    }
+    const char* copy = intern_locked(name, len);
+    if (!copy) return 0;
+    struct PathNode* n = &nodes[node_count++];
+    n->parent = parent;
+    n->hash = hash;
+    n->name = copy;
+    uint32_t mask = node_slot_count - 1;
+    uint32_t s = hash & mask;
+    while (node_slots[s]) s = (s + 1) & mask;
+    node_slots[s] = node_count;
+    return node_count;
+}
+
+static path_id walk_path(const char* path, bool add) {
+    if (path[0] != '/') return 0;
+    pthread_mutex_lock(&intern_lock);
+    path_id id = 0;
+    const char* p = path;
+    while (*p) {
+        while (*p == '/') p++;
+        if (!*p) break;
+        const char* end = strchr(p, '/');
+        size_t len = end ? (size_t)(end - p) : strlen(p);
+        id = child_locked(id, p, len, add);
+        if (!id) break;
+        p += len;
+    }
+    pthread_mutex_unlock(&intern_lock);
+    return id;
+}
+
+path_id path_intern(const char* path) {
+    return walk_path(path, true);
+}
+
+path_id path_find(const char* path) {
+    return walk_path(path, false);
+}
+
+bool path_get(path_id id, char* out, size_t size) {
+    if (size == 0) return false;
+    pthread_mutex_lock(&intern_lock);
+    // Measure first, then fill from the end
+    bool ok = id && id <= node_count;
+    size_t len = 0;
+    for (path_id i = ok ? id : 0; i; i = nodes[i - 1].parent) len += 1 + strlen(nodes[i - 1].name);
+    ok = ok && len < size;
+    if (ok) {
+        out[len] = '\0';
+        size_t pos = len;
+        for (path_id i = id; i; i = nodes[i - 1].parent) {
+            size_t n = strlen(nodes[i - 1].name);
+            pos -= n;
+            memcpy(out + pos, nodes[i - 1].name, n);
+            out[--pos] = '/';
+        }
+    } else {
+        out[0] = '\0';
+    }
+    pthread_mutex_unlock(&intern_lock);
+    return ok;
+}
+
+bool path_is_under(path_id id, path_id ancestor) {
+    if (!ancestor) return false;
+    pthread_mutex_lock(&intern_lock);
+    path_id i = id <= node_count ? id : 0;
+    while (i && i != ancestor) i = nodes[i - 1].parent;
+    pthread_mutex_unlock(&intern_lock);
+    return i != 0;
+}
+
+size_t intern_memory(void) {
+    pthread_mutex_lock(&intern_lock);
+    size_t bytes = intern_arena.reserved + str_slot_count * sizeof(*str_slots) +
+                   node_capacity * sizeof(*nodes) + node_slot_count * sizeof(uint32_t);
+    pthread_mutex_unlock(&intern_lock);
+    return bytes;
+}
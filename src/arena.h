@@ -0,0 +1,26 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// --- INTERNED STRINGS & PATHS ---
+// Process-wide and never freed, so the pointers/ids stay valid forever:
+// title names and ids repeat on every pass, and game folders on the same
+// root share one copy of the root's prefix (a path is stored as its parent
+// path plus one component). Thread-safe.
+
+typedef uint32_t path_id;   // 0 = no path
+
+const char* intern_str(const char* s);
+
+path_id path_intern(const char* path);          // 0 if out of memory or not absolute
+path_id path_find(const char* path);            // Lookup only, 0 when never interned
+bool path_get(path_id id, char* out, size_t size);
+bool path_is_under(path_id id, path_id ancestor);  // True for ancestor itself too
+
+// Bytes held by the interned strings and path nodes
+size_t intern_memory(void);
+
+#endif
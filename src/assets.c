@@ -0,0 +1,250 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "shadowmount.h"
+#include "assets.h"
+#include "copy.h"
+#include "walk.h"
+#include "stats.h"
+#include "install.h"
+#include "verify.h"
+#include "journal.h"
+
+// Read by registration (param.json is mandatory, the rest optional); the
+// root icon0.png is copied by the installer alongside them
+static const char* minimal_files[] = { "param.json", "param.sfo", "icon0.png" };
+
+struct AssetJob {
+    char title_id[MAX_TITLE_ID];
+    long long due_us;
+};
+
+static struct AssetJob* queue = NULL;   // FIFO; only the copier removes jobs
+static int queue_count = 0;
+static int queue_capacity = 0;
+static pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wake_cond;
+static pthread_t copier;
+static bool running = false;
+static bool stopping = false;
+
+static void marker_path(char* out, size_t size, const char* title_id) {
+    snprintf(out, size, "%s/%s", ASSETS_DIR, title_id);
+}
+
+// --- PHASE ONE ---
+int assets_copy_minimal(const char* src_path, const char* title_id, struct CopyReport* report) {
+    char src[MAX_PATH], dst[MAX_PATH];
+    for (size_t i = 0; i < sizeof(minimal_files) / sizeof(minimal_files[0]); i++) {
+        snprintf(src, sizeof(src), "%s/sce_sys/%s", src_path, minimal_files[i]);
+        snprintf(dst, sizeof(dst), "/user/app/%s/sce_sys/%s", title_id, minimal_files[i]);
+        // Copied before the install was cut off
+        if (journal_file_done(title_id, minimal_files[i])) continue;
+        if (i > 0 && access(src, F_OK) != 0) continue;
+        if (copy_file_sync(src, dst, report) == 0) journal_file(title_id, minimal_files[i]);
+        else if (i == 0) return -1;
+    }
+    return 0;
+}
+
+// --- QUEUE ---
+// Caller holds queue_lock
+static int find_job(const char* title_id) {
+    for (int i = 0; i < queue_count; i++) {
+        if (strcmp(queue[i].title_id, title_id) == 0) return i;
+    }
+    return -1;
+}
+
+// Caller holds queue_lock
+static bool enqueue(const char* title_id) {
+    int i = find_job(title_id);
+    if (i >= 0) {
+        queue[i].due_us = 0;
+        return true;
+    }
+    if (queue_count == queue_capacity) {
+        int cap = queue_capacity ? queue_capacity * 2 : 16;
+        struct AssetJob* grown = (struct AssetJob*)realloc(queue, cap * sizeof(*queue));
+        if (!grown) return false;
+        queue = grown;
+        queue_capacity = cap;
+    }
+    struct AssetJob* j = &queue[queue_count++];
+    snprintf(j->title_id, sizeof(j->title_id), "%s", title_id);
+    j->due_us = 0;
+    return true;
+}
+
+void assets_defer(const char* title_id) {
+    char marker[MAX_PATH];
+    marker_path(marker, sizeof(marker), title_id);
+    mkdir(ASSETS_DIR, 0777);
+    int fd = open(marker, O_WRONLY | O_CREAT | O_CLOEXEC, 0666);
+    if (fd >= 0) close(fd);
+
+    pthread_mutex_lock(&queue_lock);
+    bool queued = enqueue(title_id);
+    if (running) pthread_cond_signal(&wake_cond);
+    pthread_mutex_unlock(&queue_lock);
+    // Without a queue slot the marker still brings it back on the next start
+    if (!queued) log_debug("[ASSETS] Out of memory, %s resumes after a restart", title_id);
+}
+
+bool assets_pending(const char* title_id) {
+    pthread_mutex_lock(&queue_lock);
+    bool pending = find_job(title_id) >= 0;
+    pthread_mutex_unlock(&queue_lock);
+    return pending;
+}
+
+// --- PHASE TWO ---
+// Copies the rest of sce_sys from the title's current source. Returns false
+// when the copy should be retried later.
+static bool copy_rest(const char* title_id) {
+    char app_dir[sizeof("/user/app/") + MAX_TITLE_ID];
+    char source[MAX_PATH], src[MAX_PATH], dst[MAX_PATH], marker[MAX_PATH];
+    marker_path(marker, sizeof(marker), title_id);
+    snprintf(app_dir, sizeof(app_dir), "/user/app/%s", title_id);
+    struct stat st;
+    if (stat(app_dir, &st) != 0) {
+        log_debug("[ASSETS] %s no longer installed, dropping", title_id);
+        unlink(marker);
+        return true;
+    }
+    if (!install_read_tracker(title_id, source, sizeof(source))) {
+        log_debug("[ASSETS] %s: no mount.lnk, will retry", title_id);
+        return false;
+    }
+    int len = snprintf(src, sizeof(src), "%s/sce_sys", source);
+    if (len < 0 || (size_t)len >= sizeof(src)) {
+        log_debug("[ASSETS] %s: source path too long, dropping", title_id);
+        unlink(marker);
+        return true;
+    }
+    snprintf(dst, sizeof(dst), "%s/sce_sys", app_dir);
+    if (stat(src, &st) != 0) {
+        log_debug("[ASSETS] %s: source %s unavailable, will retry", title_id, src);
+        return false;
+    }
+
+    // Files copied in phase one (or before a restart) are skipped as up to date
+    struct CopyReport rep = {0};
+    int res = copy_tree(src, dst, &rep);
+    copy_log_report(title_id, &rep);
+    if (res != 0) return false;
+    verify_record(title_id);
+    unlink(marker);
+    stats_add(STAT_ASSETS_DEFERRED, 1);
+    log_debug("[ASSETS] %s: sce_sys complete", title_id);
+    return true;
+}
+
+// --- COPIER ---
+// Caller holds queue_lock
+static void wait_until(long long due_us) {
+    long long now = monotonic_us();
+    if (due_us <= now) return;
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    long long us = due_us - now;
+    deadline.tv_sec += us / 1000000;
+    deadline.tv_nsec += (us % 1000000) * 1000;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    pthread_cond_timedwait(&wake_cond, &queue_lock, &deadline);
+}
+
+static void* copier_main(void* arg) {
+    (void)arg;
+    char title_id[MAX_TITLE_ID];
+    pthread_mutex_lock(&queue_lock);
+    while (!stopping) {
+        // Oldest job that is due; retries wait their turn
+        int next = -1;
+        for (int i = 0; i < queue_count; i++) {
+            if (next < 0 || queue[i].due_us < queue[next].due_us) next = i;
+        }
+        if (next < 0) {
+            pthread_cond_wait(&wake_cond, &queue_lock);
+            continue;
+        }
+        if (queue[next].due_us > monotonic_us()) {
+            wait_until(queue[next].due_us);
+            continue;
+        }
+        snprintf(title_id, sizeof(title_id), "%s", queue[next].title_id);
+        pthread_mutex_unlock(&queue_lock);
+
+        bool done = copy_rest(title_id);
+
+        pthread_mutex_lock(&queue_lock);
+        int i = find_job(title_id);
+        if (i >= 0 && done) {
+            memmove(&queue[i], &queue[i + 1], (size_t)(queue_count - i - 1) * sizeof(*queue));
+            queue_count--;
+        } else if (i >= 0) {
+            queue[i].due_us = monotonic_us() + ASSETS_RETRY_US;
+        }
+        if (!stopping) wait_until(monotonic_us() + ASSETS_GAP_US);
+    }
+    pthread_mutex_unlock(&queue_lock);
+    return NULL;
+}
+
+bool assets_start(void) {
+    if (running) return true;
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&wake_cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    // Copies interrupted by the last shutdown
+    int resumed = 0;
+    struct WalkDir w;
+    if (walk_open(&w, AT_FDCWD, ASSETS_DIR)) {
+        struct WalkEntry e;
+        char app_dir[MAX_PATH];
+        pthread_mutex_lock(&queue_lock);
+        while (walk_next(&w, &e)) {
+            if (e.name[0] == '.' || strlen(e.name) >= MAX_TITLE_ID || find_job(e.name) >= 0) continue;
+            snprintf(app_dir, sizeof(app_dir), "/user/app/%s", e.name);
+            copy_remove_temps(app_dir);
+            if (enqueue(e.name)) resumed++;
+        }
+        pthread_mutex_unlock(&queue_lock);
+        walk_close(&w);
+    }
+    if (resumed > 0) log_debug("[ASSETS] Resuming the asset copy of %d title(s)", resumed);
+
+    __atomic_store_n(&stopping, false, __ATOMIC_RELEASE);
+    if (pthread_create(&copier, NULL, copier_main, NULL) != 0) {
+        pthread_cond_destroy(&wake_cond);
+        return false;
+    }
+    pthread_mutex_lock(&queue_lock);
+    running = true;
+    pthread_mutex_unlock(&queue_lock);
+    return true;
+}
+
+void assets_shutdown(void) {
+    if (!running) return;
+    pthread_mutex_lock(&queue_lock);
+    stopping = true;
+    running = false;
+    pthread_cond_broadcast(&wake_cond);
+    pthread_mutex_unlock(&queue_lock);
+    pthread_join(copier, NULL);
+    pthread_cond_destroy(&wake_cond);
+}
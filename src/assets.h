@@ -0,0 +1,33 @@
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#include <stdbool.h>
+
+#include "copy.h"
+
+// --- DEFERRED ASSETS ---
+// A fresh install copies only the sce_sys files registration reads before
+// registering the title; trophies, pictures, sounds and manuals follow from
+// one background thread. Each deferred title has a marker in ASSETS_DIR so
+// an interrupted copy resumes after a restart, and the integrity verifier
+// leaves it alone until the copy is done and its manifest is recorded.
+
+#define ASSETS_DIR          "/data/shadowmount/assets_pending"
+#define ASSETS_RETRY_US     60000000LL  // Source unavailable: try again later
+#define ASSETS_GAP_US       200000      // Pause between titles
+
+// Copies the registration files of src_path/sce_sys into /user/app/<id>.
+// Returns 0 when param.json is in place, -1 otherwise.
+int assets_copy_minimal(const char* src_path, const char* title_id, struct CopyReport* report);
+
+// Queues the rest of the title's sce_sys for the background copy
+void assets_defer(const char* title_id);
+
+// True while the title's background copy has not finished
+bool assets_pending(const char* title_id);
+
+// Background copier; resumes the copies left over by the last run
+bool assets_start(void);
+void assets_shutdown(void);
+
+#endif
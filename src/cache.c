@@ -0,0 +1,260 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "shadowmount.h"
+#include "cache.h"
+#include "arena.h"
+#include "util.h"
+
+#define CACHE_MIN_SLOTS     64
+#define SLOT_EMPTY          0u
+#define SLOT_TOMBSTONE      UINT32_MAX
+
+// --- TABLES ---
+// Entries are kept dense so iteration only touches live titles; both hash
+// tables store (entry index + 1). Strings and paths are interned, so an
+// entry is a few pointers and a title seen again after an unplug costs
+// nothing new.
+struct CacheEntry {
+    path_id path;
+    const char* title_id;
+    const char* title_name;
+    uint32_t id_hash;
+    uint32_t path_hash;
+};
+
+static struct CacheEntry* entries = NULL;
+static uint32_t entry_count = 0;
+static uint32_t entry_capacity = 0;
+static uint32_t* id_slots = NULL;
+static uint32_t* path_slots = NULL;
+static uint32_t slot_count = 0;      // Power of two, shared by both tables
+static uint32_t tombstones = 0;
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint32_t id_hash_of(const char* title_id) {
+    uint32_t h = str_hash(title_id);
+    return h ? h : 1;
+}
+
+static uint32_t path_hash_of(path_id path) {
+    uint32_t h = path * 0x9E3779B1u;
+    return h ? h : 1;
+}
+
+static uint32_t find_slot(const uint32_t* slots, uint32_t hash, const char* title_id, path_id path) {
+    if (!slot_count) return UINT32_MAX;
+    uint32_t mask = slot_count - 1;
+    for (uint32_t s = hash & mask, i = 0; i < slot_count; s = (s + 1) & mask, i++) {
+        uint32_t v = slots[s];
+        if (v == SLOT_EMPTY) return UINT32_MAX;
+        if (v == SLOT_TOMBSTONE) continue;
+        const struct CacheEntry* ce = &entries[v - 1];
+        if (title_id ? ce->id_hash == hash && strcmp(ce->title_id, title_id) == 0
+                     : ce->path == path) return s;
+    }
+    return UINT32_MAX;
+}
+
+static uint32_t find_id(const char* title_id) {
+    return find_slot(id_slots, id_hash_of(title_id), title_id, 0);
+}
+
+// Paths never interned cannot be cached, so no lookup allocates
+static uint32_t find_path(const char* path) {
+    path_id id = path_find(path);
+    return id ? find_slot(path_slots, path_hash_of(id), NULL, id) : UINT32_MAX;
+}
+
+// Slot currently holding entry idx (it must be present)
+static uint32_t slot_of_entry(const uint32_t* slots, uint32_t hash, uint32_t idx) {
+    uint32_t mask = slot_count - 1;
+    uint32_t s = hash & mask;
+    while (slots[s] != idx + 1) s = (s + 1) & mask;
+    return s;
+}
+
+static void insert_slot(uint32_t* slots, uint32_t hash, uint32_t idx) {
+    uint32_t mask = slot_count - 1;
+    uint32_t s = hash & mask;
+    while (slots[s] != SLOT_EMPTY && slots[s] != SLOT_TOMBSTONE) s = (s + 1) & mask;
+    slots[s] = idx + 1;
+}
+
+static bool rehash(uint32_t min_entries) {
+    uint32_t n = CACHE_MIN_SLOTS;
+    while (n < min_entries * 2) n <<= 1;
+    uint32_t* ids = (uint32_t*)calloc(n, sizeof(uint32_t));
+    uint32_t* paths = (uint32_t*)calloc(n, sizeof(uint32_t));
+    if (!ids || !paths) { free(ids); free(paths); return false; }
+    free(id_slots);
+    free(path_slots);
+    id_slots = ids;
+    path_slots = paths;
+    slot_count = n;
+    tombstones = 0;
+    for (uint32_t i = 0; i < entry_count; i++) {
+        insert_slot(id_slots, entries[i].id_hash, i);
+        insert_slot(path_slots, entries[i].path_hash, i);
+    }
+    return true;
+}
+
+static void remove_entry(uint32_t idx) {
+    struct CacheEntry* ce = &entries[idx];
+    id_slots[slot_of_entry(id_slots, ce->id_hash, idx)] = SLOT_TOMBSTONE;
+    path_slots[slot_of_entry(path_slots, ce->path_hash, idx)] = SLOT_TOMBSTONE;
+    tombstones++;
+
+    // Keep the array dense: move the last entry into the hole
+    uint32_t last = entry_count - 1;
+    if (idx != last) {
+        struct CacheEntry* moved = &entries[last];
+        id_slots[slot_of_entry(id_slots, moved->id_hash, last)] = idx + 1;
+        path_slots[slot_of_entry(path_slots, moved->path_hash, last)] = idx + 1;
+        *ce = *moved;
+    }
+    entry_count--;
+}
+
+// --- PUBLIC API ---
+bool title_cache_claim(const char* path, const char* title_id, const char* title_name) {
+    uint32_t id_hash = id_hash_of(title_id);
+    pthread_mutex_lock(&cache_lock);
+    if (find_id(title_id) != UINT32_MAX) {
+        pthread_mutex_unlock(&cache_lock);
+        return false;
+    }
+
+    // Out of memory: process the title, just don't remember it
+    path_id pid = path_intern(path);
+    const char* id = intern_str(title_id);
+    const char* name = intern_str(title_name);
+    if (!pid || !id || !name) {
+        pthread_mutex_unlock(&cache_lock);
+        return true;
+    }
+
+    // Another title recorded for the same folder (title_id changed) is replaced
+    uint32_t path_hash = path_hash_of(pid);
+    uint32_t ps = find_slot(path_slots, path_hash, NULL, pid);
+    if (ps != UINT32_MAX) remove_entry(path_slots[ps] - 1);
+
+    // Grow at 50% load (tombstones included)
+    if ((entry_count + tombstones + 1) * 2 > slot_count && !rehash(entry_count + 1)) {
+        pthread_mutex_unlock(&cache_lock);
+        return true;
+    }
+    if (entry_count == entry_capacity) {
+        uint32_t cap = entry_capacity ? entry_capacity * 2 : CACHE_MIN_SLOTS;
+        struct CacheEntry* grown = (struct CacheEntry*)realloc(entries, cap * sizeof(*entries));
+        if (!grown) {
+            pthread_mutex_unlock(&cache_lock);
+            return true;
+        }
+        entries = grown;
+        entry_capacity = cap;
+    }
+
+    struct CacheEntry* ce = &entries[entry_count];
+    ce->path = pid;
+    ce->title_id = id;
+    ce->title_name = name;
+    ce->id_hash = id_hash;
+    ce->path_hash = path_hash;
+    insert_slot(id_slots, id_hash, entry_count);
+    insert_slot(path_slots, path_hash, entry_count);
+    entry_count++;
+    pthread_mutex_unlock(&cache_lock);
+    return true;
+}
+
+bool title_cache_contains(const char* title_id) {
+    pthread_mutex_lock(&cache_lock);
+    bool found = find_id(title_id) != UINT32_MAX;
+    pthread_mutex_unlock(&cache_lock);
+    return found;
+}
+
+bool title_cache_remove(const char* title_id) {
+    pthread_mutex_lock(&cache_lock);
+    uint32_t s = find_id(title_id);
+    if (s != UINT32_MAX) remove_entry(id_slots[s] - 1);
+    pthread_mutex_unlock(&cache_lock);
+    return s != UINT32_MAX;
+}
+
+bool title_cache_remove_path(const char* path) {
+    pthread_mutex_lock(&cache_lock);
+    uint32_t s = find_path(path);
+    if (s != UINT32_MAX) remove_entry(path_slots[s] - 1);
+    pthread_mutex_unlock(&cache_lock);
+    return s != UINT32_MAX;
+}
+
+bool title_cache_find_path(const char* path, char* out_id, char* out_name) {
+    pthread_mutex_lock(&cache_lock);
+    uint32_t s = find_path(path);
+    if (s != UINT32_MAX) {
+        const struct CacheEntry* e = &entries[path_slots[s] - 1];
+        if (out_id) snprintf(out_id, MAX_TITLE_ID, "%s", e->title_id);
+        if (out_name) snprintf(out_name, MAX_TITLE_NAME, "%s", e->title_name);
+    }
+    pthread_mutex_unlock(&cache_lock);
+    return s != UINT32_MAX;
+}
+
+bool title_cache_get_path(const char* title_id, char* out, size_t size) {
+    pthread_mutex_lock(&cache_lock);
+    uint32_t s = find_id(title_id);
+    bool found = s != UINT32_MAX && path_get(entries[id_slots[s] - 1].path, out, size);
+    pthread_mutex_unlock(&cache_lock);
+    return found;
+}
+
+int title_cache_remove_tree(const char* path) {
+    // Paths are interned with their parents: one never seen holds no title
+    path_id root = path_find(path);
+    if (!root) return 0;
+    int removed = 0;
+    pthread_mutex_lock(&cache_lock);
+    uint32_t s = find_slot(path_slots, path_hash_of(root), NULL, root);
+    if (s != UINT32_MAX) {
+        // A game folder: games never nest, so nothing else is below it
+        remove_entry(path_slots[s] - 1);
+        removed = 1;
+    } else {
+        for (uint32_t i = 0; i < entry_count; ) {
+            if (path_is_under(entries[i].path, root)) {
+                remove_entry(i); // Last entry moved into i, so re-check i
+                removed++;
+            } else {
+                i++;
+            }
+        }
+    }
+    pthread_mutex_unlock(&cache_lock);
+    if (removed) log_debug("[CACHE] %s gone: %d entr%s removed", path, removed, removed == 1 ? "y" : "ies");
+    return removed;
+}
+
+size_t title_cache_count(void) {
+    pthread_mutex_lock(&cache_lock);
+    size_t n = entry_count;
+    pthread_mutex_unlock(&cache_lock);
+    return n;
+}
+
+void title_cache_clear(void) {
+    pthread_mutex_lock(&cache_lock);
+    entry_count = 0;
+    tombstones = 0;
+    if (slot_count) {
+        memset(id_slots, 0, slot_count * sizeof(uint32_t));
+        memset(path_slots, 0, slot_count * sizeof(uint32_t));
+    }
+    pthread_mutex_unlock(&cache_lock);
+}
@@ -0,0 +1,31 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// --- TITLE CACHE ---
+// Session cache of titles already handled. Entries are found by title_id
+// (open addressing) or by game folder path (secondary index); ids, names
+// and paths are interned (arena.h). All functions are thread-safe.
+
+// Inserts the title unless its title_id is already cached (returns false then)
+bool title_cache_claim(const char* path, const char* title_id, const char* title_name);
+bool title_cache_contains(const char* title_id);
+bool title_cache_remove(const char* title_id);
+bool title_cache_remove_path(const char* path);
+
+// Copies the cached title for a game folder; false if the path is unknown
+bool title_cache_find_path(const char* path, char* out_id, char* out_name);
+
+// Copies the game folder a cached title was claimed from
+bool title_cache_get_path(const char* title_id, char* out, size_t size);
+
+// Drops the entry for a game folder that was deleted, renamed or unplugged,
+// or every entry below a parent folder that was. Never touches the disk.
+int title_cache_remove_tree(const char* path);
+
+size_t title_cache_count(void);
+void title_cache_clear(void);
+
+#endif
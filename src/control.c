@@ -0,0 +1,453 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "shadowmount.h"
+#include "control.h"
+#include "health.h"
+#include "scan.h"
+#include "mounts.h"
+#include "install.h"
+#include "index.h"
+#include "cache.h"
+#include "pending.h"
+#include "dircache.h"
+#include "watcher.h"
+#include "stats.h"
+#include "arena.h"
+
+#ifdef MSG_NOSIGNAL
+#define SEND_FLAGS MSG_NOSIGNAL
+#else
+#define SEND_FLAGS 0
+#endif
+
+#define REPLY_MAX   (2 * MAX_PATH + 128)  // Room for a source path and the argument
+
+static int listen_fd = -1;
+static pthread_t server;
+static bool running = false;
+static bool stopping = false;
+
+// --- MAIN LOOP HANDOFF ---
+// One command at a time: the socket thread serves clients one by one and
+// waits for the main loop to run what it handed over.
+enum control_cmd {
+    CONTROL_NONE,
+    CONTROL_RESCAN,
+    CONTROL_REMOUNT,
+    CONTROL_SHUTDOWN
+};
+
+struct ControlRequest {
+    enum control_cmd cmd;
+    char arg[MAX_PATH];
+    int depth;
+    bool done;
+    char reply[REPLY_MAX];
+};
+
+static struct ControlRequest request;
+static pthread_mutex_t request_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t request_cond = PTHREAD_COND_INITIALIZER;
+
+static void submit(enum control_cmd cmd, const char* arg, int depth, char* out, size_t size) {
+    pthread_mutex_lock(&request_lock);
+    request.cmd = cmd;
+    snprintf(request.arg, sizeof(request.arg), "%s", arg ? arg : "");
+    request.depth = depth;
+    request.done = false;
+    pthread_mutex_unlock(&request_lock);
+    watcher_wake();
+
+    pthread_mutex_lock(&request_lock);
+    while (!request.done && !__atomic_load_n(&stopping, __ATOMIC_ACQUIRE)) {
+        pthread_cond_wait(&request_cond, &request_lock);
+    }
+    if (request.done) snprintf(out, size, "%s", request.reply);
+    else snprintf(out, size, "ERR daemon is shutting down");
+    request.cmd = CONTROL_NONE;
+    pthread_mutex_unlock(&request_lock);
+}
+
+static void run_rescan(struct ControlRequest* req, int* installed, int* mounted) {
+    long long t0 = monotonic_us();
+    int i = 0, m = 0;
+    // An explicit rescan lists every folder again instead of trusting the cache
+    dircache_forget_tree(req->arg);
+    mounts_refresh();
+    scan_subtree(req->arg, req->depth);
+    install_flush(&i, &m);
+    *installed += i;
+    *mounted += m;
+    int waiting = pending_count();
+    long long ms = (monotonic_us() - t0) / 1000;
+    log_debug("[CONTROL] Rescanned %s in %lldms: %d installed, %d mounted", req->arg, ms, i, m);
+    if (waiting > 0) {
+        snprintf(req->reply, sizeof(req->reply), "OK %d installed, %d mounted, %d copy(ies) still in progress (%lldms)",
+                 i, m, waiting, ms);
+    } else {
+        snprintf(req->reply, sizeof(req->reply), "OK %d installed, %d mounted (%lldms)", i, m, ms);
+    }
+}
+
+static void run_remount(struct ControlRequest* req, int* installed, int* mounted) {
+    const char* wanted = req->arg;
+    char source[MAX_PATH], title_id[MAX_TITLE_ID], title_name[MAX_TITLE_NAME];
+    mounts_refresh();
+    if (!mounts_get_source(wanted, source, sizeof(source)) &&
+        !install_read_tracker(wanted, source, sizeof(source))) {
+        snprintf(req->reply, sizeof(req->reply), "ERR %s is not mounted and has no mount.lnk", wanted);
+        return;
+    }
+    if (!health_ready(source)) {
+        snprintf(req->reply, sizeof(req->reply), "ERR the drive holding %s is not responding", source);
+        return;
+    }
+    if (!get_game_info(source, title_id, title_name) || strcmp(title_id, wanted) != 0) {
+        snprintf(req->reply, sizeof(req->reply), "ERR %s no longer holds %s", source, wanted);
+        return;
+    }
+    int i = 0, m = 0;
+    install_queue(source, title_id, title_name, mounts_is_installed(title_id));
+    install_flush(&i, &m);
+    *installed += i;
+    *mounted += m;
+    if (i + m == 0) {
+        snprintf(req->reply, sizeof(req->reply), "ERR mounting %s failed, see debug.log", wanted);
+        return;
+    }
+    log_debug("[CONTROL] Remounted %s from %s", wanted, source);
+    snprintf(req->reply, sizeof(req->reply), "OK %s remounted from %s", wanted, source);
+}
+
+bool control_poll(int* installed, int* mounted) {
+    pthread_mutex_lock(&request_lock);
+    if (request.cmd == CONTROL_NONE || request.done) {
+        pthread_mutex_unlock(&request_lock);
+        return false;
+    }
+    struct ControlRequest req = request;
+    pthread_mutex_unlock(&request_lock);
+
+    bool stop = false;
+    switch (req.cmd) {
+        case CONTROL_RESCAN:   run_rescan(&req, installed, mounted); break;
+        case CONTROL_REMOUNT:  run_remount(&req, installed, mounted); break;
+        case CONTROL_SHUTDOWN:
+            snprintf(req.reply, sizeof(req.reply), "OK shutting down");
+            stop = true;
+            break;
+        case CONTROL_NONE:     break;
+    }
+
+    pthread_mutex_lock(&request_lock);
+    memcpy(request.reply, req.reply, sizeof(request.reply));
+    request.done = true;
+    pthread_cond_broadcast(&request_cond);
+    pthread_mutex_unlock(&request_lock);
+    return stop;
+}
+
+// --- REPLIES ---
+struct Reply {
+    char* buf;
+    size_t len;
+    size_t cap;
+    bool failed;
+};
+
+static void reply_add(struct Reply* r, const char* fmt, ...) {
+    if (r->failed) return;
+    for (;;) {
+        va_list args;
+        va_start(args, fmt);
+        int n = vsnprintf(r->buf ? r->buf + r->len : NULL, r->buf ? r->cap - r->len : 0, fmt, args);
+        va_end(args);
+        if (n < 0) { r->failed = true; return; }
+        if (r->buf && r->len + (size_t)n < r->cap) { r->len += (size_t)n; return; }
+        size_t cap = r->cap ? r->cap * 2 : 4096;
+        while (cap <= r->len + (size_t)n) cap *= 2;
+        char* grown = (char*)realloc(r->buf, cap);
+        if (!grown) { r->failed = true; return; }
+        r->buf = grown;
+        r->cap = cap;
+    }
+}
+
+struct StateCounts {
+    int mounted;
+    int installed;
+};
+
+static void count_title(const char* title_id, bool mounted, bool installed, path_id source, void* ctx) {
+    struct StateCounts* c = (struct StateCounts*)ctx;
+    (void)title_id;
+    (void)source;
+    if (mounted) c->mounted++;
+    if (installed) c->installed++;
+}
+
+static void do_status(struct Reply* r) {
+    // The snapshot plus everything mounted since, not only the last refresh
+    struct StateCounts c = {0};
+    mounts_foreach(count_title, &c);
+    int snap_mounted, snap_installed, stale;
+    mounts_get_counts(&snap_mounted, &snap_installed, &stale);
+    reply_add(r, "OK running\n");
+    reply_add(r, "mode: %s\n", watcher_active() ? "watching" : "polling");
+    reply_add(r, "mounted: %d\ninstalled: %d\nstale_mounts: %d\n", c.mounted, c.installed, stale);
+    reply_add(r, "copies_pending: %d\n", pending_count());
+    reply_add(r, "titles_handled: %zu\n", title_cache_count());
+    reply_add(r, "passes: %llu full, %llu root, %llu event\n", stats_get(STAT_FULL_PASSES),
+              stats_get(STAT_ROOT_PASSES), stats_get(STAT_EVENT_PASSES));
+    reply_add(r, "mounts: %llu ok, %llu failed\n", stats_get(STAT_MOUNTS), stats_get(STAT_MOUNT_FAILURES));
+    reply_add(r, "interned_kb: %zu\n", intern_memory() / 1024);
+}
+
+// Titles of the mount snapshot, sorted by id; names come from the library index
+struct TitleRow {
+    char title_id[MAX_TITLE_ID];
+    const char* title_name;
+    path_id source;
+    bool mounted;
+    bool installed;
+};
+
+struct TitleRows {
+    struct TitleRow* rows;
+    int count;
+    int cap;
+    bool failed;
+};
+
+static void add_row(const char* title_id, bool mounted, bool installed, path_id source, void* ctx) {
+    struct TitleRows* t = (struct TitleRows*)ctx;
+    if (t->failed) return;
+    if (t->count == t->cap) {
+        int cap = t->cap ? t->cap * 2 : 64;
+        struct TitleRow* grown = (struct TitleRow*)realloc(t->rows, cap * sizeof(*grown));
+        if (!grown) { t->failed = true; return; }
+        t->rows = grown;
+        t->cap = cap;
+    }
+    struct TitleRow* row = &t->rows[t->count++];
+    snprintf(row->title_id, sizeof(row->title_id), "%s", title_id);
+    row->title_name = NULL;
+    row->source = source;
+    row->mounted = mounted;
+    row->installed = installed;
+}
+
+static int row_cmp(const void* a, const void* b) {
+    return strcmp(((const struct TitleRow*)a)->title_id, ((const struct TitleRow*)b)->title_id);
+}
+
+static void name_row(const char* title_id, const char* title_name, void* ctx) {
+    struct TitleRows* t = (struct TitleRows*)ctx;
+    struct TitleRow key;
+    snprintf(key.title_id, sizeof(key.title_id), "%s", title_id);
+    struct TitleRow* row = (struct TitleRow*)bsearch(&key, t->rows, t->count, sizeof(*t->rows), row_cmp);
+    if (row && !row->title_name) row->title_name = title_name;
+}
+
+static void do_list(struct Reply* r) {
+    struct TitleRows t = {0};
+    mounts_foreach(add_row, &t);
+    if (t.failed) {
+        free(t.rows);
+        reply_add(r, "ERR out of memory\n");
+        return;
+    }
+    if (t.count) qsort(t.rows, t.count, sizeof(*t.rows), row_cmp);
+    index_foreach_title(name_row, &t);
+
+    // id, state, name, source (tab separated)
+    reply_add(r, "OK %d title(s)\n", t.count);
+    char source[MAX_PATH];
+    for (int i = 0; i < t.count; i++) {
+        const struct TitleRow* row = &t.rows[i];
+        const char* state = row->mounted ? (row->installed ? "ready" : "mounted") : "unmounted";
+        if (!row->source || !path_get(row->source, source, sizeof(source))) snprintf(source, sizeof(source), "-");
+        reply_add(r, "%s\t%s\t%s\t%s\n", row->title_id, state, row->title_name ? row->title_name : "-", source);
+    }
+    free(t.rows);
+}
+
+// Absolute, no "." or ".." components; trailing slashes are dropped
+static bool clean_path(char* path) {
+    if (path[0] != '/') return false;
+    size_t len = strlen(path);
+    while (len > 1 && path[len - 1] == '/') path[--len] = '\0';
+    for (const char* p = path; p; p = strchr(p + 1, '/')) {
+        if (strncmp(p, "/.", 2) == 0 && (p[2] == '\0' || p[2] == '/' || (p[2] == '.' && (p[3] == '\0' || p[3] == '/')))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool valid_title_id(const char* s) {
+    size_t len = strlen(s);
+    if (len == 0 || len >= MAX_TITLE_ID) return false;
+    for (; *s; s++) {
+        if (!((*s >= 'A' && *s <= 'Z') || (*s >= 'a' && *s <= 'z') || (*s >= '0' && *s <= '9'))) return false;
+    }
+    return true;
+}
+
+static void dispatch(char* line, struct Reply* r) {
+    char* arg = strchr(line, ' ');
+    if (arg) {
+        *arg++ = '\0';
+        while (*arg == ' ') arg++;
+    }
+    log_debug("[CONTROL] %s%s%s", line, arg ? " " : "", arg ? arg : "");
+
+    char result[REPLY_MAX];
+    if (strcmp(line, "status") == 0) {
+        do_status(r);
+    } else if (strcmp(line, "list-titles") == 0) {
+        do_list(r);
+    } else if (strcmp(line, "rescan-path") == 0) {
+        int depth;
+        struct stat st;
+        if (!arg || !clean_path(arg)) {
+            reply_add(r, "ERR rescan-path needs an absolute path\n");
+        } else if (scan_root_of(arg, &depth) < 0) {
+            reply_add(r, "ERR %s is not under a scan root\n", arg);
+        } else if (!health_ready(arg)) {
+            reply_add(r, "ERR the drive holding %s is not responding\n", arg);
+        } else if (stat(arg, &st) != 0 || !S_ISDIR(st.st_mode)) {
+            reply_add(r, "ERR %s is not a folder\n", arg);
+        } else {
+            submit(CONTROL_RESCAN, arg, depth, result, sizeof(result));
+            reply_add(r, "%s\n", result);
+        }
+    } else if (strcmp(line, "remount-title") == 0) {
+        if (!arg || !valid_title_id(arg)) {
+            reply_add(r, "ERR remount-title needs a title id\n");
+        } else {
+            submit(CONTROL_REMOUNT, arg, 0, result, sizeof(result));
+            reply_add(r, "%s\n", result);
+        }
+    } else if (strcmp(line, "shutdown") == 0) {
+        submit(CONTROL_SHUTDOWN, NULL, 0, result, sizeof(result));
+        reply_add(r, "%s\n", result);
+    } else {
+        reply_add(r, "ERR unknown command '%s' (status, list-titles, rescan-path, remount-title, shutdown)\n", line);
+    }
+}
+
+// --- SERVER ---
+static bool read_line(int fd, char* out, size_t size) {
+    size_t len = 0;
+    while (len + 1 < size) {
+        ssize_t n = recv(fd, out + len, 1, 0);
+        if (n <= 0) break;
+        if (out[len] == '\n') break;
+        len++;
+    }
+    out[len] = '\0';
+    if (len && out[len - 1] == '\r') out[--len] = '\0';
+    return len > 0;
+}
+
+static void send_all(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, SEND_FLAGS);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+        data += n;
+        len -= (size_t)n;
+    }
+}
+
+static void handle_client(int fd) {
+    struct timeval tv = { CONTROL_IO_TIMEOUT_MS / 1000, (CONTROL_IO_TIMEOUT_MS % 1000) * 1000 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+#ifdef SO_NOSIGPIPE
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+
+    char line[CONTROL_MAX_LINE];
+    struct Reply r = {0};
+    if (read_line(fd, line, sizeof(line))) dispatch(line, &r);
+    else reply_add(&r, "ERR no command\n");
+    if (r.failed) {
+        send_all(fd, "ERR out of memory\n", 18);
+    } else if (r.buf) {
+        send_all(fd, r.buf, r.len);
+    }
+    free(r.buf);
+}
+
+static void* control_main(void* arg) {
+    (void)arg;
+    while (!__atomic_load_n(&stopping, __ATOMIC_ACQUIRE)) {
+        struct pollfd pfd = { .fd = listen_fd, .events = POLLIN };
+        if (poll(&pfd, 1, CONTROL_ACCEPT_POLL_MS) <= 0) continue;
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0) continue;
+        handle_client(fd);
+        close(fd);
+    }
+    return NULL;
+}
+
+bool control_start(void) {
+    if (running) return true;
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", CONTROL_SOCKET);
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        log_debug("[CONTROL] socket failed: %s", strerror(errno));
+        return false;
+    }
+    fcntl(listen_fd, F_SETFD, FD_CLOEXEC);
+    unlink(CONTROL_SOCKET); // Left behind by a previous run
+    if (bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(listen_fd, 4) != 0) {
+        log_debug("[CONTROL] Cannot listen on %s: %s", CONTROL_SOCKET, strerror(errno));
+        close(listen_fd);
+        listen_fd = -1;
+        return false;
+    }
+    __atomic_store_n(&stopping, false, __ATOMIC_RELEASE);
+    if (pthread_create(&server, NULL, control_main, NULL) != 0) {
+        close(listen_fd);
+        listen_fd = -1;
+        unlink(CONTROL_SOCKET);
+        return false;
+    }
+    running = true;
+    log_debug("[CONTROL] Listening on %s", CONTROL_SOCKET);
+    return true;
+}
+
+void control_shutdown(void) {
+    if (!running) return;
+    pthread_mutex_lock(&request_lock);
+    __atomic_store_n(&stopping, true, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&request_cond);
+    pthread_mutex_unlock(&request_lock);
+    pthread_join(server, NULL);
+    close(listen_fd);
+    listen_fd = -1;
+    unlink(CONTROL_SOCKET);
+    running = false;
+}
@@ -0,0 +1,32 @@
+#ifndef CONTROL_H
+#define CONTROL_H
+
+#include <stdbool.h>
+
+// --- CONTROL SOCKET ---
+// Local UNIX-domain stream socket served by its own thread. A client sends
+// one command line and reads the reply until the daemon closes the
+// connection: a first line "OK ..." or "ERR <reason>", then any data lines.
+//
+//   status                     counters of the daemon and the last snapshot
+//   list-titles                every mounted/installed title
+//   rescan-path <path>         walk only that folder (under a scan root)
+//   remount-title <TITLE_ID>   mount a title again from its known source
+//   shutdown                   stop the daemon (same as KILL_FILE)
+//
+// Status and listings are answered by the socket thread. Rescans, remounts
+// and shutdown are handed to the main loop so they never race a scan pass.
+
+#define CONTROL_SOCKET          "/data/shadowmount/control.sock"
+#define CONTROL_MAX_LINE        1100        // Command plus a MAX_PATH argument
+#define CONTROL_IO_TIMEOUT_MS   2000        // Per client read/write
+#define CONTROL_ACCEPT_POLL_MS  500         // Shutdown latency of the socket thread
+
+bool control_start(void);
+void control_shutdown(void);
+
+// Main loop side: runs a command waiting for it, adding what it installed or
+// mounted to the counters. Returns true when a shutdown was requested.
+bool control_poll(int* installed, int* mounted);
+
+#endif
@@ -0,0 +1,355 @@
+#ifdef __linux__
+#define _GNU_SOURCE // copy_file_range()
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "shadowmount.h"
+#include "copy.h"
+#include "walk.h"
+#include "stats.h"
+#include "iobuf.h"
+#include "journal.h"
+#include "util.h"
+
+// --- SHARED DIRECTORY HANDLES ---
+// Queued jobs keep their source/destination directories open until the
+// last file in them is done.
+struct DirRef {
+    int src_fd;
+    int dst_fd;
+    int refs;
+};
+
+static struct DirRef* dirref_new(int src_fd, int dst_fd) {
+    struct DirRef* r = (struct DirRef*)malloc(sizeof(struct DirRef));
+    if (!r) return NULL;
+    r->src_fd = src_fd;
+    r->dst_fd = dst_fd;
+    r->refs = 1;
+    return r;
+}
+
+static void dirref_put(struct DirRef* r) {
+    if (__atomic_sub_fetch(&r->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+        close(r->src_fd);
+        close(r->dst_fd);
+        free(r);
+    }
+}
+
+// --- SINGLE FILE ---
+static void report_add(struct CopyReport* report, unsigned* field, unsigned long long bytes) {
+    __atomic_fetch_add(field, 1, __ATOMIC_RELAXED);
+    if (bytes) __atomic_fetch_add(&report->bytes, bytes, __ATOMIC_RELAXED);
+    stats_add(field == &report->files ? STAT_FILES_COPIED :
+              field == &report->skipped ? STAT_FILES_SKIPPED : STAT_COPY_FAILURES, 1);
+    if (bytes) stats_add(STAT_BYTES_COPIED, bytes);
+}
+
+// Returns bytes copied, or -1
+static long long copy_data(int in, int out, off_t size, char* buf, size_t buf_size) {
+    long long total = 0;
+#ifdef __linux__
+    // Let the kernel move the data when it can (host builds)
+    while (total < size) {
+        ssize_t n = copy_file_range(in, NULL, out, NULL, (size_t)(size - total), 0);
+        if (n <= 0) break;
+        total += n;
+    }
+    if (total == size) return total;
+    if (total > 0 && lseek(in, total, SEEK_SET) < 0) return -1;
+#else
+    (void)size;
+#endif
+    ssize_t n;
+    while (true) {
+        n = read(in, buf, buf_size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        if (!write_full(out, buf, (size_t)n)) return -1;
+        total += n;
+    }
+    return n < 0 ? -1 : total;
+}
+
+// sync: fsync before the rename, for files a journal record vouches for.
+// Tree copies skip it and rely on the rename and the delta skip.
+static bool copy_one(int src_dir, const char* src_name, int dst_dir, const char* dst_name,
+                     const struct stat* src_st, char* buf, size_t buf_size, bool sync,
+                     struct CopyReport* report) {
+    // Delta skip: same size and mtime means this file was copied before
+    struct stat dst_st;
+    if (walk_stat(dst_dir, dst_name, &dst_st) == 0 && S_ISREG(dst_st.st_mode) &&
+        dst_st.st_size == src_st->st_size &&
+        dst_st.st_mtim.tv_sec == src_st->st_mtim.tv_sec &&
+        dst_st.st_mtim.tv_nsec == src_st->st_mtim.tv_nsec) {
+        report_add(report, &report->skipped, 0);
+        return true;
+    }
+
+    int in = openat(src_dir, src_name, O_RDONLY | O_CLOEXEC);
+    if (in < 0) {
+        report_add(report, &report->failed, 0);
+        return false;
+    }
+    // Written under a temp name and renamed once complete, so a crash never
+    // leaves a partial file that passes the delta skip
+    char tmp_name[MAX_PATH];
+    snprintf(tmp_name, sizeof(tmp_name), "%s%s", dst_name, COPY_TEMP_SUFFIX);
+    int out = openat(dst_dir, tmp_name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (out < 0) {
+        close(in);
+        report_add(report, &report->failed, 0);
+        return false;
+    }
+
+    long long copied = copy_data(in, out, src_st->st_size, buf, buf_size);
+    bool ok = copied >= 0;
+    if (ok) {
+        // Carry the source mtime over so the next copy can skip this file
+        struct timespec times[2] = { src_st->st_atim, src_st->st_mtim };
+        if (futimens(out, times) != 0) {
+            log_debug("  [COPY] %s: mtime not set (%s), it will be copied again", dst_name, strerror(errno));
+            __atomic_fetch_add(&report->untimed, 1, __ATOMIC_RELAXED);
+            stats_add(STAT_COPY_UNTIMED, 1);
+        }
+        if (sync && fsync(out) != 0) ok = false;
+    }
+    if (close(out) != 0) ok = false;
+    close(in);
+    journal_fault("copy");
+    if (ok && renameat(dst_dir, tmp_name, dst_dir, dst_name) != 0) ok = false;
+    // The journal records the file as in place: the rename must last too
+    if (ok && sync && !fsync_parent(dst_dir, dst_name)) ok = false;
+
+    if (!ok) {
+        log_debug("  [COPY] Failed %s: %s", dst_name, strerror(errno));
+        unlinkat(dst_dir, tmp_name, 0);
+        report_add(report, &report->failed, 0);
+        return false;
+    }
+    report_add(report, &report->files, (unsigned long long)copied);
+    return true;
+}
+
+// --- SMALL FILE POOL ---
+struct CopyJob {
+    struct DirRef* dir;
+    char name[256];
+    struct stat st;
+};
+
+struct CopyPool {
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    struct CopyJob jobs[COPY_QUEUE_SIZE];
+    int head, count;
+    bool closing;
+    pthread_t threads[COPY_WORKERS];
+    int thread_count;
+    struct CopyReport* report;
+};
+
+static void* pool_worker(void* arg) {
+    struct CopyPool* pool = (struct CopyPool*)arg;
+    // Pool jobs are small files, a small buffer holds them in one read
+    char* buf = iobuf_get(COPY_SMALL_FILE);
+    while (true) {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->count == 0 && !pool->closing) pthread_cond_wait(&pool->not_empty, &pool->lock);
+        if (pool->count == 0) {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        struct CopyJob job = pool->jobs[pool->head];
+        pool->head = (pool->head + 1) % COPY_QUEUE_SIZE;
+        pool->count--;
+        pthread_cond_signal(&pool->not_full);
+        pthread_mutex_unlock(&pool->lock);
+
+        if (buf) {
+            copy_one(job.dir->src_fd, job.name, job.dir->dst_fd, job.name, &job.st, buf, COPY_SMALL_FILE, false,
+                     pool->report);
+        } else {
+            report_add(pool->report, &pool->report->failed, 0);
+        }
+        dirref_put(job.dir);
+    }
+    iobuf_put(buf, COPY_SMALL_FILE);
+    return NULL;
+}
+
+// Queues a small file; returns false if no worker could be started
+static bool pool_submit(struct CopyPool* pool, struct DirRef* dir, const char* name, const struct stat* st) {
+    if (strlen(name) >= sizeof(pool->jobs[0].name)) return false;
+    pthread_mutex_lock(&pool->lock);
+    // Start workers lazily, up to COPY_WORKERS
+    if (pool->thread_count < COPY_WORKERS && pool->count >= pool->thread_count) {
+        if (pthread_create(&pool->threads[pool->thread_count], NULL, pool_worker, pool) == 0) {
+            pool->thread_count++;
+        }
+    }
+    if (pool->thread_count == 0) {
+        pthread_mutex_unlock(&pool->lock);
+        return false;
+    }
+    while (pool->count == COPY_QUEUE_SIZE) pthread_cond_wait(&pool->not_full, &pool->lock);
+    struct CopyJob* job = &pool->jobs[(pool->head + pool->count) % COPY_QUEUE_SIZE];
+    __atomic_add_fetch(&dir->refs, 1, __ATOMIC_ACQ_REL);
+    job->dir = dir;
+    snprintf(job->name, sizeof(job->name), "%s", name);
+    job->st = *st;
+    pool->count++;
+    pthread_cond_signal(&pool->not_empty);
+    pthread_mutex_unlock(&pool->lock);
+    return true;
+}
+
+static void pool_finish(struct CopyPool* pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->closing = true;
+    pthread_cond_broadcast(&pool->not_empty);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 0; i < pool->thread_count; i++) pthread_join(pool->threads[i], NULL);
+}
+
+// --- TREE COPY ---
+static void copy_dir_at(int src_parent, const char* src_name, int dst_parent, const char* dst_name,
+                        struct CopyPool* pool, char* buf, struct CopyReport* report) {
+    if (mkdirat(dst_parent, dst_name, 0777) < 0 && errno != EEXIST) {
+        report_add(report, &report->failed, 0);
+        return;
+    }
+    struct WalkDir w;
+    if (!walk_open(&w, src_parent, src_name)) {
+        report_add(report, &report->failed, 0);
+        return;
+    }
+    int dst_fd = openat(dst_parent, dst_name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    int src_fd = dst_fd >= 0 ? dup(w.fd) : -1;
+    struct DirRef* dir = src_fd >= 0 ? dirref_new(src_fd, dst_fd) : NULL;
+    if (!dir) {
+        if (src_fd >= 0) close(src_fd);
+        if (dst_fd >= 0) close(dst_fd);
+        walk_close(&w);
+        report_add(report, &report->failed, 0);
+        return;
+    }
+
+    struct WalkEntry e;
+    while (walk_next(&w, &e)) {
+        if (e.type == DT_DIR) {
+            copy_dir_at(w.fd, e.name, dst_fd, e.name, pool, buf, report);
+            continue;
+        }
+        if (e.type != DT_REG) continue;
+        struct stat st;
+        if (e.has_stat) st = e.st;
+        else if (walk_stat(w.fd, e.name, &st) != 0) { report_add(report, &report->failed, 0); continue; }
+
+        if (st.st_size > COPY_SMALL_FILE || !pool_submit(pool, dir, e.name, &st)) {
+            copy_one(w.fd, e.name, dst_fd, e.name, &st, buf, COPY_BUF_SIZE, false, report);
+        }
+    }
+    walk_close(&w);
+    dirref_put(dir);
+}
+
+static long elapsed_ms_since(const struct timespec* t0) {
+    struct timespec t1;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    return (t1.tv_sec - t0->tv_sec) * 1000 + (t1.tv_nsec - t0->tv_nsec) / 1000000;
+}
+
+int copy_tree(const char* src, const char* dst, struct CopyReport* report) {
+    struct CopyReport local = {0};
+    struct CopyReport* rep = report ? report : &local;
+    unsigned failed_before = rep->failed;
+    struct timespec t0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    // The job queue is too large for the stack of a worker thread
+    char* buf = iobuf_get(COPY_BUF_SIZE);
+    struct CopyPool* pool = (struct CopyPool*)calloc(1, sizeof(struct CopyPool));
+    if (!buf || !pool) {
+        iobuf_put(buf, COPY_BUF_SIZE);
+        free(pool);
+        return -1;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->not_empty, NULL);
+    pthread_cond_init(&pool->not_full, NULL);
+    pool->report = rep;
+
+    copy_dir_at(AT_FDCWD, src, AT_FDCWD, dst, pool, buf, rep);
+    pool_finish(pool);
+
+    pthread_cond_destroy(&pool->not_full);
+    pthread_cond_destroy(&pool->not_empty);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool);
+    iobuf_put(buf, COPY_BUF_SIZE);
+    rep->elapsed_ms += elapsed_ms_since(&t0);
+    return rep->failed == failed_before ? 0 : -1;
+}
+
+static int copy_file(const char* src, const char* dst, bool sync, struct CopyReport* report) {
+    struct CopyReport local = {0};
+    struct CopyReport* rep = report ? report : &local;
+    struct timespec t0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    struct stat st;
+    if (walk_stat(AT_FDCWD, src, &st) != 0 || !S_ISREG(st.st_mode)) return -1;
+    char* buf = iobuf_get(COPY_BUF_SIZE);
+    if (!buf) return -1;
+    bool ok = copy_one(AT_FDCWD, src, AT_FDCWD, dst, &st, buf, COPY_BUF_SIZE, sync, rep);
+    iobuf_put(buf, COPY_BUF_SIZE);
+    rep->elapsed_ms += elapsed_ms_since(&t0);
+    return ok ? 0 : -1;
+}
+
+int copy_file_ex(const char* src, const char* dst, struct CopyReport* report) {
+    return copy_file(src, dst, false, report);
+}
+
+int copy_file_sync(const char* src, const char* dst, struct CopyReport* report) {
+    return copy_file(src, dst, true, report);
+}
+
+void copy_remove_temps(const char* dir) {
+    struct WalkDir w;
+    if (!walk_open(&w, AT_FDCWD, dir)) return;
+    size_t suffix_len = strlen(COPY_TEMP_SUFFIX);
+    struct WalkEntry e;
+    char path[MAX_PATH];
+    while (walk_next(&w, &e)) {
+        snprintf(path, sizeof(path), "%s/%s", dir, e.name);
+        size_t len = strlen(e.name);
+        if (e.type == DT_DIR) {
+            copy_remove_temps(path);
+        } else if (len > suffix_len && strcmp(e.name + len - suffix_len, COPY_TEMP_SUFFIX) == 0) {
+            log_debug("  [COPY] Removing leftover %s", path);
+            unlink(path);
+        }
+    }
+    walk_close(&w);
+}
+
+void copy_log_report(const char* what, const struct CopyReport* r) {
+    double mb = r->bytes / (1024.0 * 1024.0);
+    double mbps = r->elapsed_ms > 0 ? mb * 1000.0 / r->elapsed_ms : 0.0;
+    log_debug("  [COPY] %s: %u copied, %u up to date, %u failed, %.1f MB in %ldms (%.1f MB/s)%s",
+              what, r->files, r->skipped, r->failed, mb, r->elapsed_ms, mbps,
+              r->untimed ? ", some without their mtime" : "");
+}
@@ -0,0 +1,43 @@
+#ifndef COPY_H
+#define COPY_H
+
+#include <stdbool.h>
+
+#include "iobuf.h"
+
+// --- COPY ENGINE ---
+// Tree copies with pooled aligned buffers (copy_file_range() where the kernel
+// has it), delta skipping of files whose size and mtime already match, and a
+// bounded worker pool for small files. Every read/write/close is checked and
+// a failed file never stays behind half-written: files are written under
+// COPY_TEMP_SUFFIX and renamed into place once complete.
+
+#define COPY_BUF_SIZE       IOBUF_LARGE
+#define COPY_SMALL_FILE     IOBUF_SMALL   // Files up to this size go to the pool
+#define COPY_WORKERS        4
+#define COPY_QUEUE_SIZE     64
+#define COPY_TEMP_SUFFIX    ".smtmp"
+
+struct CopyReport {
+    unsigned files;              // Files copied
+    unsigned skipped;            // Already up to date
+    unsigned failed;
+    unsigned untimed;            // Copied without the source mtime: recopied next time
+    unsigned long long bytes;    // Bytes written
+    long elapsed_ms;
+};
+
+// Both return 0 when every file is in place, -1 if anything failed.
+// report may be NULL; counters are added to it.
+int copy_tree(const char* src, const char* dst, struct CopyReport* report);
+int copy_file_ex(const char* src, const char* dst, struct CopyReport* report);
+// copy_file_ex() with an fsync before the rename, for the registration
+// files an install journal record says are in place
+int copy_file_sync(const char* src, const char* dst, struct CopyReport* report);
+
+// Deletes the temp files a crash left below dir
+void copy_remove_temps(const char* dir);
+
+void copy_log_report(const char* what, const struct CopyReport* report);
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// --- CRC32C ---
+// Castagnoli CRC. Uses the SSE4.2 crc32 instruction on x86-64 (every PS5
+// has it), a table otherwise. Chainable: pass the previous result as crc,
+// starting from 0.
+
+uint32_t crc32c(uint32_t crc, const void* data, size_t len);
+
+#endif
@@ -0,0 +1,260 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/mount.h>
+
+#include <ps5/kernel.h>
+
+#include "shadowmount.h"
+#include "devmap.h"
+#include "mounts.h"
+#include "install.h"
+#include "cache.h"
+#include "arena.h"
+#include "sources.h"
+#include "stats.h"
+#include "health.h"
+#include "watcher.h"
+
+struct MappedTitle {
+    char title_id[MAX_TITLE_ID];
+    const char* title_name;     // Interned
+    path_id source;
+};
+
+struct MappedDevice {
+    char path[64];
+    bool removable;         // Under /mnt; internal storage never goes away
+    bool present;
+    dev_t dev;              // A new st_dev means another drive was mounted here
+    struct MappedTitle* titles;
+    int title_count;
+    int title_capacity;
+};
+
+static struct MappedDevice devices[DEVMAP_MAX_DEVICES];
+static int device_count = 0;
+static long long next_check_us = 0;
+static pthread_mutex_t devmap_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void devmap_device_of(const char* path, char* out, size_t size) {
+    const char* p = strncmp(path, "/mnt/", 5) == 0 ? path + 5 : path + 1;
+    const char* slash = strchr(p, '/');
+    int len = slash ? (int)(slash - path) : (int)strlen(path);
+    snprintf(out, size, "%.*s", len, path);
+}
+
+static void probe(struct MappedDevice* d) {
+    // Drives holding a scan root are stat'ed by the health prober, off this
+    // thread; one that stops answering is left as is for the quarantine
+    bool present;
+    dev_t dev;
+    if (health_presence(d->path, &present, &dev)) {
+        if (!health_usable(d->path)) return;
+        d->present = present;
+        d->dev = dev;
+        return;
+    }
+    struct stat st;
+    d->present = stat(d->path, &st) == 0 && S_ISDIR(st.st_mode);
+    d->dev = d->present ? st.st_dev : 0;
+}
+
+static struct MappedDevice* find_device(const char* path, bool create) {
+    for (int d = 0; d < device_count; d++) {
+        if (strcmp(devices[d].path, path) == 0) return &devices[d];
+    }
+    if (!create || device_count == DEVMAP_MAX_DEVICES) return NULL;
+    struct MappedDevice* d = &devices[device_count++];
+    memset(d, 0, sizeof(*d));
+    snprintf(d->path, sizeof(d->path), "%s", path);
+    d->removable = strncmp(path, "/mnt/", 5) == 0;
+    probe(d);
+    return d;
+}
+
+static void remove_title(struct MappedDevice* d, int i) {
+    d->titles[i] = d->titles[--d->title_count];
+}
+
+// --- UPDATES ---
+void devmap_note(const char* title_id, const char* title_name, const char* source) {
+    char key[MAX_PATH];
+    devmap_device_of(source, key, sizeof(key));
+    pthread_mutex_lock(&devmap_lock);
+    const char* old_name = NULL;
+    for (int d = 0; d < device_count; d++) {
+        for (int i = 0; i < devices[d].title_count; i++) {
+            if (strcmp(devices[d].titles[i].title_id, title_id) != 0) continue;
+            old_name = devices[d].titles[i].title_name;
+            remove_title(&devices[d], i);
+            break;
+        }
+    }
+
+    struct MappedDevice* d = find_device(key, true);
+    if (d && d->title_count == d->title_capacity) {
+        int cap = d->title_capacity ? d->title_capacity * 2 : 32;
+        struct MappedTitle* grown = (struct MappedTitle*)realloc(d->titles, cap * sizeof(*grown));
+        if (grown) {
+            d->titles = grown;
+            d->title_capacity = cap;
+        }
+    }
+    path_id src = path_intern(source);
+    const char* name = title_name ? intern_str(title_name) : old_name ? old_name : intern_str(title_id);
+    if (!d || d->title_count == d->title_capacity || !src || !name) {
+        pthread_mutex_unlock(&devmap_lock);
+        log_debug("[DEVMAP] Cannot track %s on %s", title_id, key);
+        return;
+    }
+    struct MappedTitle* t = &d->titles[d->title_count++];
+    snprintf(t->title_id, sizeof(t->title_id), "%s", title_id);
+    t->title_name = name;
+    t->source = src;
+    pthread_mutex_unlock(&devmap_lock);
+}
+
+// --- UNPLUG / REPLUG ---
+// Every title still mounted from the vanished drive, in one sweep. Titles
+// with a copy on another drive are queued from the best one; *fallbacks
+// counts them and the caller flushes the batch.
+static int unplug(struct MappedDevice* d, int* fallbacks) {
+    long long t0 = monotonic_us();
+    int unmounted = 0;
+    char mount_path[MAX_PATH], source[MAX_PATH], mapped[MAX_PATH], next[MAX_PATH];
+    // Its watches hold fds on the drive (kqueue) and would keep it busy
+    watcher_remove_tree(d->path);
+    for (int i = 0; i < d->title_count; i++) {
+        struct MappedTitle* t = &d->titles[i];
+        if (!mounts_get_source(t->title_id, source, sizeof(source)) ||
+            !path_get(t->source, mapped, sizeof(mapped)) || strcmp(source, mapped) != 0) continue;
+        snprintf(mount_path, sizeof(mount_path), "/system_ex/app/%s", t->title_id);
+        if (unmount(mount_path, MNT_FORCE) != 0) {
+            log_debug("  [DEVMAP] Unmount %s failed: %s", t->title_id, strerror(errno));
+        } else {
+            unmounted++;
+        }
+        mounts_note_unmounted(t->title_id);
+        // Let the scan pick the title up again from any other copy
+        title_cache_remove(t->title_id);
+        if (sources_fallback(t->title_id, d->path, next, sizeof(next))) {
+            log_debug("  [DEVMAP] %s falls back to %s", t->title_id, next);
+            install_queue(next, t->title_id, t->title_name, true);
+            stats_add(STAT_SOURCE_FALLBACKS, 1);
+            (*fallbacks)++;
+        }
+    }
+    // Titles claimed from the drive but never mounted are picked up again too
+    title_cache_remove_tree(d->path);
+    log_debug("[DEVMAP] %s gone: %d of %d title(s) unmounted in %lldms",
+              d->path, unmounted, d->title_count, (monotonic_us() - t0) / 1000);
+    return unmounted;
+}
+
+// Queues the titles of a drive that came back; the caller flushes the batch.
+// A title mounted from another copy meanwhile moves back only when this
+// drive is clearly faster.
+static int replug(struct MappedDevice* d) {
+    int queued = 0;
+    char source[MAX_PATH], current[MAX_PATH];
+    for (int i = 0; i < d->title_count; i++) {
+        struct MappedTitle* t = &d->titles[i];
+        if (!path_get(t->source, source, sizeof(source))) continue;
+        if (mounts_get_source(t->title_id, current, sizeof(current)) &&
+            (strcmp(current, source) == 0 || !sources_prefer(source, current))) continue;
+        struct stat st;
+        if (stat(source, &st) != 0 || !S_ISDIR(st.st_mode)) continue;
+        install_queue(source, t->title_id, t->title_name, true);
+        queued++;
+    }
+    return queued;
+}
+
+int devmap_check(void) {
+    // Cheap enough to run on every wakeup; the interval only bounds idle waits
+    next_check_us = monotonic_us() + DEVMAP_CHECK_US;
+
+    int changed = 0, fallbacks = 0;
+    char back[DEVMAP_MAX_DEVICES][sizeof(devices[0].path)];
+    int back_count = 0;
+    pthread_mutex_lock(&devmap_lock);
+    for (int i = 0; i < device_count; i++) {
+        struct MappedDevice* d = &devices[i];
+        // A quarantined drive may hang even a stat; it was swept already
+        if (!d->removable || d->title_count == 0 || !health_usable(d->path)) continue;
+        bool was_present = d->present;
+        dev_t was_dev = d->dev;
+        probe(d);
+        if (was_present && !d->present) {
+            int n = unplug(d, &fallbacks);
+            if (n > 0) notify_system("%s removed\n%d game(s) unmounted.", d->path, n);
+            changed += n;
+        } else if (d->present && (!was_present || d->dev != was_dev)) {
+            memcpy(back[back_count++], d->path, sizeof(back[0]));
+        }
+    }
+    pthread_mutex_unlock(&devmap_lock);
+    int installed = 0, mounted = 0;
+    if (fallbacks > 0) {
+        // The mount batch notes every title again, so it runs without the lock
+        install_flush(&installed, &mounted);
+        log_debug("[DEVMAP] %d of %d title(s) moved to another copy", mounted, fallbacks);
+        changed += mounted;
+        mounted = 0;
+    }
+    if (back_count == 0) return changed;
+
+    long long t0 = monotonic_us();
+    mounts_refresh();
+    int queued = 0;
+    pthread_mutex_lock(&devmap_lock);
+    for (int b = 0; b < back_count; b++) {
+        struct MappedDevice* d = find_device(back[b], false);
+        if (!d) continue;
+        int n = replug(d);
+        log_debug("[DEVMAP] %s back: %d of %d title(s) to remount", d->path, n, d->title_count);
+        queued += n;
+    }
+    pthread_mutex_unlock(&devmap_lock);
+    if (queued > 0) {
+        install_flush(&installed, &mounted);
+        log_debug("[DEVMAP] %d of %d title(s) remounted in %lldms", mounted, queued, (monotonic_us() - t0) / 1000);
+    }
+    if (mounted > 0) notify_system("%s connected\n%d game(s) remounted.", back[0], mounted);
+    return changed + mounted;
+}
+
+int devmap_quarantine(const char* device) {
+    int unmounted = 0, fallbacks = 0;
+    pthread_mutex_lock(&devmap_lock);
+    struct MappedDevice* d = find_device(device, false);
+    if (d) {
+        unmounted = unplug(d, &fallbacks);
+        // Seen as absent: a re-admitted drive comes back through replug()
+        d->present = false;
+        d->dev = 0;
+    }
+    pthread_mutex_unlock(&devmap_lock);
+    if (fallbacks > 0) {
+        int installed = 0, mounted = 0;
+        install_flush(&installed, &mounted);
+        log_debug("[DEVMAP] %d of %d title(s) moved to another copy", mounted, fallbacks);
+    }
+    return unmounted;
+}
+
+long long devmap_next_due_us(void) {
+    bool any = false;
+    pthread_mutex_lock(&devmap_lock);
+    for (int i = 0; i < device_count && !any; i++) {
+        any = devices[i].removable && devices[i].title_count > 0;
+    }
+    pthread_mutex_unlock(&devmap_lock);
+    if (!any) return -1;
+    long long left = next_check_us - monotonic_us();
+    return left > 0 ? left : 0;
+}
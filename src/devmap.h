@@ -0,0 +1,35 @@
+#ifndef DEVMAP_H
+#define DEVMAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// --- DEVICE MAP ---
+// Reverse index from a source drive folder ("/mnt/usb0", "/data") to the
+// titles mounted from it, seeded from the mount.lnk trackers at boot and
+// kept current by the mount batch. When a drive disappears every title on
+// it is unmounted in one sweep; when it comes back they are remounted
+// straight from the map, without walking the drive or parsing param.json.
+
+#define DEVMAP_MAX_DEVICES  16
+#define DEVMAP_CHECK_US     1000000     // Longest wait between presence checks
+
+// "/mnt/usb0/homebrew/X" -> "/mnt/usb0", "/data/homebrew/X" -> "/data"
+void devmap_device_of(const char* path, char* out, size_t size);
+
+// Title is (or should be) mounted from source; moves it between drives
+void devmap_note(const char* title_id, const char* title_name, const char* source);
+
+// Call on every wakeup: the presence of each removable drive folder that holds titles. Unmounts the titles of
+// drives that are gone and remounts those of drives that came back.
+// Returns the number of titles unmounted or remounted.
+int devmap_check(void);
+
+// Unmounts every title mounted from a drive that stopped answering (see
+// health.h), without touching the drive; returns how many
+int devmap_quarantine(const char* device);
+
+// Microseconds until the next devmap_check() is due (-1 = nothing to watch)
+long long devmap_next_due_us(void);
+
+#endif
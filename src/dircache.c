@@ -0,0 +1,310 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "shadowmount.h"
+#include "dircache.h"
+#include "stats.h"
+#include "util.h"
+
+// On-disk layout (native endian, written/read by the same console): the
+// record file header (util.h), then per folder
+//   record: dev u64 | ino u64 | mtime i64 | listed_at i64 | last_seen i64 |
+//           child_count u32 | names_len u32 | path_len u16 | path | names
+#define DIRCACHE_RECORD_FIXED   50
+#define DIRCACHE_MAX_FILE       (32 * 1024 * 1024)
+
+struct DirEntry {
+    char* path;
+    char* names;        // child_count NUL-terminated names, NULL once forgotten
+    uint32_t names_len;
+    uint32_t child_count;
+    uint64_t dev;
+    uint64_t ino;
+    int64_t mtime;
+    int64_t listed_at;
+    int64_t last_seen;
+};
+
+static struct DirEntry* entries = NULL;
+static uint32_t entry_count = 0;
+static uint32_t entry_capacity = 0;
+
+// Open addressing table of (entry index + 1), 0 = empty slot
+static uint32_t* slots = NULL;
+static uint32_t slot_count = 0;
+
+static pthread_mutex_t dircache_lock = PTHREAD_MUTEX_INITIALIZER;
+static bool dircache_dirty = false;
+static int pass_pruned = 0;
+static int pass_listed = 0;
+
+static int64_t mtime_ns(const struct stat* st) {
+    return (int64_t)st->st_mtim.tv_sec * 1000000000LL + st->st_mtim.tv_nsec;
+}
+
+static uint32_t entry_hash(uint32_t i) {
+    return str_hash(entries[i].path);
+}
+
+static void rebuild_slots(void) {
+    uint32_t n = 0;
+    uint32_t* fresh = slots_build(entry_count, &n, entry_hash);
+    // Out of memory: the old table may point at compacted or freed entries,
+    // so go without one (every lookup misses) until the next add rebuilds it
+    free(slots);
+    slots = fresh;
+    slot_count = fresh ? n : 0;
+}
+
+static struct DirEntry* find_entry(const char* path) {
+    if (!slots) return NULL;
+    uint32_t s = str_hash(path) & (slot_count - 1);
+    while (slots[s]) {
+        struct DirEntry* e = &entries[slots[s] - 1];
+        if (strcmp(e->path, path) == 0) return e;
+        s = (s + 1) & (slot_count - 1);
+    }
+    return NULL;
+}
+
+static struct DirEntry* add_entry(const char* path) {
+    if (entry_count >= DIRCACHE_MAX_ENTRIES) return NULL;
+    if (entry_count == entry_capacity) {
+        uint32_t cap = entry_capacity ? entry_capacity * 2 : 256;
+        struct DirEntry* grown = (struct DirEntry*)realloc(entries, cap * sizeof(*entries));
+        if (!grown) return NULL;
+        entries = grown;
+        entry_capacity = cap;
+    }
+    char* copy = strdup(path);
+    if (!copy) return NULL;
+    struct DirEntry* e = &entries[entry_count++];
+    memset(e, 0, sizeof(*e));
+    e->path = copy;
+    // Keep load factor under 50%
+    if (entry_count * 2 > slot_count) {
+        rebuild_slots();
+    } else {
+        slots_insert(slots, slot_count, str_hash(path), entry_count - 1);
+    }
+    return e;
+}
+
+static void set_names(struct DirEntry* e, char* names, uint32_t names_len, uint32_t count) {
+    free(e->names);
+    e->names = names;
+    e->names_len = names_len;
+    e->child_count = count;
+}
+
+// --- LOOKUPS ---
+bool dircache_has(const char* path) {
+    pthread_mutex_lock(&dircache_lock);
+    struct DirEntry* e = find_entry(path);
+    bool found = e && e->names;
+    pthread_mutex_unlock(&dircache_lock);
+    return found;
+}
+
+char* dircache_lookup(const char* path, const struct stat* st, uint32_t* out_count) {
+    pthread_mutex_lock(&dircache_lock);
+    struct DirEntry* e = find_entry(path);
+    // A listing made in the same coarse timestamp tick as a change may have
+    // missed it, so such records are only trusted after the next listing
+    if (!e || !e->names || e->dev != (uint64_t)st->st_dev || e->ino != (uint64_t)st->st_ino ||
+        e->mtime != mtime_ns(st) || e->listed_at - (int64_t)st->st_mtime <= DIRCACHE_RACY_SEC) {
+        pthread_mutex_unlock(&dircache_lock);
+        return NULL;
+    }
+    char* names = (char*)malloc(e->names_len ? e->names_len : 1);
+    if (names) {
+        memcpy(names, e->names, e->names_len);
+        *out_count = e->child_count;
+        e->last_seen = (int64_t)time(NULL);
+        pass_pruned++;
+    }
+    pthread_mutex_unlock(&dircache_lock);
+    if (names) stats_add(STAT_DIRS_PRUNED, 1);
+    return names;
+}
+
+void dircache_store(const char* path, const struct stat* st, const char* names,
+                    size_t names_len, uint32_t count) {
+    char* copy = (char*)malloc(names_len ? names_len : 1);
+    if (!copy) return;
+    memcpy(copy, names, names_len);
+    int64_t now = (int64_t)time(NULL);
+
+    pthread_mutex_lock(&dircache_lock);
+    struct DirEntry* e = find_entry(path);
+    if (!e) e = add_entry(path);
+    if (!e) {
+        pthread_mutex_unlock(&dircache_lock);
+        free(copy);
+        return;
+    }
+    set_names(e, copy, (uint32_t)names_len, count);
+    e->dev = (uint64_t)st->st_dev;
+    e->ino = (uint64_t)st->st_ino;
+    e->mtime = mtime_ns(st);
+    e->listed_at = now;
+    e->last_seen = now;
+    pass_listed++;
+    dircache_dirty = true;
+    pthread_mutex_unlock(&dircache_lock);
+}
+
+void dircache_forget(const char* path) {
+    pthread_mutex_lock(&dircache_lock);
+    struct DirEntry* e = find_entry(path);
+    if (e && e->names) {
+        set_names(e, NULL, 0, 0);
+        dircache_dirty = true;
+    }
+    pthread_mutex_unlock(&dircache_lock);
+}
+
+void dircache_forget_tree(const char* path) {
+    size_t len = strlen(path);
+    pthread_mutex_lock(&dircache_lock);
+    for (uint32_t i = 0; i < entry_count; i++) {
+        struct DirEntry* e = &entries[i];
+        if (!e->names || strncmp(e->path, path, len) != 0) continue;
+        if (e->path[len] != '\0' && e->path[len] != '/') continue;
+        set_names(e, NULL, 0, 0);
+        dircache_dirty = true;
+    }
+    pthread_mutex_unlock(&dircache_lock);
+}
+
+bool dircache_is_dirty(void) {
+    return dircache_dirty;
+}
+
+void dircache_reset_pass_stats(void) {
+    pthread_mutex_lock(&dircache_lock);
+    pass_pruned = 0;
+    pass_listed = 0;
+    pthread_mutex_unlock(&dircache_lock);
+}
+
+void dircache_get_pass_stats(int* pruned, int* listed) {
+    pthread_mutex_lock(&dircache_lock);
+    if (pruned) *pruned = pass_pruned;
+    if (listed) *listed = pass_listed;
+    pthread_mutex_unlock(&dircache_lock);
+}
+
+// --- PERSISTENCE ---
+static void clear_entries(void) {
+    for (uint32_t i = 0; i < entry_count; i++) {
+        free(entries[i].path);
+        free(entries[i].names);
+    }
+    entry_count = 0;
+    if (slots) memset(slots, 0, slot_count * sizeof(uint32_t));
+}
+
+bool dircache_load(const char* path) {
+    uint32_t count, payload_len;
+    uint8_t* buf = record_file_load(path, "[DIRCACHE]", DIRCACHE_MAGIC, DIRCACHE_VERSION, DIRCACHE_MAX_FILE,
+                                    &count, &payload_len);
+    if (!buf) return false;
+    bool ok = false;
+    pthread_mutex_lock(&dircache_lock);
+    const uint8_t* p = buf + RECORD_HEADER_SIZE;
+    const uint8_t* end = p + payload_len;
+    for (uint32_t i = 0; i < count; i++) {
+        if (end - p < DIRCACHE_RECORD_FIXED) goto out;
+        uint32_t child_count, names_len;
+        uint16_t path_len;
+        memcpy(&child_count, p + 40, 4);
+        memcpy(&names_len, p + 44, 4);
+        memcpy(&path_len, p + 48, 2);
+        if (path_len == 0 || path_len >= MAX_PATH ||
+            (size_t)(end - p) < (size_t)DIRCACHE_RECORD_FIXED + path_len + names_len) goto out;
+
+        char entry_path[MAX_PATH];
+        memcpy(entry_path, p + DIRCACHE_RECORD_FIXED, path_len);
+        entry_path[path_len] = '\0';
+        char* names = (char*)malloc(names_len ? names_len : 1);
+        if (!names) goto out;
+        memcpy(names, p + DIRCACHE_RECORD_FIXED + path_len, names_len);
+
+        struct DirEntry* e = find_entry(entry_path);
+        if (!e) e = add_entry(entry_path);
+        if (!e) { free(names); goto out; }
+        set_names(e, names, names_len, child_count);
+        memcpy(&e->dev, p, 8);
+        memcpy(&e->ino, p + 8, 8);
+        memcpy(&e->mtime, p + 16, 8);
+        memcpy(&e->listed_at, p + 24, 8);
+        memcpy(&e->last_seen, p + 32, 8);
+        p += DIRCACHE_RECORD_FIXED + path_len + names_len;
+    }
+    ok = true;
+    dircache_dirty = false;
+    log_debug("[DIRCACHE] Loaded %u folder(s) from %s", entry_count, path);
+
+out:
+    // Never keep a partially decoded cache
+    if (!ok) clear_entries();
+    pthread_mutex_unlock(&dircache_lock);
+    free(buf);
+    return ok;
+}
+
+// Crash-safe rewrite (record_file_save()); forgotten and long unseen folders are dropped
+bool dircache_save(const char* path) {
+    pthread_mutex_lock(&dircache_lock);
+    int64_t now = (int64_t)time(NULL);
+    size_t cap = RECORD_HEADER_SIZE;
+    for (uint32_t i = 0; i < entry_count; i++)
+        cap += DIRCACHE_RECORD_FIXED + strlen(entries[i].path) + entries[i].names_len;
+
+    uint8_t* buf = (uint8_t*)malloc(cap);
+    if (!buf) { pthread_mutex_unlock(&dircache_lock); return false; }
+
+    uint8_t* p = buf + RECORD_HEADER_SIZE;
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < entry_count; i++) {
+        struct DirEntry* e = &entries[i];
+        if (!e->names || now - e->last_seen > DIRCACHE_MAX_AGE_SEC) {
+            free(e->path);
+            free(e->names);
+            continue;
+        }
+        uint16_t path_len = (uint16_t)strlen(e->path);
+        memcpy(p, &e->dev, 8);
+        memcpy(p + 8, &e->ino, 8);
+        memcpy(p + 16, &e->mtime, 8);
+        memcpy(p + 24, &e->listed_at, 8);
+        memcpy(p + 32, &e->last_seen, 8);
+        memcpy(p + 40, &e->child_count, 4);
+        memcpy(p + 44, &e->names_len, 4);
+        memcpy(p + 48, &path_len, 2);
+        memcpy(p + DIRCACHE_RECORD_FIXED, e->path, path_len);
+        memcpy(p + DIRCACHE_RECORD_FIXED + path_len, e->names, e->names_len);
+        p += DIRCACHE_RECORD_FIXED + path_len + e->names_len;
+        entries[kept++] = *e;
+    }
+    if (kept != entry_count) {
+        entry_count = kept;
+        rebuild_slots();
+    }
+
+    bool ok = record_file_save(path, buf, (size_t)(p - buf), DIRCACHE_MAGIC, DIRCACHE_VERSION, kept);
+    if (!ok) {
+        log_debug("[DIRCACHE] Failed to save %s: %s", path, strerror(errno));
+    } else {
+        dircache_dirty = false;
+    }
+    free(buf);
+    pthread_mutex_unlock(&dircache_lock);
+    return ok;
+}
@@ -0,0 +1,49 @@
+#ifndef DIRCACHE_H
+#define DIRCACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+// --- DIRECTORY CACHE ---
+// Negative cache of folders that hold no game anywhere below them, keyed by
+// path. Each record keeps the folder's (device, inode, mtime) and the names
+// of its subfolders. While the mtime is unchanged the folder is not opened
+// or listed again: the scan only stats the recorded subfolders, so a game
+// copied deep into a cached tree still changes some folder's mtime on the
+// way down and is found in the same pass.
+
+#define DIRCACHE_FILE           "/data/shadowmount/dircache.bin"
+#define DIRCACHE_MAGIC          0x43444D53u  // "SMDC"
+#define DIRCACHE_VERSION        2   // 2: CRC32C checksum
+#define DIRCACHE_MAX_ENTRIES    65536
+#define DIRCACHE_RACY_SEC       2            // Coarse (exFAT) mtimes: distrust fresh listings
+#define DIRCACHE_MAX_AGE_SEC    (30 * 24 * 60 * 60)
+
+bool dircache_load(const char* path);
+bool dircache_save(const char* path);
+bool dircache_is_dirty(void);
+
+// Whether path has a record at all (no stat needed to ask)
+bool dircache_has(const char* path);
+
+// On a hit returns a malloc'ed block of count NUL-terminated subfolder
+// names (free() it); NULL when the folder must be listed again.
+char* dircache_lookup(const char* path, const struct stat* st, uint32_t* out_count);
+
+// Records a freshly listed game-free folder
+void dircache_store(const char* path, const struct stat* st, const char* names,
+                    size_t names_len, uint32_t count);
+
+// Something below path turned out to be a game (or a copy in progress)
+void dircache_forget(const char* path);
+
+// Forgets path and every folder below it, so the next walk lists them all
+void dircache_forget_tree(const char* path);
+
+// Per-pass counters: folders answered from the cache / listed and recorded
+void dircache_reset_pass_stats(void);
+void dircache_get_pass_stats(int* pruned, int* listed);
+
+#endif
@@ -0,0 +1,411 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "shadowmount.h"
+#include "health.h"
+#include "scan.h"
+#include "devmap.h"
+#include "stats.h"
+#include "watcher.h"
+
+#define HEALTH_MAX_ROOTS    32
+#define PROBER_STACK_SIZE   (64 * 1024)
+
+struct HealthDevice {
+    char path[64];              // devmap_device_of() form
+    int roots[HEALTH_MAX_ROOTS];
+    int root_count;
+    int state;                  // enum health_state; read without the lock
+    bool probed;
+    bool quarantine_pending;    // Went dead; health_check() sweeps it
+    long long vouched_until;    // Last full probe answered in time
+    long long next_due;         // Dead drives: next re-admission probe
+    long long backoff;
+    bool present;               // Drive folder as of the last answer
+    dev_t dev;
+    // Prober handoff
+    bool want;
+    bool want_full;
+    bool busy;                  // The prober (maybe an abandoned one) is inside a call on it
+    int stalled_walks;          // Abandoned scan walks still inside a call on it
+    bool done;
+    int err;
+    long long elapsed_us;
+};
+
+static struct HealthDevice devices[HEALTH_MAX_DEVICES];
+static int device_count = 0;
+static pthread_mutex_t probe_lock = PTHREAD_MUTEX_INITIALIZER;
+// Held around run_probes() (taken before probe_lock): a second caller
+// abandoning the prober mid-round would time out the first one's drives
+static pthread_mutex_t round_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t done_cond = PTHREAD_COND_INITIALIZER;
+
+// One prober at a time; a stuck one is abandoned by bumping the generation
+static unsigned prober_gen = 0;
+static bool prober_alive = false;
+static int prober_current = -1;
+
+static const char* state_names[] = { "ok", "slow", "dead" };
+
+static struct HealthDevice* find_device(const char* key) {
+    for (int d = 0; d < device_count; d++) {
+        if (strcmp(devices[d].path, key) == 0) return &devices[d];
+    }
+    return NULL;
+}
+
+void health_init(void) {
+    char key[64];
+    for (int i = 0; SCAN_PATHS[i] != NULL; i++) {
+        devmap_device_of(SCAN_PATHS[i], key, sizeof(key));
+        struct HealthDevice* d = find_device(key);
+        if (!d) {
+            if (device_count == HEALTH_MAX_DEVICES) continue;
+            d = &devices[device_count++];
+            memset(d, 0, sizeof(*d));
+            snprintf(d->path, sizeof(d->path), "%s", key);
+            d->backoff = HEALTH_MIN_BACKOFF_US;
+        }
+        if (d->root_count < HEALTH_MAX_ROOTS) d->roots[d->root_count++] = i;
+    }
+}
+
+// --- PROBE ---
+// A missing drive or root is not a fault: unplugging is handled elsewhere
+static int probe_dir(const char* path) {
+    struct stat st;
+    if (stat(path, &st) != 0) return errno == ENOENT || errno == ENOTDIR ? 0 : errno;
+    if (!S_ISDIR(st.st_mode)) return 0;
+    DIR* dir = opendir(path);
+    if (!dir) return errno == ENOENT ? 0 : errno;
+    errno = 0;
+    int err = readdir(dir) == NULL ? errno : 0;
+    closedir(dir);
+    return err;
+}
+
+// Runs without probe_lock; returns the results through d once relocked
+static int probe_device(const struct HealthDevice* d, bool full, bool* present, dev_t* dev) {
+    struct stat st;
+    int err = 0;
+    *present = stat(d->path, &st) == 0 && S_ISDIR(st.st_mode);
+    if (!*present && errno != ENOENT && errno != ENOTDIR) err = errno;
+    *dev = *present ? st.st_dev : 0;
+    for (int r = 0; full && *present && r < d->root_count && !err; r++) err = probe_dir(SCAN_PATHS[d->roots[r]]);
+    return err;
+}
+
+// Caller holds probe_lock; drops it for the I/O
+static void probe_one(int index, unsigned gen) {
+    struct HealthDevice* d = &devices[index];
+    bool full = d->want_full;
+    d->want = false;
+    d->busy = true;
+    prober_current = index;
+    pthread_mutex_unlock(&probe_lock);
+    long long t0 = monotonic_us();
+    bool present;
+    dev_t dev;
+    int err = probe_device(d, full, &present, &dev);
+    long long elapsed = monotonic_us() - t0;
+    pthread_mutex_lock(&probe_lock);
+    d->busy = false;
+    if (gen != prober_gen) {
+        log_debug("[HEALTH] %s: abandoned probe returned after %lldms", d->path, elapsed / 1000);
+        return;
+    }
+    prober_current = -1;
+    d->done = true;
+    d->err = err;
+    d->elapsed_us = elapsed;
+    d->present = present;
+    d->dev = dev;
+    pthread_cond_broadcast(&done_cond);
+}
+
+static void* prober_main(void* arg) {
+    unsigned gen = (unsigned)(uintptr_t)arg;
+    pthread_mutex_lock(&probe_lock);
+    while (gen == prober_gen) {
+        int index = -1;
+        for (int i = 0; i < device_count && index < 0; i++) {
+            if (devices[i].want) index = i;
+        }
+        if (index < 0) pthread_cond_wait(&work_cond, &probe_lock);
+        else probe_one(index, gen);
+    }
+    pthread_mutex_unlock(&probe_lock);
+    return NULL;
+}
+
+// Caller holds probe_lock
+static bool start_prober(void) {
+    if (prober_alive) return true;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_attr_setstacksize(&attr, PROBER_STACK_SIZE);
+    pthread_t thread;
+    prober_alive = pthread_create(&thread, &attr, prober_main, (void*)(uintptr_t)prober_gen) == 0;
+    pthread_attr_destroy(&attr);
+    return prober_alive;
+}
+
+// Caller holds probe_lock
+static bool wait_done(const int* list, int count, long long deadline_us) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    long long wait = deadline_us - monotonic_us();
+    if (wait < 0) wait = 0;
+    ts.tv_sec += wait / 1000000;
+    ts.tv_nsec += (wait % 1000000) * 1000;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    while (true) {
+        bool all = true;
+        for (int i = 0; i < count && all; i++) all = devices[list[i]].done;
+        if (all) return true;
+        if (pthread_cond_timedwait(&done_cond, &probe_lock, &ts) == ETIMEDOUT) return false;
+    }
+}
+
+// Caller holds probe_lock. Probes the listed drives, each bounded by
+// HEALTH_PROBE_TIMEOUT_US; timed_out[k] tells which did not answer.
+static void run_probes(const int* list, int count, bool full, bool* timed_out) {
+    int waiting[HEALTH_MAX_DEVICES], left = 0;
+    for (int k = 0; k < count; k++) {
+        struct HealthDevice* d = &devices[list[k]];
+        // Still stuck under an abandoned prober or walk
+        bool stuck = d->busy || d->stalled_walks > 0;
+        timed_out[k] = stuck;
+        d->done = stuck;
+        if (stuck) continue;
+        d->want = true;
+        d->want_full = full;
+        waiting[left++] = list[k];
+    }
+    while (left > 0) {
+        if (!start_prober()) {
+            // No thread to spare: probe unbounded rather than not at all
+            for (int k = 0; k < left; k++) {
+                if (!devices[waiting[k]].done) probe_one(waiting[k], prober_gen);
+            }
+            return;
+        }
+        // An abandoned prober still waiting here only wakes up to exit
+        pthread_cond_broadcast(&work_cond);
+        if (wait_done(waiting, left, monotonic_us() + HEALTH_PROBE_TIMEOUT_US)) return;
+
+        // The prober is stuck on prober_current (or never got to run):
+        // leave it there and let a fresh one take the rest
+        int stuck = prober_current;
+        prober_gen++;
+        prober_alive = false;
+        prober_current = -1;
+        int kept = 0;
+        for (int k = 0; k < left; k++) {
+            struct HealthDevice* d = &devices[waiting[k]];
+            if (d->done) continue;
+            if (stuck < 0 || waiting[k] == stuck) {
+                d->want = false;
+                d->done = true;
+                for (int j = 0; j < count; j++) {
+                    if (list[j] == waiting[k]) timed_out[j] = true;
+                }
+            } else {
+                waiting[kept++] = waiting[k];
+            }
+        }
+        left = kept;
+    }
+}
+
+// --- STATE ---
+// Caller holds probe_lock; returns whether the state changed
+static bool apply_result(struct HealthDevice* d, bool timed_out, bool full) {
+    long long now = monotonic_us();
+    int old = d->state, state;
+    d->probed = true;
+    if (timed_out) {
+        state = HEALTH_DEAD;
+        log_debug("[HEALTH] %s: no answer within %lldms", d->path, (long long)HEALTH_PROBE_TIMEOUT_US / 1000);
+    } else if (d->err != 0) {
+        state = HEALTH_DEAD;
+        log_debug("[HEALTH] %s: probe failed: %s", d->path, strerror(d->err));
+    } else {
+        state = d->elapsed_us >= HEALTH_SLOW_US ? HEALTH_SLOW : HEALTH_OK;
+        if (state == HEALTH_SLOW) stats_add(STAT_SLOW_PROBES, 1);
+        if (full) d->vouched_until = now + HEALTH_FRESH_US;
+    }
+
+    if (state == HEALTH_DEAD) {
+        d->vouched_until = 0;
+        d->next_due = now + d->backoff;
+        if (old == HEALTH_DEAD) d->backoff = d->backoff * 2 < HEALTH_MAX_BACKOFF_US ? d->backoff * 2 : HEALTH_MAX_BACKOFF_US;
+    } else {
+        d->backoff = HEALTH_MIN_BACKOFF_US;
+    }
+    if (state == old) return false;
+    __atomic_store_n(&d->state, state, __ATOMIC_RELEASE);
+    if (state == HEALTH_DEAD) {
+        d->quarantine_pending = true;
+    } else if (old == HEALTH_DEAD) {
+        log_debug("[HEALTH] %s answered in %lldms, re-admitted", d->path, d->elapsed_us / 1000);
+    } else {
+        log_debug("[HEALTH] %s is %s (%lldms)", d->path, state_names[state], d->elapsed_us / 1000);
+    }
+    return true;
+}
+
+// Caller holds probe_lock
+static int probe_and_apply(const int* list, int count, bool full) {
+    bool timed_out[HEALTH_MAX_DEVICES];
+    run_probes(list, count, full, timed_out);
+    int changed = 0;
+    for (int k = 0; k < count; k++) {
+        if (apply_result(&devices[list[k]], timed_out[k], full)) changed++;
+    }
+    return changed;
+}
+
+int health_check(void) {
+    long long now = monotonic_us();
+    int list[HEALTH_MAX_DEVICES], count = 0;
+    pthread_mutex_lock(&round_lock);
+    pthread_mutex_lock(&probe_lock);
+    for (int i = 0; i < device_count; i++) {
+        struct HealthDevice* d = &devices[i];
+        if (d->busy) continue;
+        if (!d->probed || (d->state == HEALTH_DEAD && now >= d->next_due)) list[count++] = i;
+    }
+    bool was_dead[HEALTH_MAX_DEVICES];
+    for (int k = 0; k < count; k++) was_dead[k] = devices[list[k]].state == HEALTH_DEAD;
+    int changed = count > 0 ? probe_and_apply(list, count, true) : 0;
+
+    int went_dead[HEALTH_MAX_DEVICES], dead_count = 0;
+    for (int i = 0; i < device_count; i++) {
+        if (!devices[i].quarantine_pending) continue;
+        devices[i].quarantine_pending = false;
+        went_dead[dead_count++] = i;
+    }
+    pthread_mutex_unlock(&probe_lock);
+    pthread_mutex_unlock(&round_lock);
+
+    // Only the nullfs mounts are touched, never the drive itself
+    for (int k = 0; k < dead_count; k++) {
+        struct HealthDevice* d = &devices[went_dead[k]];
+        int unmounted = devmap_quarantine(d->path);
+        stats_add(STAT_DRIVE_QUARANTINES, 1);
+        log_debug("[HEALTH] %s quarantined, %d title(s) unmounted, next probe in %llds",
+                  d->path, unmounted, d->backoff / 1000000);
+        notify_system("%s is not responding\nIts games are unavailable until it recovers.", d->path);
+    }
+    // Games added or left half-installed while it was out are found by a rescan
+    for (int k = 0; k < count; k++) {
+        struct HealthDevice* d = &devices[list[k]];
+        if (!was_dead[k] || d->state == HEALTH_DEAD) continue;
+        for (int r = 0; r < d->root_count; r++) watcher_queue(SCAN_PATHS[d->roots[r]], 0);
+    }
+    return changed;
+}
+
+bool health_ready(const char* path) {
+    char key[64];
+    devmap_device_of(path, key, sizeof(key));
+    pthread_mutex_lock(&round_lock);
+    pthread_mutex_lock(&probe_lock);
+    struct HealthDevice* d = find_device(key);
+    bool ready = true;
+    if (d) {
+        if (d->state != HEALTH_DEAD && monotonic_us() >= d->vouched_until) {
+            int index = (int)(d - devices);
+            probe_and_apply(&index, 1, true);
+        }
+        ready = d->state != HEALTH_DEAD;
+    }
+    pthread_mutex_unlock(&probe_lock);
+    pthread_mutex_unlock(&round_lock);
+    return ready;
+}
+
+bool health_presence(const char* device, bool* present, dev_t* dev) {
+    pthread_mutex_lock(&round_lock);
+    pthread_mutex_lock(&probe_lock);
+    struct HealthDevice* d = find_device(device);
+    if (d) {
+        if (d->state != HEALTH_DEAD) {
+            int index = (int)(d - devices);
+            probe_and_apply(&index, 1, false);
+        }
+        *present = d->state != HEALTH_DEAD && d->present;
+        *dev = *present ? d->dev : 0;
+    }
+    pthread_mutex_unlock(&probe_lock);
+    pthread_mutex_unlock(&round_lock);
+    return d != NULL;
+}
+
+bool health_usable(const char* path) {
+    char key[64];
+    devmap_device_of(path, key, sizeof(key));
+    struct HealthDevice* d = find_device(key);
+    return !d || __atomic_load_n(&d->state, __ATOMIC_ACQUIRE) != HEALTH_DEAD;
+}
+
+void health_walk_stalled(const char* path) {
+    char key[64];
+    devmap_device_of(path, key, sizeof(key));
+    pthread_mutex_lock(&probe_lock);
+    struct HealthDevice* d = find_device(key);
+    if (d) {
+        d->stalled_walks++;
+        if (d->state != HEALTH_DEAD) {
+            log_debug("[HEALTH] %s: a scan walk stopped answering", d->path);
+            d->probed = true;
+            d->vouched_until = 0;
+            d->next_due = monotonic_us() + d->backoff;
+            __atomic_store_n(&d->state, HEALTH_DEAD, __ATOMIC_RELEASE);
+            d->quarantine_pending = true;
+        }
+    }
+    pthread_mutex_unlock(&probe_lock);
+}
+
+void health_walk_returned(const char* path) {
+    char key[64];
+    devmap_device_of(path, key, sizeof(key));
+    pthread_mutex_lock(&probe_lock);
+    struct HealthDevice* d = find_device(key);
+    if (d && d->stalled_walks > 0) d->stalled_walks--;
+    pthread_mutex_unlock(&probe_lock);
+}
+
+long long health_next_due_us(void) {
+    long long now = monotonic_us(), wait = -1;
+    pthread_mutex_lock(&probe_lock);
+    for (int i = 0; i < device_count; i++) {
+        struct HealthDevice* d = &devices[i];
+        long long w;
+        if (d->quarantine_pending) w = 0;
+        else if (d->state != HEALTH_DEAD) continue;
+        // A probe still stuck there holds the next one back
+        else if (d->busy) w = HEALTH_MIN_BACKOFF_US;
+        else w = d->next_due - now;
+        if (wait < 0 || w < wait) wait = w;
+    }
+    pthread_mutex_unlock(&probe_lock);
+    if (wait < 0) return -1;
+    return wait > 0 ? wait : 0;
+}
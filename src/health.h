@@ -0,0 +1,70 @@
+#ifndef HEALTH_H
+#define HEALTH_H
+
+#include <stdbool.h>
+#include <sys/types.h>
+
+// --- DRIVE HEALTH ---
+// Every drive folder holding a scan root (/data, /mnt/usb0, ...) is probed
+// on one long-lived prober thread, and the caller waits at most
+// HEALTH_PROBE_TIMEOUT_US for the answer. A full probe (a stat of the
+// folder, then a stat and the first directory read of each of its roots)
+// runs just before the daemon walks a drive, unless one answered within
+// HEALTH_FRESH_US; presence checks only stat the folder. Healthy drives are
+// never probed on a timer, so an idle daemon leaves them alone.
+//
+// A slow answer marks the drive slow; a missed deadline or an I/O error
+// marks it dead. A dead drive is quarantined by the next health_check():
+// its roots are no longer scanned or checked, and the titles mounted from
+// it are unmounted. It is probed again after a backoff that doubles up to
+// HEALTH_MAX_BACKOFF_US, and an answer in time re-admits it and queues its
+// roots for a rescan. A prober stuck
+// in the kernel is abandoned to its drive and a new one takes over.
+// A scan walk that stops making progress is abandoned the same way (see
+// scan.c): health_walk_stalled() marks its drive dead, and the drive is
+// not re-admitted before health_walk_returned() says the walk came back.
+//
+// health_check() belongs to the main thread. The other calls are
+// thread-safe; probes asked for by several threads run one after another.
+
+#define HEALTH_MAX_DEVICES      16
+#define HEALTH_PROBE_TIMEOUT_US 2000000
+#define HEALTH_SLOW_US          500000
+#define HEALTH_FRESH_US         2000000     // A full probe vouches for a drive this long
+#define HEALTH_MIN_BACKOFF_US   10000000    // Dead drives
+#define HEALTH_MAX_BACKOFF_US   600000000
+
+enum health_state {
+    HEALTH_OK,
+    HEALTH_SLOW,        // Answered, but past HEALTH_SLOW_US; still used
+    HEALTH_DEAD,        // Quarantined
+};
+
+// Registers the drive folders of SCAN_PATHS
+void health_init(void);
+
+// Probes the drives never probed and the dead ones whose backoff ran out,
+// quarantines drives found dead since the last call and re-admits
+// recovered ones. Returns the number of drives that changed state.
+int health_check(void);
+
+// Call before walking or reading below path: false when its drive is
+// quarantined or does not answer a full probe in time
+bool health_ready(const char* path);
+
+// Bounded stat of a drive folder: present (and its st_dev) as answered,
+// not present while quarantined. False when the device is not watched.
+bool health_presence(const char* device, bool* present, dev_t* dev);
+
+// False while the drive holding path is quarantined. Thread-safe, no I/O.
+bool health_usable(const char* path);
+
+// A walk below path was left behind in the kernel: its drive is dead until
+// the walk returns, and the next health_check() quarantines it
+void health_walk_stalled(const char* path);
+void health_walk_returned(const char* path);
+
+// Microseconds until health_check() has work (-1 = none)
+long long health_next_due_us(void);
+
+#endif
@@ -0,0 +1,262 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "shadowmount.h"
+#include "index.h"
+#include "arena.h"
+#include "util.h"
+
+// On-disk layout (native endian, written/read by the same console): the
+// record file header (util.h), then per title
+//   record: dev u64 | ino u64 | dir_mtime i64 | param_size i64 | param_mtime i64 |
+//           last_seen i64 | flags u8 | id_len u8 | name_len u16 | id | name
+#define INDEX_RECORD_FIXED  52
+#define INDEX_FLAG_DRM_FIXED 0x01
+#define INDEX_MAX_FILE      (16 * 1024 * 1024)
+
+struct IndexEntry {
+    uint64_t dev;
+    uint64_t ino;
+    int64_t dir_mtime;
+    int64_t param_size;
+    int64_t param_mtime;
+    int64_t last_seen;
+    uint8_t flags;
+    char title_id[MAX_TITLE_ID];
+    const char* title_name;     // Interned
+};
+
+static struct IndexEntry* entries = NULL;
+static uint32_t entry_count = 0;
+static uint32_t entry_capacity = 0;
+
+// Open addressing table of (entry index + 1), 0 = empty slot
+static uint32_t* slots = NULL;
+static uint32_t slot_count = 0;
+
+// Scan workers look up and store concurrently
+static pthread_mutex_t index_lock = PTHREAD_MUTEX_INITIALIZER;
+static bool index_dirty = false;
+static int pass_hits = 0;
+static int pass_misses = 0;
+
+static int64_t mtime_ns(const struct stat* st) {
+    return (int64_t)st->st_mtim.tv_sec * 1000000000LL + st->st_mtim.tv_nsec;
+}
+
+static uint32_t key_hash(uint64_t dev, uint64_t ino) {
+    uint64_t h = dev * 0x9E3779B97F4A7C15ULL ^ ino;
+    h ^= h >> 33; h *= 0xFF51AFD7ED558CCDULL; h ^= h >> 33;
+    return (uint32_t)h;
+}
+
+static uint32_t entry_hash(uint32_t i) {
+    return key_hash(entries[i].dev, entries[i].ino);
+}
+
+static void rebuild_slots(void) {
+    uint32_t n = 0;
+    uint32_t* fresh = slots_build(entry_count, &n, entry_hash);
+    // Out of memory: after index_save() compacted the entries the old table
+    // points at the wrong ones, so go without one until the next add
+    free(slots);
+    slots = fresh;
+    slot_count = fresh ? n : 0;
+}
+
+static struct IndexEntry* find_entry(uint64_t dev, uint64_t ino) {
+    if (!slots) return NULL;
+    uint32_t s = key_hash(dev, ino) & (slot_count - 1);
+    while (slots[s]) {
+        struct IndexEntry* e = &entries[slots[s] - 1];
+        if (e->dev == dev && e->ino == ino) return e;
+        s = (s + 1) & (slot_count - 1);
+    }
+    return NULL;
+}
+
+static struct IndexEntry* add_entry(uint64_t dev, uint64_t ino) {
+    if (entry_count == entry_capacity) {
+        uint32_t cap = entry_capacity ? entry_capacity * 2 : 256;
+        struct IndexEntry* grown = (struct IndexEntry*)realloc(entries, cap * sizeof(*entries));
+        if (!grown) return NULL;
+        entries = grown;
+        entry_capacity = cap;
+    }
+    struct IndexEntry* e = &entries[entry_count++];
+    memset(e, 0, sizeof(*e));
+    e->dev = dev;
+    e->ino = ino;
+    // Keep load factor under 50%
+    if (entry_count * 2 > slot_count) {
+        rebuild_slots();
+    } else {
+        slots_insert(slots, slot_count, key_hash(dev, ino), entry_count - 1);
+    }
+    return e;
+}
+
+bool index_lookup(const struct stat* dir_st, const struct stat* param_st,
+                  char* out_id, char* out_name) {
+    pthread_mutex_lock(&index_lock);
+    struct IndexEntry* e = find_entry((uint64_t)dir_st->st_dev, (uint64_t)dir_st->st_ino);
+    if (!e || e->dir_mtime != mtime_ns(dir_st) ||
+        e->param_size != (int64_t)param_st->st_size || e->param_mtime != mtime_ns(param_st)) {
+        pass_misses++;
+        pthread_mutex_unlock(&index_lock);
+        return false;
+    }
+    snprintf(out_id, MAX_TITLE_ID, "%s", e->title_id);
+    snprintf(out_name, MAX_TITLE_NAME, "%s", e->title_name);
+    e->last_seen = (int64_t)time(NULL);
+    pass_hits++;
+    pthread_mutex_unlock(&index_lock);
+    return true;
+}
+
+void index_store(const struct stat* dir_st, const struct stat* param_st,
+                 const char* title_id, const char* title_name, bool drm_fixed) {
+    uint64_t dev = (uint64_t)dir_st->st_dev, ino = (uint64_t)dir_st->st_ino;
+    const char* name = intern_str(title_name);
+    if (!name) return;
+    pthread_mutex_lock(&index_lock);
+    struct IndexEntry* e = find_entry(dev, ino);
+    if (!e) e = add_entry(dev, ino);
+    if (!e) { pthread_mutex_unlock(&index_lock); return; }
+    e->dir_mtime = mtime_ns(dir_st);
+    e->param_size = (int64_t)param_st->st_size;
+    e->param_mtime = mtime_ns(param_st);
+    e->last_seen = (int64_t)time(NULL);
+    e->flags = drm_fixed ? INDEX_FLAG_DRM_FIXED : 0;
+    snprintf(e->title_id, sizeof(e->title_id), "%s", title_id);
+    e->title_name = name;
+    index_dirty = true;
+    pthread_mutex_unlock(&index_lock);
+}
+
+void index_foreach_title(index_visit_fn fn, void* ctx) {
+    pthread_mutex_lock(&index_lock);
+    for (uint32_t i = 0; i < entry_count; i++) fn(entries[i].title_id, entries[i].title_name, ctx);
+    pthread_mutex_unlock(&index_lock);
+}
+
+bool index_is_dirty(void) {
+    return index_dirty;
+}
+
+void index_reset_pass_stats(void) {
+    pass_hits = 0;
+    pass_misses = 0;
+}
+
+void index_get_pass_stats(int* hits, int* misses) {
+    if (hits) *hits = pass_hits;
+    if (misses) *misses = pass_misses;
+}
+
+// --- PERSISTENCE ---
+bool index_load(const char* path) {
+    uint32_t count, payload_len;
+    uint8_t* buf = record_file_load(path, "[INDEX]", INDEX_MAGIC, INDEX_VERSION, INDEX_MAX_FILE,
+                                    &count, &payload_len);
+    if (!buf) return false;
+    bool ok = false;
+
+    const uint8_t* p = buf + RECORD_HEADER_SIZE;
+    const uint8_t* end = p + payload_len;
+    for (uint32_t i = 0; i < count; i++) {
+        if (end - p < INDEX_RECORD_FIXED) goto out;
+        uint64_t dev, ino;
+        memcpy(&dev, p, 8);
+        memcpy(&ino, p + 8, 8);
+        uint8_t id_len = p[49];
+        uint16_t name_len;
+        memcpy(&name_len, p + 50, 2);
+        if (id_len >= MAX_TITLE_ID || name_len >= MAX_TITLE_NAME ||
+            end - p < INDEX_RECORD_FIXED + id_len + name_len) goto out;
+
+        char name[MAX_TITLE_NAME];
+        memcpy(name, p + INDEX_RECORD_FIXED + id_len, name_len);
+        name[name_len] = '\0';
+        const char* interned = intern_str(name);
+        if (!interned) goto out;
+        struct IndexEntry* e = find_entry(dev, ino);
+        if (!e) e = add_entry(dev, ino);
+        if (!e) goto out;
+        memcpy(&e->dir_mtime, p + 16, 8);
+        memcpy(&e->param_size, p + 24, 8);
+        memcpy(&e->param_mtime, p + 32, 8);
+        memcpy(&e->last_seen, p + 40, 8);
+        e->flags = p[48];
+        memcpy(e->title_id, p + INDEX_RECORD_FIXED, id_len);
+        e->title_id[id_len] = '\0';
+        e->title_name = interned;
+        p += INDEX_RECORD_FIXED + id_len + name_len;
+    }
+    ok = true;
+    index_dirty = false;
+    log_debug("[INDEX] Loaded %u title(s) from %s", entry_count, path);
+
+out:
+    if (!ok) {
+        // Never keep a partially decoded index
+        entry_count = 0;
+        if (slots) memset(slots, 0, slot_count * sizeof(uint32_t));
+    }
+    free(buf);
+    return ok;
+}
+
+// Crash-safe rewrite (record_file_save()); long unseen titles are dropped
+bool index_save(const char* path) {
+    pthread_mutex_lock(&index_lock);
+    int64_t now = (int64_t)time(NULL);
+    size_t cap = RECORD_HEADER_SIZE;
+    for (uint32_t i = 0; i < entry_count; i++)
+        cap += INDEX_RECORD_FIXED + strlen(entries[i].title_id) + strlen(entries[i].title_name);
+
+    uint8_t* buf = (uint8_t*)malloc(cap);
+    if (!buf) { pthread_mutex_unlock(&index_lock); return false; }
+
+    // Drop titles that have not been seen for a long time while serializing
+    uint8_t* p = buf + RECORD_HEADER_SIZE;
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < entry_count; i++) {
+        struct IndexEntry* e = &entries[i];
+        if (now - e->last_seen > INDEX_MAX_AGE_SEC) continue;
+        uint8_t id_len = (uint8_t)strlen(e->title_id);
+        uint16_t name_len = (uint16_t)strlen(e->title_name);
+        memcpy(p, &e->dev, 8);
+        memcpy(p + 8, &e->ino, 8);
+        memcpy(p + 16, &e->dir_mtime, 8);
+        memcpy(p + 24, &e->param_size, 8);
+        memcpy(p + 32, &e->param_mtime, 8);
+        memcpy(p + 40, &e->last_seen, 8);
+        p[48] = e->flags;
+        p[49] = id_len;
+        memcpy(p + 50, &name_len, 2);
+        memcpy(p + INDEX_RECORD_FIXED, e->title_id, id_len);
+        memcpy(p + INDEX_RECORD_FIXED + id_len, e->title_name, name_len);
+        p += INDEX_RECORD_FIXED + id_len + name_len;
+        entries[kept++] = *e;
+    }
+    if (kept != entry_count) {
+        entry_count = kept;
+        rebuild_slots();
+    }
+
+    bool ok = record_file_save(path, buf, (size_t)(p - buf), INDEX_MAGIC, INDEX_VERSION, kept);
+    if (!ok) {
+        log_debug("[INDEX] Failed to save %s: %s", path, strerror(errno));
+    } else {
+        index_dirty = false;
+    }
+    free(buf);
+    pthread_mutex_unlock(&index_lock);
+    return ok;
+}
@@ -0,0 +1,35 @@
+#ifndef INDEX_H
+#define INDEX_H
+
+#include <stdbool.h>
+#include <sys/stat.h>
+
+// --- LIBRARY INDEX ---
+// Persistent record of every parsed param.json, keyed by the game folder's
+// (device, inode). An entry is only trusted while the folder mtime and the
+// param.json size/mtime still match what was recorded.
+
+#define INDEX_MAGIC         0x58494D53u  // "SMIX"
+#define INDEX_VERSION       2   // 2: CRC32C checksum
+#define INDEX_MAX_AGE_SEC   (30 * 24 * 60 * 60) // Forget titles unseen for 30 days
+
+bool index_load(const char* path);
+bool index_save(const char* path);
+bool index_is_dirty(void);
+
+// Fills out_id/out_name (MAX_TITLE_ID/MAX_TITLE_NAME) on a valid hit.
+bool index_lookup(const struct stat* dir_st, const struct stat* param_st,
+                  char* out_id, char* out_name);
+void index_store(const struct stat* dir_st, const struct stat* param_st,
+                 const char* title_id, const char* title_name, bool drm_fixed);
+
+// Calls fn for every recorded title with the lock held (a title copied to
+// several folders is visited once per copy)
+typedef void (*index_visit_fn)(const char* title_id, const char* title_name, void* ctx);
+void index_foreach_title(index_visit_fn fn, void* ctx);
+
+// Per-pass hit/miss counters
+void index_reset_pass_stats(void);
+void index_get_pass_stats(int* hits, int* misses);
+
+#endif
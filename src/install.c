@@ -0,0 +1,467 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/mount.h>
+#include <sys/uio.h>
+
+#include <ps5/kernel.h>
+
+#include "shadowmount.h"
+#include "install.h"
+#include "copy.h"
+#include "stats.h"
+#include "mounts.h"
+#include "verify.h"
+#include "devmap.h"
+#include "arena.h"
+#include "iobuf.h"
+#include "sources.h"
+#include "assets.h"
+#include "journal.h"
+#include "util.h"
+
+// Compact: the source is an interned path, the name an interned string
+struct InstallJob {
+    path_id path;
+    char title_id[MAX_TITLE_ID];
+    const char* title_name;
+    bool is_remount;
+    bool mounted;
+    uint8_t stage;              // enum job_stage
+    uint8_t device;             // Pipeline device slot
+    long long mount_us;
+};
+
+static struct InstallJob* jobs = NULL;
+static int job_count = 0;
+static int job_capacity = 0;
+static pthread_mutex_t job_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// --- MOUNT HELPERS ---
+static int remount_system_ex(void) {
+    struct iovec iov[] = {
+        IOVEC_ENTRY("from"), IOVEC_ENTRY("/dev/ssd0.system_ex"),
+        IOVEC_ENTRY("fspath"), IOVEC_ENTRY("/system_ex"),
+        IOVEC_ENTRY("fstype"), IOVEC_ENTRY("exfatfs"),
+        IOVEC_ENTRY("large"), IOVEC_ENTRY("yes"),
+        IOVEC_ENTRY("timezone"), IOVEC_ENTRY("static"),
+        IOVEC_ENTRY("async"), IOVEC_ENTRY(NULL),
+        IOVEC_ENTRY("ignoreacl"), IOVEC_ENTRY(NULL)
+    };
+    long long t0 = monotonic_us();
+    int res = nmount(iov, IOVEC_SIZE(iov), MNT_UPDATE);
+    stats_record_us(HIST_NMOUNT, monotonic_us() - t0);
+    return res;
+}
+
+static int mount_nullfs(const char* src, const char* dst) {
+    struct iovec iov[] = {
+        IOVEC_ENTRY("fstype"), IOVEC_ENTRY("nullfs"),
+        IOVEC_ENTRY("from"), IOVEC_ENTRY(src),
+        IOVEC_ENTRY("fspath"), IOVEC_ENTRY(dst)
+    };
+    long long t0 = monotonic_us();
+    int res = nmount(iov, IOVEC_SIZE(iov), MNT_RDONLY);
+    stats_record_us(HIST_NMOUNT, monotonic_us() - t0);
+    stats_add(res < 0 ? STAT_MOUNT_FAILURES : STAT_MOUNTS, 1);
+    return res;
+}
+
+bool install_read_tracker(const char* title_id, char* out, size_t size) {
+    char lnk_path[MAX_PATH];
+    snprintf(lnk_path, sizeof(lnk_path), "/user/app/%s/mount.lnk", title_id);
+    FILE* f = fopen(lnk_path, "r");
+    if (!f) return false;
+    if (!fgets(out, (int)size, f)) out[0] = '\0';
+    fclose(f);
+    out[strcspn(out, "\r\n")] = '\0';
+    return out[0] != '\0';
+}
+
+bool wait_for_registration(const char* title_id, int timeout_ms) {
+    char path[MAX_PATH];
+    snprintf(path, sizeof(path), "/user/appmeta/%s", title_id);
+    long long t0 = monotonic_us();
+    long long deadline = t0 + (long long)timeout_ms * 1000;
+    int delay_ms = REG_POLL_MIN_MS;
+    while (access(path, F_OK) != 0) {
+        if (monotonic_us() >= deadline) return false;
+        sceKernelUsleep(delay_ms * 1000);
+        delay_ms = delay_ms * 2 > REG_POLL_MAX_MS ? REG_POLL_MAX_MS : delay_ms * 2;
+    }
+    stats_record_us(HIST_REGISTER_READY, monotonic_us() - t0);
+    return true;
+}
+
+// --- MOUNT & INSTALL ---
+// /system_ex must already be remounted writable by the caller
+static bool mount_title(const char* src_path, const char* title_id) {
+    char system_ex_app[MAX_PATH];
+    snprintf(system_ex_app, sizeof(system_ex_app), "/system_ex/app/%s", title_id);
+    mkdir(system_ex_app, 0777);
+    unmount(system_ex_app, 0);
+    if (mount_nullfs(src_path, system_ex_app) < 0) {
+        log_debug("  [MOUNT] FAIL: %s: %s", title_id, strerror(errno));
+        return false;
+    }
+    mounts_note_mounted(title_id, src_path);
+    return true;
+}
+
+// Copies the registration files of a fresh install; runs on a copy worker
+static bool copy_title(const char* src_path, const char* title_id) {
+    char user_app_dir[sizeof("/user/app/") + MAX_TITLE_ID];
+    char user_sce_sys[MAX_PATH];
+    snprintf(user_app_dir, sizeof(user_app_dir), "/user/app/%s", title_id);
+    snprintf(user_sce_sys, sizeof(user_sce_sys), "%s/sce_sys", user_app_dir);
+    mkdir(user_app_dir, 0777);
+    mkdir(user_sce_sys, 0777);
+    mounts_note_installed(title_id);
+    if (journal_reached(title_id, JOURNAL_FILES)) return true;
+
+    struct CopyReport rep = {0};
+    int copy_res = assets_copy_minimal(src_path, title_id, &rep);
+
+    char icon_src[MAX_PATH], icon_dst[MAX_PATH];
+    int len = snprintf(icon_src, sizeof(icon_src), "%s/sce_sys/icon0.png", src_path);
+    snprintf(icon_dst, sizeof(icon_dst), "/user/app/%s/icon0.png", title_id);
+    if (len > 0 && (size_t)len < sizeof(icon_src)) copy_file_sync(icon_src, icon_dst, &rep);
+    copy_log_report(title_id, &rep);
+
+    // Without param.json the title would register as broken
+    if (copy_res != 0 && check_installation_integrity(title_id) != 0) {
+        log_debug("  [COPY] FAIL: %s: param.json missing, not registering", title_id);
+        return false;
+    }
+    journal_step(title_id, JOURNAL_FILES);
+    journal_fault("files");
+    return true;
+}
+
+// Writes the tracker and registers a mounted (and, when fresh, copied)
+// title; the rest of sce_sys follows in the background
+static bool register_title(const char* src_path, const char* title_id, const char* title_name,
+                           bool is_remount, bool toast, long long t_start) {
+    if (is_remount) log_debug("  [SPEED] Skipping file copy (Assets already exist)");
+
+    // WRITE TRACKER
+    if (!journal_reached(title_id, JOURNAL_TRACKER)) {
+        // Recovery and every mount.lnk reader trust the journaled step
+        char lnk_path[sizeof("/user/app//mount.lnk") + MAX_TITLE_ID];
+        snprintf(lnk_path, sizeof(lnk_path), "/user/app/%s/mount.lnk", title_id);
+        if (!write_file_atomic(lnk_path, src_path, strlen(src_path), true)) {
+            log_debug("  [REG] FAIL: %s: mount.lnk not written: %s", title_id, strerror(errno));
+            return false;
+        }
+        journal_step(title_id, JOURNAL_TRACKER);
+        journal_fault("tracker");
+    }
+    devmap_note(title_id, title_name, src_path);
+
+    // REGISTER
+    long long t_reg = monotonic_us();
+    int res = sceAppInstUtilAppInstallTitleDir(title_id, "/user/app/", 0);
+    stats_record_us(HIST_REGISTER, monotonic_us() - t_reg);
+    journal_fault("register");
+    stats_add(res == 0 || res == 0x80990002 ? STAT_REGISTRATIONS : STAT_REGISTRATION_FAILURES, 1);
+    if (res == 0 || res == 0x80990002) {
+        if (!wait_for_registration(title_id, REG_READY_TIMEOUT_MS)) {
+            log_debug("  [REG] %s not visible after %dms, continuing", title_id, REG_READY_TIMEOUT_MS);
+        }
+    }
+    log_debug("  [REG] %s ready %lldms after mount start", title_id, (monotonic_us() - t_start) / 1000);
+    if (!is_remount) {
+        stats_record_us(HIST_INSTALL, monotonic_us() - t_start);
+        // A title that failed to register gets no background copy either
+        if (res == 0 || res == 0x80990002) assets_defer(title_id);
+    }
+
+    if (res == 0) {
+        log_debug("  [REG] Installed NEW!");
+        if (toast) trigger_rich_toast(title_id, title_name, "Installed");
+    }
+    else if (res == 0x80990002) {
+        log_debug("  [REG] Restored.");
+    }
+    else {
+        log_debug("  [REG] FAIL: 0x%x", res);
+        return false;
+    }
+    return true;
+}
+
+// --- PIPELINE ---
+// After the mount pass, copy workers take the fresh installs in queue
+// order, at most INSTALL_COPY_PER_DEVICE per source drive, while the
+// flushing thread registers whichever title is copied first.
+enum job_stage {
+    JOB_WAITING,        // Fresh install, not copied yet
+    JOB_COPYING,
+    JOB_COPIED,         // Ready to register (remounts start here)
+    JOB_FAILED,
+    JOB_DONE,
+};
+
+struct Pipeline {
+    struct InstallJob* jobs;
+    int count;
+    int first_waiting;                  // No JOB_WAITING job before this one
+    char devices[DEVMAP_MAX_DEVICES][64];
+    int device_busy[DEVMAP_MAX_DEVICES];
+    int device_count;
+    int workers;
+    long long copy_us;                  // Summed over the workers
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+};
+
+static int pipeline_device(struct Pipeline* p, const char* src_path) {
+    char key[64];
+    devmap_device_of(src_path, key, sizeof(key));
+    for (int d = 0; d < p->device_count; d++) {
+        if (strcmp(p->devices[d], key) == 0) return d;
+    }
+    // Past the limit, the remaining drives share the last slot
+    if (p->device_count == DEVMAP_MAX_DEVICES) return DEVMAP_MAX_DEVICES - 1;
+    snprintf(p->devices[p->device_count], sizeof(p->devices[0]), "%s", key);
+    return p->device_count++;
+}
+
+// Caller holds p->lock. Returns the next job whose drive has a free copy
+// slot, -1 if none; *any_waiting tells whether copies are still to come.
+static int pipeline_take(struct Pipeline* p, bool* any_waiting) {
+    *any_waiting = false;
+    while (p->first_waiting < p->count && p->jobs[p->first_waiting].stage != JOB_WAITING) p->first_waiting++;
+    for (int i = p->first_waiting; i < p->count; i++) {
+        struct InstallJob* j = &p->jobs[i];
+        if (j->stage != JOB_WAITING) continue;
+        *any_waiting = true;
+        if (p->device_busy[j->device] >= INSTALL_COPY_PER_DEVICE) continue;
+        j->stage = JOB_COPYING;
+        p->device_busy[j->device]++;
+        return i;
+    }
+    return -1;
+}
+
+// Caller holds p->lock; drops it while copying
+static void pipeline_copy(struct Pipeline* p, int index) {
+    struct InstallJob* j = &p->jobs[index];
+    char path[MAX_PATH];
+    pthread_mutex_unlock(&p->lock);
+    long long t0 = monotonic_us();
+    bool ok = path_get(j->path, path, sizeof(path)) && copy_title(path, j->title_id);
+    long long elapsed = monotonic_us() - t0;
+    pthread_mutex_lock(&p->lock);
+    p->copy_us += elapsed;
+    p->device_busy[j->device]--;
+    j->stage = ok ? JOB_COPIED : JOB_FAILED;
+    pthread_cond_broadcast(&p->cond);
+}
+
+static void* copy_worker(void* arg) {
+    struct Pipeline* p = (struct Pipeline*)arg;
+    pthread_mutex_lock(&p->lock);
+    while (true) {
+        bool any_waiting;
+        int index = pipeline_take(p, &any_waiting);
+        if (index >= 0) pipeline_copy(p, index);
+        else if (!any_waiting) break;
+        else pthread_cond_wait(&p->cond, &p->lock);
+    }
+    pthread_mutex_unlock(&p->lock);
+    return NULL;
+}
+
+// Next job to register, in queue order among the ready ones; copies inline
+// when no worker is running. -1 once every job is done.
+static int pipeline_next(struct Pipeline* p) {
+    pthread_mutex_lock(&p->lock);
+    int next = -1;
+    while (true) {
+        bool pending = false;
+        for (int i = 0; i < p->count && next < 0; i++) {
+            int stage = p->jobs[i].stage;
+            if (stage == JOB_COPIED || stage == JOB_FAILED) next = i;
+            else if (stage != JOB_DONE) pending = true;
+        }
+        if (next >= 0 || !pending) break;
+        bool any_waiting;
+        int index = p->workers == 0 ? pipeline_take(p, &any_waiting) : -1;
+        if (index >= 0) pipeline_copy(p, index);
+        else pthread_cond_wait(&p->cond, &p->lock);
+    }
+    pthread_mutex_unlock(&p->lock);
+    return next;
+}
+
+// --- BATCH ---
+// A title seen on two drives in the same pass may be queued twice (the
+// faster copy takes over the claim): keep the copy sources_prefer() favours.
+// Returns the number of jobs left at the front of batch.
+static int drop_duplicates(struct InstallJob* batch, int count) {
+    uint32_t n = 16;
+    while (n < (uint32_t)count * 2) n *= 2;
+    int* table = (int*)malloc(n * sizeof(int));
+    if (!table) return count;
+    memset(table, 0xFF, n * sizeof(int));
+    char a[MAX_PATH], b[MAX_PATH];
+    for (int i = 0; i < count; i++) {
+        uint32_t s = str_hash(batch[i].title_id) & (n - 1);
+        while (table[s] >= 0 && strcmp(batch[table[s]].title_id, batch[i].title_id) != 0) s = (s + 1) & (n - 1);
+        if (table[s] < 0) { table[s] = i; continue; }
+        struct InstallJob* kept = &batch[table[s]];
+        if (path_get(batch[i].path, a, sizeof(a)) && path_get(kept->path, b, sizeof(b)) && sources_prefer(a, b)) {
+            kept->path = batch[i].path;
+            kept->title_name = batch[i].title_name;
+        }
+        log_debug("[BATCH] %s queued twice, mounting %s", batch[i].title_id, path_get(kept->path, a, sizeof(a)) ? a : "?");
+        batch[i].path = 0;
+    }
+    free(table);
+    int left = 0;
+    for (int i = 0; i < count; i++) {
+        if (batch[i].path) batch[left++] = batch[i];
+    }
+    return left;
+}
+
+void install_queue(const char* src_path, const char* title_id, const char* title_name, bool is_remount) {
+    pthread_mutex_lock(&job_lock);
+    if (job_count == job_capacity) {
+        int cap = job_capacity ? job_capacity * 2 : 16;
+        struct InstallJob* grown = (struct InstallJob*)realloc(jobs, cap * sizeof(*jobs));
+        if (!grown) {
+            pthread_mutex_unlock(&job_lock);
+            log_debug("[BATCH] Out of memory, dropping %s", title_id);
+            return;
+        }
+        jobs = grown;
+        job_capacity = cap;
+    }
+    struct InstallJob* j = &jobs[job_count];
+    j->path = path_intern(src_path);
+    j->title_name = intern_str(title_name);
+    if (!j->path || !j->title_name) {
+        pthread_mutex_unlock(&job_lock);
+        log_debug("[BATCH] Out of memory, dropping %s", title_id);
+        return;
+    }
+    job_count++;
+    snprintf(j->title_id, sizeof(j->title_id), "%s", title_id);
+    j->is_remount = is_remount;
+    j->mounted = false;
+    pthread_mutex_unlock(&job_lock);
+}
+
+int install_flush(int* installed, int* mounted) {
+    // Take the whole batch; workers may queue into a fresh one meanwhile
+    pthread_mutex_lock(&job_lock);
+    struct InstallJob* batch = jobs;
+    int count = job_count;
+    jobs = NULL;
+    job_count = job_capacity = 0;
+    pthread_mutex_unlock(&job_lock);
+    if (count == 0) return 0;
+    if (count > 1) count = drop_duplicates(batch, count);
+
+    long long t0 = monotonic_us();
+    if (remount_system_ex() < 0) {
+        log_debug("[BATCH] /system_ex remount failed: %s", strerror(errno));
+    }
+
+    // Every title is in the journal before anything is touched
+    char path[MAX_PATH], current[MAX_PATH];
+    for (int i = 0; i < count; i++) {
+        struct InstallJob* j = &batch[i];
+        if (path_get(j->path, path, sizeof(path))) journal_begin(j->title_id, j->title_name, path, j->is_remount);
+    }
+    journal_sync();
+    journal_fault("begin");
+
+    // Mount the whole batch first: known titles are playable before any
+    // asset copy or registration of the others has started
+    for (int i = 0; i < count; i++) {
+        struct InstallJob* j = &batch[i];
+        log_debug("[%s] %s", j->is_remount ? "MOUNT" : "INSTALL", j->title_name);
+        j->mount_us = monotonic_us();
+        if (!path_get(j->path, path, sizeof(path))) continue;
+        // Resumed after a crash: the mount may have survived it
+        if (journal_reached(j->title_id, JOURNAL_MOUNTED) &&
+            mounts_get_source(j->title_id, current, sizeof(current)) && strcmp(current, path) == 0) {
+            j->mounted = true;
+            continue;
+        }
+        j->mounted = mount_title(path, j->title_id);
+        journal_step(j->title_id, j->mounted ? JOURNAL_MOUNTED : JOURNAL_ABORT);
+        if (j->mounted) journal_fault("mounted");
+    }
+    long long t_mounted = monotonic_us();
+
+    struct Pipeline p;
+    memset(&p, 0, sizeof(p));
+    p.jobs = batch;
+    p.count = count;
+    pthread_mutex_init(&p.lock, NULL);
+    pthread_cond_init(&p.cond, NULL);
+    int fresh = 0, remounts = 0;
+    for (int i = 0; i < count; i++) {
+        struct InstallJob* j = &batch[i];
+        j->stage = !j->mounted ? JOB_DONE : j->is_remount ? JOB_COPIED : JOB_WAITING;
+        if (j->mounted && j->is_remount) remounts++;
+        if (j->stage != JOB_WAITING || !path_get(j->path, path, sizeof(path))) continue;
+        j->device = (uint8_t)pipeline_device(&p, path);
+        fresh++;
+    }
+    pthread_t workers[INSTALL_COPY_WORKERS];
+    for (int w = 0; w < INSTALL_COPY_WORKERS && w < fresh && fresh > 1; w++) {
+        if (pthread_create(&workers[p.workers], NULL, copy_worker, &p) == 0) p.workers++;
+    }
+
+    // One toast per title would bury the screen in a bulk import
+    int done = 0;
+    long long last_progress = t0, register_us = 0;
+    int index;
+    while ((index = pipeline_next(&p)) >= 0) {
+        struct InstallJob* j = &batch[index];
+        bool ok = j->stage == JOB_COPIED && path_get(j->path, path, sizeof(path));
+        pthread_mutex_lock(&p.lock);
+        j->stage = JOB_DONE;
+        pthread_mutex_unlock(&p.lock);
+        if (ok) {
+            long long t_reg = monotonic_us();
+            ok = register_title(path, j->title_id, j->title_name, j->is_remount, fresh == 1, j->mount_us);
+            register_us += monotonic_us() - t_reg;
+        }
+        journal_step(j->title_id, ok ? JOURNAL_DONE : JOURNAL_ABORT);
+        if (j->is_remount) {
+            if (ok) (*mounted)++;
+            continue;
+        }
+        done++;
+        if (ok) (*installed)++;
+        long long now = monotonic_us();
+        if (done < fresh && now - last_progress >= INSTALL_PROGRESS_US) {
+            notify_system("Installing games\n%d/%d installed", done, fresh);
+            last_progress = now;
+        }
+    }
+    for (int w = 0; w < p.workers; w++) pthread_join(workers[w], NULL);
+    pthread_cond_destroy(&p.cond);
+    pthread_mutex_destroy(&p.lock);
+
+    journal_sync();
+    free(batch);
+    // Copy buffers are only worth keeping while a batch runs
+    iobuf_trim();
+    long long total = monotonic_us() - t0;
+    if (fresh > 0) stats_record_us(HIST_BATCH, total);
+    log_debug("[BATCH] %d title(s) (%d new, %d remount) in %lldms, /system_ex remounted once: "
+              "mount %lldms, copy %lldms on %d worker(s), register %lldms",
+              count, fresh, remounts, total / 1000, (t_mounted - t0) / 1000, p.copy_us / 1000, p.workers, register_us / 1000);
+    return count;
+}
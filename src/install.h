@@ -0,0 +1,45 @@
+#ifndef INSTALL_H
+#define INSTALL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// --- MOUNT BATCH ---
+// Scan workers parse and only queue titles; the batch runs afterwards,
+// remounts /system_ex once for all of them and mounts every title. Then it
+// runs as a pipeline: copy workers (INSTALL_COPY_PER_DEVICE per source drive)
+// copy the registration files of fresh installs while the flushing thread
+// registers the titles already copied, one at a time. Registration waits
+// for the title to show up in /user/appmeta instead of sleeping a fixed time.
+// A bulk import reports "n/m installed" every INSTALL_PROGRESS_US instead of
+// one toast per title.
+//
+// Only the copy stage runs in parallel. The mounts are nullfs nmount()
+// calls under /system_ex, which the kernel serializes on its mount lock
+// anyway; the [BATCH] log times them separately. Registration goes through
+// sceAppInstUtilAppInstallTitleDir(), a request to the system's installer
+// service that handles one title at a time: concurrent calls would only
+// queue up there, and the polling in wait_for_registration() would then
+// run out its timeout on titles the service has not reached yet.
+
+#define REG_READY_TIMEOUT_MS    3000
+#define REG_POLL_MIN_MS         5
+#define REG_POLL_MAX_MS         50
+#define INSTALL_COPY_WORKERS    4
+#define INSTALL_COPY_PER_DEVICE 2
+#define INSTALL_PROGRESS_US     3000000
+
+// Thread-safe; titles are processed by the next install_flush()
+void install_queue(const char* src_path, const char* title_id, const char* title_name, bool is_remount);
+
+// Runs the queued batch; adds successful fresh installs / remounts to the
+// counters. Returns the number of titles that were in the batch.
+int install_flush(int* installed, int* mounted);
+
+// Reads the source path an installed title was last mounted from (mount.lnk)
+bool install_read_tracker(const char* title_id, char* out, size_t size);
+
+// Polls until the title is visible to the system (false on timeout)
+bool wait_for_registration(const char* title_id, int timeout_ms);
+
+#endif
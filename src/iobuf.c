@@ -0,0 +1,52 @@
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "iobuf.h"
+
+struct BufClass {
+    size_t size;
+    char* idle[IOBUF_KEEP];
+    int idle_count;
+};
+
+static struct BufClass classes[2] = { { IOBUF_SMALL, {0}, 0 }, { IOBUF_LARGE, {0}, 0 } };
+static pthread_mutex_t iobuf_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static struct BufClass* class_for(size_t size) {
+    return size <= IOBUF_SMALL ? &classes[0] : &classes[1];
+}
+
+char* iobuf_get(size_t size) {
+    if (size > IOBUF_LARGE) return NULL;
+    struct BufClass* c = class_for(size);
+    pthread_mutex_lock(&iobuf_lock);
+    char* buf = c->idle_count ? c->idle[--c->idle_count] : NULL;
+    pthread_mutex_unlock(&iobuf_lock);
+    if (buf) return buf;
+    void* p = NULL;
+    if (posix_memalign(&p, IOBUF_ALIGN, c->size) != 0) return NULL;
+    return (char*)p;
+}
+
+void iobuf_put(char* buf, size_t size) {
+    if (!buf) return;
+    struct BufClass* c = class_for(size);
+    pthread_mutex_lock(&iobuf_lock);
+    if (c->idle_count < IOBUF_KEEP) {
+        c->idle[c->idle_count++] = buf;
+        buf = NULL;
+    }
+    pthread_mutex_unlock(&iobuf_lock);
+    free(buf);
+}
+
+void iobuf_trim(void) {
+    char* drop[2 * IOBUF_KEEP];
+    int n = 0;
+    pthread_mutex_lock(&iobuf_lock);
+    for (int k = 0; k < 2; k++) {
+        while (classes[k].idle_count) drop[n++] = classes[k].idle[--classes[k].idle_count];
+    }
+    pthread_mutex_unlock(&iobuf_lock);
+    for (int i = 0; i < n; i++) free(drop[i]);
+}
@@ -0,0 +1,22 @@
+#ifndef IOBUF_H
+#define IOBUF_H
+
+#include <stddef.h>
+
+// --- I/O BUFFER POOL ---
+// Aligned copy/read buffers shared by the copy engine and the verifier, in
+// two sizes. Buffers returned during a mount batch are reused by the next
+// file instead of being mapped and unmapped every time; iobuf_trim() gives
+// them back to the system once the batch is done. Thread-safe.
+
+#define IOBUF_SMALL     (256 * 1024)
+#define IOBUF_LARGE     (1024 * 1024)
+#define IOBUF_ALIGN     4096
+#define IOBUF_KEEP      4       // Idle buffers kept per size
+
+// At least size bytes (size <= IOBUF_LARGE); NULL when out of memory
+char* iobuf_get(size_t size);
+void iobuf_put(char* buf, size_t size);   // Same size as passed to iobuf_get()
+void iobuf_trim(void);
+
+#endif
@@ -0,0 +1,462 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/mount.h>
+
+#include <ps5/kernel.h>
+
+#include "shadowmount.h"
+#include "journal.h"
+#include "health.h"
+#include "crc32c.h"
+#include "arena.h"
+#include "walk.h"
+#include "copy.h"
+#include "install.h"
+#include "mounts.h"
+#include "assets.h"
+#include "verify.h"
+#include "util.h"
+
+// On-disk layout (native endian):
+//   header: magic u32 | version u16 | reserved u16
+//   record: crc u32 | step u8 | id_len u8 | arg_len u16 | id | arg
+// crc covers everything after it; BEGIN args are "source\0title name".
+#define JOURNAL_HEADER_SIZE     8
+#define JOURNAL_RECORD_FIXED    8
+#define JOURNAL_MAX_SIZE        (16 * 1024 * 1024)
+#define JOURNAL_MIN_SLOTS       64
+
+struct JournalTitle {
+    char title_id[MAX_TITLE_ID];    // Empty: free slot
+    const char* title_name;         // Interned
+    path_id source;
+    bool remount;
+    bool open;
+    uint8_t step;                   // Furthest step recorded
+    uint8_t file_count;
+    const char* files[JOURNAL_MAX_FILES];   // Interned
+};
+
+// Open addressing on title_id. Closed titles stay until the journal is
+// emptied or compacted, which drops them from the table too.
+static struct JournalTitle* slots = NULL;
+static uint32_t slot_count = 0;     // Power of two
+static uint32_t used_count = 0;
+static int open_count = 0;
+static int journal_fd = -1;
+static off_t journal_size = 0;
+static pthread_mutex_t journal_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static const char* step_names[] = {
+    "?", "begin", "begin (remount)", "mounted", "file copied", "files copied", "tracker", "done", "abort",
+};
+
+// --- TABLE ---
+static struct JournalTitle* find(const char* title_id) {
+    if (!slot_count) return NULL;
+    uint32_t mask = slot_count - 1;
+    for (uint32_t s = str_hash(title_id) & mask;; s = (s + 1) & mask) {
+        if (!slots[s].title_id[0]) return NULL;
+        if (strcmp(slots[s].title_id, title_id) == 0) return &slots[s];
+    }
+}
+
+static bool grow(void) {
+    uint32_t n = slot_count ? slot_count * 2 : JOURNAL_MIN_SLOTS;
+    struct JournalTitle* fresh = (struct JournalTitle*)calloc(n, sizeof(*fresh));
+    if (!fresh) return false;
+    for (uint32_t i = 0; i < slot_count; i++) {
+        if (!slots[i].title_id[0]) continue;
+        uint32_t s = str_hash(slots[i].title_id) & (n - 1);
+        while (fresh[s].title_id[0]) s = (s + 1) & (n - 1);
+        fresh[s] = slots[i];
+    }
+    free(slots);
+    slots = fresh;
+    slot_count = n;
+    return true;
+}
+
+static struct JournalTitle* add(const char* title_id) {
+    struct JournalTitle* t = find(title_id);
+    if (t) return t;
+    if ((used_count + 1) * 2 > slot_count && !grow()) return NULL;
+    uint32_t mask = slot_count - 1;
+    uint32_t s = str_hash(title_id) & mask;
+    while (slots[s].title_id[0]) s = (s + 1) & mask;
+    t = &slots[s];
+    snprintf(t->title_id, sizeof(t->title_id), "%s", title_id);
+    used_count++;
+    return t;
+}
+
+// Applies one record to the table (replay and live). Returns false when
+// it changes nothing, so the live path need not write it.
+static bool apply(uint8_t step, const char* title_id, const char* arg, size_t arg_len) {
+    if (step == JOURNAL_BEGIN || step == JOURNAL_BEGIN_REMOUNT) {
+        size_t src_len = strnlen(arg, arg_len);
+        if (src_len == 0 || src_len >= MAX_PATH || src_len == arg_len) return false;
+        char source[MAX_PATH], name[MAX_TITLE_NAME];
+        memcpy(source, arg, src_len);
+        source[src_len] = '\0';
+        snprintf(name, sizeof(name), "%.*s", (int)(arg_len - src_len - 1), arg + src_len + 1);
+        path_id src = path_intern(source);
+        const char* interned = intern_str(name);
+        struct JournalTitle* t = add(title_id);
+        if (!t || !src || !interned) return false;
+        if (t->open && t->source == src) return false;
+        if (!t->open) open_count++;
+        t->open = true;
+        t->source = src;
+        t->title_name = interned;
+        t->remount = step == JOURNAL_BEGIN_REMOUNT;
+        t->step = step;
+        t->file_count = 0;
+        return true;
+    }
+
+    struct JournalTitle* t = find(title_id);
+    if (!t || !t->open) return false;
+    if (step == JOURNAL_DONE || step == JOURNAL_ABORT) {
+        t->open = false;
+        open_count--;
+    } else if (step == JOURNAL_FILE_COPIED) {
+        char name[MAX_PATH];
+        snprintf(name, sizeof(name), "%.*s", (int)arg_len, arg);
+        const char* interned = intern_str(name);
+        if (!interned) return false;
+        for (int i = 0; i < t->file_count; i++) {
+            if (t->files[i] == interned) return false;
+        }
+        if (t->file_count < JOURNAL_MAX_FILES) t->files[t->file_count++] = interned;
+    }
+    if (step > t->step) t->step = step;
+    return true;
+}
+
+// --- FILE ---
+#define JOURNAL_RECORD_MAX  (JOURNAL_RECORD_FIXED + MAX_TITLE_ID + MAX_PATH + MAX_TITLE_NAME)
+
+static size_t encode_header(uint8_t* out) {
+    uint32_t magic = JOURNAL_MAGIC;
+    uint16_t version = JOURNAL_VERSION, reserved = 0;
+    memcpy(out, &magic, 4);
+    memcpy(out + 4, &version, 2);
+    memcpy(out + 6, &reserved, 2);
+    return JOURNAL_HEADER_SIZE;
+}
+
+// Writes one record at r (JOURNAL_RECORD_MAX bytes); returns its length
+static size_t encode_record(uint8_t* r, uint8_t step, const char* title_id, const char* arg, size_t arg_len) {
+    uint8_t id_len = (uint8_t)strnlen(title_id, MAX_TITLE_ID - 1);
+    uint16_t arg16 = (uint16_t)arg_len;
+    r[4] = step;
+    r[5] = id_len;
+    memcpy(r + 6, &arg16, 2);
+    memcpy(r + JOURNAL_RECORD_FIXED, title_id, id_len);
+    if (arg_len) memcpy(r + JOURNAL_RECORD_FIXED + id_len, arg, arg_len);
+    size_t rec_len = JOURNAL_RECORD_FIXED + id_len + arg_len;
+    uint32_t crc = crc32c(0, r + 4, rec_len - 4);
+    memcpy(r, &crc, 4);
+    return rec_len;
+}
+
+// BEGIN argument: "source\0title name"; 0 when it does not fit
+static size_t begin_arg(char* out, size_t size, const char* source, const char* title_name) {
+    int len = snprintf(out, size, "%s%c%s", source, '\0', title_name);
+    return len < 0 || (size_t)len >= size ? 0 : (size_t)len;
+}
+
+// Caller holds journal_lock
+static void append(uint8_t step, const char* title_id, const char* arg, size_t arg_len) {
+    static bool warned = false;
+    if (journal_fd < 0) {
+        journal_fd = open(JOURNAL_FILE, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0666);
+        struct stat st;
+        journal_size = journal_fd >= 0 && fstat(journal_fd, &st) == 0 ? st.st_size : 0;
+    }
+    uint8_t rec[JOURNAL_HEADER_SIZE + JOURNAL_RECORD_MAX];
+    size_t len = journal_size == 0 ? encode_header(rec) : 0;
+    len += encode_record(rec + len, step, title_id, arg, arg_len);
+
+    if (journal_fd < 0 || !write_full(journal_fd, rec, len)) {
+        if (!warned) log_debug("[JOURNAL] Cannot write %s: %s", JOURNAL_FILE, strerror(errno));
+        warned = true;
+        return;
+    }
+    journal_size += (off_t)len;
+}
+
+// Replays the journal into the table; drops a torn tail
+static void load(void) {
+    int fd = open(JOURNAL_FILE, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return;
+    struct stat st;
+    uint8_t* buf = NULL;
+    bool ok = fstat(fd, &st) == 0 && st.st_size >= JOURNAL_HEADER_SIZE && st.st_size <= JOURNAL_MAX_SIZE &&
+              (buf = (uint8_t*)malloc((size_t)st.st_size)) != NULL &&
+              read(fd, buf, (size_t)st.st_size) == st.st_size;
+    close(fd);
+    uint32_t magic = 0;
+    uint16_t version = 0;
+    if (ok) {
+        memcpy(&magic, buf, 4);
+        memcpy(&version, buf + 4, 2);
+    }
+    if (!ok || magic != JOURNAL_MAGIC || version != JOURNAL_VERSION) {
+        if (st.st_size > 0) log_debug("[JOURNAL] Unreadable journal discarded");
+        free(buf);
+        unlink(JOURNAL_FILE);
+        return;
+    }
+
+    size_t pos = JOURNAL_HEADER_SIZE, end = (size_t)st.st_size;
+    int records = 0;
+    char title_id[MAX_TITLE_ID];
+    while (end - pos >= JOURNAL_RECORD_FIXED) {
+        const uint8_t* r = buf + pos;
+        uint32_t crc;
+        uint16_t arg_len;
+        memcpy(&crc, r, 4);
+        memcpy(&arg_len, r + 6, 2);
+        uint8_t id_len = r[5];
+        size_t rec_len = JOURNAL_RECORD_FIXED + id_len + arg_len;
+        if (id_len == 0 || id_len >= MAX_TITLE_ID || end - pos < rec_len ||
+            crc32c(0, r + 4, rec_len - 4) != crc) break;
+        memcpy(title_id, r + JOURNAL_RECORD_FIXED, id_len);
+        title_id[id_len] = '\0';
+        apply(r[4], title_id, (const char*)r + JOURNAL_RECORD_FIXED + id_len, arg_len);
+        pos += rec_len;
+        records++;
+    }
+    free(buf);
+    if (pos < end) {
+        log_debug("[JOURNAL] Dropping %zu byte(s) of a torn record", end - pos);
+        if (truncate(JOURNAL_FILE, (off_t)pos) != 0) unlink(JOURNAL_FILE);
+    }
+    log_debug("[JOURNAL] %d record(s), %d unfinished title(s)", records, open_count);
+}
+
+// --- RECORDING ---
+void journal_begin(const char* title_id, const char* title_name, const char* source, bool is_remount) {
+    char arg[MAX_PATH + MAX_TITLE_NAME];
+    size_t len = begin_arg(arg, sizeof(arg), source, title_name ? title_name : title_id);
+    if (len == 0) return;
+    uint8_t step = is_remount ? JOURNAL_BEGIN_REMOUNT : JOURNAL_BEGIN;
+    pthread_mutex_lock(&journal_lock);
+    if (apply(step, title_id, arg, len)) append(step, title_id, arg, len);
+    pthread_mutex_unlock(&journal_lock);
+}
+
+void journal_step(const char* title_id, enum journal_step step) {
+    pthread_mutex_lock(&journal_lock);
+    if (apply((uint8_t)step, title_id, NULL, 0)) append((uint8_t)step, title_id, NULL, 0);
+    pthread_mutex_unlock(&journal_lock);
+}
+
+void journal_file(const char* title_id, const char* name) {
+    size_t len = strlen(name);
+    pthread_mutex_lock(&journal_lock);
+    if (apply(JOURNAL_FILE_COPIED, title_id, name, len)) append(JOURNAL_FILE_COPIED, title_id, name, len);
+    pthread_mutex_unlock(&journal_lock);
+}
+
+bool journal_reached(const char* title_id, enum journal_step step) {
+    pthread_mutex_lock(&journal_lock);
+    struct JournalTitle* t = find(title_id);
+    bool reached = t && t->open && t->step >= step;
+    pthread_mutex_unlock(&journal_lock);
+    return reached;
+}
+
+bool journal_file_done(const char* title_id, const char* name) {
+    bool done = false;
+    pthread_mutex_lock(&journal_lock);
+    struct JournalTitle* t = find(title_id);
+    for (int i = 0; t && t->open && i < t->file_count && !done; i++) {
+        done = strcmp(t->files[i], name) == 0;
+    }
+    pthread_mutex_unlock(&journal_lock);
+    return done;
+}
+
+bool journal_is_open(const char* title_id) {
+    pthread_mutex_lock(&journal_lock);
+    struct JournalTitle* t = find(title_id);
+    bool open = t && t->open;
+    pthread_mutex_unlock(&journal_lock);
+    return open;
+}
+
+// Caller holds journal_lock. Rewrites the journal with only the records
+// that rebuild the open titles, so a title left open for good (its drive
+// gone) does not keep every later batch's records alive.
+static bool compact(void) {
+    size_t cap = JOURNAL_HEADER_SIZE + (size_t)open_count * (2 + JOURNAL_MAX_FILES) * JOURNAL_RECORD_MAX;
+    uint8_t* buf = (uint8_t*)malloc(cap);
+    struct JournalTitle* fresh = (struct JournalTitle*)calloc(slot_count, sizeof(*fresh));
+    if (!buf || !fresh) {
+        free(buf);
+        free(fresh);
+        return false;
+    }
+    size_t len = encode_header(buf);
+    char source[MAX_PATH], arg[MAX_PATH + MAX_TITLE_NAME];
+    uint32_t mask = slot_count - 1;
+    for (uint32_t i = 0; i < slot_count; i++) {
+        struct JournalTitle* t = &slots[i];
+        if (!t->title_id[0] || !t->open) continue;
+        uint32_t s = str_hash(t->title_id) & mask;
+        while (fresh[s].title_id[0]) s = (s + 1) & mask;
+        fresh[s] = *t;
+        size_t arg_len = path_get(t->source, source, sizeof(source)) ?
+                         begin_arg(arg, sizeof(arg), source, t->title_name) : 0;
+        if (arg_len == 0) continue;
+        len += encode_record(buf + len, t->remount ? JOURNAL_BEGIN_REMOUNT : JOURNAL_BEGIN, t->title_id, arg, arg_len);
+        for (int f = 0; f < t->file_count; f++) {
+            len += encode_record(buf + len, JOURNAL_FILE_COPIED, t->title_id, t->files[f], strlen(t->files[f]));
+        }
+        if (t->step >= JOURNAL_MOUNTED && t->step != JOURNAL_FILE_COPIED) {
+            len += encode_record(buf + len, t->step, t->title_id, NULL, 0);
+        }
+    }
+
+    bool ok = write_file_atomic(JOURNAL_FILE, buf, len, true);
+    free(buf);
+    if (!ok) {
+        log_debug("[JOURNAL] Compaction failed: %s", strerror(errno));
+        free(fresh);
+        return false;
+    }
+    // The next append opens the new file
+    if (journal_fd >= 0) close(journal_fd);
+    journal_fd = -1;
+    journal_size = (off_t)len;
+    free(slots);
+    slots = fresh;
+    used_count = (uint32_t)open_count;
+    return true;
+}
+
+void journal_sync(void) {
+    pthread_mutex_lock(&journal_lock);
+    if (open_count == 0) {
+        // Nothing left to recover: start the next batch from an empty file
+        if (journal_fd >= 0 && journal_size > 0 && ftruncate(journal_fd, 0) == 0) journal_size = 0;
+        if (slot_count) memset(slots, 0, slot_count * sizeof(*slots));
+        used_count = 0;
+    } else {
+        // Finished titles' records go; the rewrite is synced through a temp file
+        bool compacted = used_count > (uint32_t)open_count && compact();
+        if (!compacted && journal_fd >= 0) fsync(journal_fd);
+    }
+    pthread_mutex_unlock(&journal_lock);
+}
+
+// --- RECOVERY ---
+// Never follows a symlink out of the tree
+static void remove_tree(int parent_fd, const char* name) {
+    struct WalkDir w;
+    if (walk_open(&w, parent_fd, name)) {
+        struct WalkEntry e;
+        while (walk_next(&w, &e)) {
+            struct stat st;
+            if (fstatat(w.fd, e.name, &st, AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR(st.st_mode)) {
+                remove_tree(w.fd, e.name);
+            } else {
+                unlinkat(w.fd, e.name, 0);
+            }
+        }
+        walk_close(&w);
+    }
+    unlinkat(parent_fd, name, AT_REMOVEDIR);
+}
+
+// Caller holds journal_lock
+static void roll_back(struct JournalTitle* t, const char* source) {
+    char path[MAX_PATH];
+    snprintf(path, sizeof(path), "/system_ex/app/%s", t->title_id);
+    if (unmount(path, 0) != 0) unmount(path, MNT_FORCE);
+    mounts_note_unmounted(t->title_id);
+    // Past the tracker the title is installed, just with its drive away
+    bool remove_app = !t->remount && t->step < JOURNAL_TRACKER;
+    if (remove_app) {
+        snprintf(path, sizeof(path), "/user/app/%s", t->title_id);
+        remove_tree(AT_FDCWD, path);
+        snprintf(path, sizeof(path), "%s/%s.smv", VERIFY_DIR, t->title_id);
+        unlink(path);
+        snprintf(path, sizeof(path), "%s/%s", ASSETS_DIR, t->title_id);
+        unlink(path);
+    }
+    log_debug("[JOURNAL] %s: source %s is gone, rolled back after '%s'%s", t->title_id, source,
+              step_names[t->step], remove_app ? " (partial install removed)" : "");
+    apply(JOURNAL_ABORT, t->title_id, NULL, 0);
+    append(JOURNAL_ABORT, t->title_id, NULL, 0);
+}
+
+int journal_recover(void) {
+    long long t0 = monotonic_us();
+    pthread_mutex_lock(&journal_lock);
+    load();
+    if (open_count == 0) {
+        pthread_mutex_unlock(&journal_lock);
+        journal_sync();
+        return 0;
+    }
+
+    mounts_refresh();
+    int resumed = 0, rolled_back = 0, deferred = 0;
+    char source[MAX_PATH], title_id[MAX_TITLE_ID], title_name[MAX_TITLE_NAME], app_dir[MAX_PATH];
+    for (uint32_t i = 0; i < slot_count; i++) {
+        struct JournalTitle* t = &slots[i];
+        if (!t->title_id[0] || !t->open || !path_get(t->source, source, sizeof(source))) continue;
+        // Its drive may come back: left open, resumed when a scan finds it
+        if (!health_ready(source)) {
+            log_debug("[JOURNAL] %s: drive of %s is not responding, left for later", t->title_id, source);
+            deferred++;
+            continue;
+        }
+        // The source must still be a game with the same title_id
+        if (!get_game_info(source, title_id, title_name) || strcmp(title_id, t->title_id) != 0) {
+            roll_back(t, source);
+            rolled_back++;
+            continue;
+        }
+        log_debug("[JOURNAL] %s: resuming after '%s'", t->title_id, step_names[t->step]);
+        // A copy cut off before its rename leaves only a temp file behind
+        snprintf(app_dir, sizeof(app_dir), "/user/app/%s", t->title_id);
+        copy_remove_temps(app_dir);
+        install_queue(source, t->title_id, t->title_name, t->remount);
+        resumed++;
+    }
+    pthread_mutex_unlock(&journal_lock);
+
+    int installed = 0, mounted = 0;
+    if (resumed > 0) install_flush(&installed, &mounted);
+    journal_sync();
+    log_debug("[JOURNAL] Recovery: %d resumed (%d installed, %d mounted), %d rolled back, %d left open in %lldms",
+              resumed, installed, mounted, rolled_back, deferred, (monotonic_us() - t0) / 1000);
+    return resumed;
+}
+
+// --- FAULT INJECTION ---
+#ifdef __linux__
+void journal_fault(const char* point) {
+    static int hits = 0;
+    const char* spec = getenv("SM_HOST_FAULT");
+    if (!spec) return;
+    size_t len = strcspn(spec, ":");
+    if (strlen(point) != len || strncmp(spec, point, len) != 0) return;
+    int n = spec[len] == ':' ? atoi(spec + len + 1) : 1;
+    if (__atomic_add_fetch(&hits, 1, __ATOMIC_RELAXED) != n) return;
+    fprintf(stderr, "[JOURNAL] Fault injected at %s (hit %d)\n", point, n);
+    _exit(99);
+}
+#endif
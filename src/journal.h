@@ -0,0 +1,63 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stdbool.h>
+
+// --- INSTALL JOURNAL ---
+// Append-only log of the steps of every install and remount in the mount
+// batch. Records are CRC-checked, so a record torn by a crash is dropped on
+// load. BEGIN records are synced before the batch touches anything and the
+// file is synced after it: emptied once nothing is open, otherwise rewritten
+// with only the open titles' records. The steps in between are idempotent,
+// so losing one only means doing it again.
+//
+// At startup every title without a DONE/ABORT record is resumed from its
+// last recorded step when its source is still there, and rolled back
+// (unmounted, a fresh /user/app/<id> removed) when it is not.
+
+#define JOURNAL_FILE        "/data/shadowmount/install.journal"
+#define JOURNAL_MAGIC       0x4A4D4D53u  // "SMMJ"
+#define JOURNAL_VERSION     1
+#define JOURNAL_MAX_FILES   8            // Per-file records kept per title
+
+enum journal_step {
+    JOURNAL_BEGIN = 1,          // Fresh install (arg: source, title name)
+    JOURNAL_BEGIN_REMOUNT,      // Remount of an installed title (same arg)
+    JOURNAL_MOUNTED,
+    JOURNAL_FILE_COPIED,        // One registration file in place (arg: name in sce_sys)
+    JOURNAL_FILES,              // Every registration file in place
+    JOURNAL_TRACKER,            // mount.lnk written
+    JOURNAL_DONE,               // Registered
+    JOURNAL_ABORT,              // Failed; the next scan starts over
+};
+
+// Loads the journal and rolls back or queues (and flushes) the titles left
+// unfinished. Returns the number of titles resumed.
+int journal_recover(void);
+
+// Opens a title's record; a title still open from the same source keeps
+// its recorded steps (resume)
+void journal_begin(const char* title_id, const char* title_name, const char* source, bool is_remount);
+void journal_step(const char* title_id, enum journal_step step);
+void journal_file(const char* title_id, const char* name);
+
+// Whether an open title already went through step / copied name
+bool journal_reached(const char* title_id, enum journal_step step);
+bool journal_file_done(const char* title_id, const char* name);
+
+// An install of the title is in progress (or was cut off)
+bool journal_is_open(const char* title_id);
+
+// Makes the records durable; empties the journal when nothing is open and
+// drops the finished titles' records when some are
+void journal_sync(void);
+
+// Host builds: SM_HOST_FAULT=<point>[:<n>] ends the daemon at the n-th hit
+// of that point, to exercise recovery. Compiled out on the console.
+#ifdef __linux__
+void journal_fault(const char* point);
+#else
+#define journal_fault(point) ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,240 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <sys/stat.h>
+
+#include "shadowmount.h"
+#include "log.h"
+#include "util.h"
+
+#define LOG_RING_MASK (LOG_RING_SLOTS - 1)
+
+// --- RING ---
+// Bounded MPSC queue: a slot is free for the producer at position pos when
+// seq == pos, and holds a message for the flusher when seq == pos + 1.
+struct LogSlot {
+    unsigned long seq;
+    time_t when;
+    unsigned short len;
+    char text[LOG_LINE_MAX];
+};
+
+static struct LogSlot ring[LOG_RING_SLOTS];
+static unsigned long enqueue_pos = 0;
+static unsigned long dequeue_pos = 0;   // Flusher only
+static unsigned long dropped = 0;
+static int level = LOG_LEVEL_INFO;
+static bool running = false;
+static bool stopping = false;
+static bool flusher_idle = false;
+static sem_t wake;
+static pthread_t flusher;
+
+static int log_fd = -1;
+static char log_path[MAX_PATH];
+static off_t log_size = 0;
+
+static void log_push(enum log_level lvl, const char* fmt, va_list args) {
+    if (lvl > __atomic_load_n(&level, __ATOMIC_RELAXED)) return;
+    if (!__atomic_load_n(&running, __ATOMIC_ACQUIRE)) {
+        // Before log_init(): console only, like the old logger
+        vprintf(fmt, args);
+        printf("\n");
+        return;
+    }
+
+    unsigned long pos = __atomic_load_n(&enqueue_pos, __ATOMIC_RELAXED);
+    struct LogSlot* slot;
+    while (true) {
+        slot = &ring[pos & LOG_RING_MASK];
+        unsigned long seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        long diff = (long)(seq - pos);
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&enqueue_pos, &pos, pos + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+        } else if (diff < 0) {
+            __atomic_fetch_add(&dropped, 1, __ATOMIC_RELAXED); // Ring full
+            return;
+        } else {
+            pos = __atomic_load_n(&enqueue_pos, __ATOMIC_RELAXED);
+        }
+    }
+
+    slot->when = time(NULL);
+    int n = vsnprintf(slot->text, sizeof(slot->text), fmt, args);
+    if (n < 0) n = 0;
+    slot->len = (unsigned short)(n < (int)sizeof(slot->text) ? n : (int)sizeof(slot->text) - 1);
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_SEQ_CST);
+    // Only a sleeping flusher needs the (syscall) wakeup
+    if (__atomic_load_n(&flusher_idle, __ATOMIC_SEQ_CST) &&
+        __atomic_exchange_n(&flusher_idle, false, __ATOMIC_SEQ_CST)) {
+        sem_post(&wake);
+    }
+}
+
+void log_debug(const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    log_push(LOG_LEVEL_INFO, fmt, args);
+    va_end(args);
+}
+
+void log_trace(const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    log_push(LOG_LEVEL_TRACE, fmt, args);
+    va_end(args);
+}
+
+// --- FLUSHER ---
+static void open_log(void) {
+    log_fd = open(log_path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0666);
+    struct stat st;
+    log_size = (log_fd >= 0 && fstat(log_fd, &st) == 0) ? st.st_size : 0;
+}
+
+static void write_batch(const char* data, size_t len) {
+    if (len == 0) return;
+    write_full(STDOUT_FILENO, data, len);
+    if (log_fd < 0) return;
+    write_full(log_fd, data, len);
+    log_size += (off_t)len;
+    if (log_size > LOG_MAX_SIZE) {
+        char old[sizeof(log_path) + 2];
+        snprintf(old, sizeof(old), "%s.1", log_path);
+        close(log_fd);
+        rename(log_path, old);
+        open_log();
+    }
+}
+
+static void drain(char* batch) {
+    size_t used = 0;
+    time_t last_when = (time_t)-1;
+    char stamp[16] = "";
+
+    while (true) {
+        struct LogSlot* slot = &ring[dequeue_pos & LOG_RING_MASK];
+        if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != dequeue_pos + 1) break;
+
+        if (slot->when != last_when) {
+            struct tm tm;
+            localtime_r(&slot->when, &tm);
+            strftime(stamp, sizeof(stamp), "%H:%M:%S", &tm);
+            last_when = slot->when;
+        }
+        if (used + slot->len + sizeof(stamp) + 4 > LOG_BATCH_SIZE) {
+            write_batch(batch, used);
+            used = 0;
+        }
+        used += (size_t)snprintf(batch + used, LOG_BATCH_SIZE - used, "[%s] ", stamp);
+        memcpy(batch + used, slot->text, slot->len);
+        used += slot->len;
+        batch[used++] = '\n';
+
+        __atomic_store_n(&slot->seq, dequeue_pos + LOG_RING_SLOTS, __ATOMIC_RELEASE);
+        dequeue_pos++;
+    }
+
+    unsigned long lost = __atomic_exchange_n(&dropped, 0, __ATOMIC_RELAXED);
+    if (lost && used + 64 < LOG_BATCH_SIZE) {
+        used += (size_t)snprintf(batch + used, LOG_BATCH_SIZE - used,
+                                 "[%s] [LOG] Ring full, dropped %lu line(s)\n", stamp, lost);
+    }
+    write_batch(batch, used);
+}
+
+static void* flusher_main(void* arg) {
+    (void)arg;
+    char* batch = (char*)malloc(LOG_BATCH_SIZE);
+    if (!batch) return NULL;
+    while (!__atomic_load_n(&stopping, __ATOMIC_ACQUIRE)) {
+        drain(batch);
+        // Announce the sleep, then re-check so a line published meanwhile
+        // is not left waiting for the next one
+        __atomic_store_n(&flusher_idle, true, __ATOMIC_SEQ_CST);
+        struct LogSlot* next = &ring[dequeue_pos & LOG_RING_MASK];
+        if (__atomic_load_n(&next->seq, __ATOMIC_SEQ_CST) == dequeue_pos + 1 ||
+            __atomic_load_n(&stopping, __ATOMIC_SEQ_CST)) {
+            if (__atomic_exchange_n(&flusher_idle, false, __ATOMIC_SEQ_CST)) continue;
+            // A producer claimed the wakeup already: consume its post
+        }
+        while (sem_wait(&wake) != 0 && errno == EINTR) { }
+    }
+    drain(batch);
+    free(batch);
+    return NULL;
+}
+
+// --- LIFECYCLE ---
+void log_init(const char* path) {
+    if (running) return;
+    snprintf(log_path, sizeof(log_path), "%s", path);
+    for (unsigned long i = 0; i < LOG_RING_SLOTS; i++) ring[i].seq = i;
+    enqueue_pos = dequeue_pos = 0;
+    open_log();
+    log_reload_level();
+    if (sem_init(&wake, 0, 0) != 0) return;
+    if (pthread_create(&flusher, NULL, flusher_main, NULL) != 0) {
+        sem_destroy(&wake);
+        return;
+    }
+    __atomic_store_n(&running, true, __ATOMIC_RELEASE);
+}
+
+void log_shutdown(void) {
+    if (!__atomic_load_n(&running, __ATOMIC_ACQUIRE)) return;
+    __atomic_store_n(&stopping, true, __ATOMIC_SEQ_CST);
+    if (__atomic_exchange_n(&flusher_idle, false, __ATOMIC_SEQ_CST)) sem_post(&wake);
+    pthread_join(flusher, NULL);
+    __atomic_store_n(&running, false, __ATOMIC_RELEASE);
+    sem_destroy(&wake);
+    if (log_fd >= 0) close(log_fd);
+    log_fd = -1;
+}
+
+// --- LEVELS ---
+void log_set_level(enum log_level lvl) {
+    __atomic_store_n(&level, (int)lvl, __ATOMIC_RELAXED);
+}
+
+enum log_level log_get_level(void) {
+    return (enum log_level)__atomic_load_n(&level, __ATOMIC_RELAXED);
+}
+
+void log_reload_level(void) {
+    static time_t last_mtime = 0;
+    static bool had_file = false;
+    struct stat st;
+    if (stat(LOG_LEVEL_FILE, &st) != 0) {
+        if (had_file) log_set_level(LOG_LEVEL_INFO);
+        had_file = false;
+        return;
+    }
+    if (had_file && st.st_mtime == last_mtime) return;
+    had_file = true;
+    last_mtime = st.st_mtime;
+
+    char buf[16] = {0};
+    FILE* f = fopen(LOG_LEVEL_FILE, "r");
+    if (!f) return;
+    size_t n = fread(buf, 1, sizeof(buf) - 1, f);
+    fclose(f);
+    while (n > 0 && (buf[n - 1] == '\n' || buf[n - 1] == '\r' || buf[n - 1] == ' ')) buf[--n] = '\0';
+
+    enum log_level lvl = LOG_LEVEL_INFO;
+    if (strcmp(buf, "off") == 0) lvl = LOG_LEVEL_OFF;
+    else if (strcmp(buf, "trace") == 0) lvl = LOG_LEVEL_TRACE;
+    if (lvl != log_get_level()) {
+        log_set_level(LOG_LEVEL_INFO);
+        log_debug("[LOG] Level set to %s", lvl == LOG_LEVEL_OFF ? "off" : lvl == LOG_LEVEL_TRACE ? "trace" : "info");
+        log_set_level(lvl);
+    }
+}
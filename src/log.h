@@ -0,0 +1,31 @@
+#ifndef LOG_H
+#define LOG_H
+
+// --- LOGGING ---
+// log_debug()/log_trace() only format into a lock-free ring; a background
+// thread writes batches to debug.log (opened once, rotated by size) and
+// stdout. A full ring drops lines instead of stalling the scanner.
+
+#define LOG_RING_SLOTS      512           // Power of two
+#define LOG_LINE_MAX        512
+#define LOG_BATCH_SIZE      (64 * 1024)
+#define LOG_MAX_SIZE        (1024 * 1024) // debug.log is moved to debug.log.1 past this
+#define LOG_LEVEL_FILE      "/data/shadowmount/log_level"
+
+enum log_level {
+    LOG_LEVEL_OFF = 0,
+    LOG_LEVEL_INFO,     // log_debug(): default
+    LOG_LEVEL_TRACE,    // log_trace(): per-directory detail
+};
+
+void log_init(const char* path);
+void log_shutdown(void); // Writes everything still queued, then stops the flusher
+
+void log_set_level(enum log_level level);
+enum log_level log_get_level(void);
+
+// Applies LOG_LEVEL_FILE ("off", "info" or "trace") if it changed since the
+// last call; a missing file means "info".
+void log_reload_level(void);
+
+#endif
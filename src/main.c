@@ -3,7 +3,6 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
-#include <ctype.h>
 #include <stdarg.h>
 #include <fcntl.h>
 #include <sys/stat.h>
@@ -17,102 +16,43 @@
 
 #include <ps5/kernel.h> 
 
-// --- Configuration ---
-#define SCAN_INTERVAL_US    3000000 
-#define MAX_PENDING         512     
-#define MAX_PATH            1024
-#define MAX_TITLE_ID        32
-#define MAX_TITLE_NAME      256
-#define MAX_RECURSION_DEPTH 5
-#define LOG_DIR             "/data/shadowmount"
-#define LOG_FILE            "/data/shadowmount/debug.log"
-#define LOCK_FILE           "/data/shadowmount/daemon.lock"
-#define KILL_FILE           "/data/shadowmount/STOP"
-#define TOAST_FILE          "/data/shadowmount/notify.txt"
-#define IOVEC_ENTRY(x) { (void*)(x), (x) ? strlen(x) + 1 : 0 }
-#define IOVEC_SIZE(x)  (sizeof(x) / sizeof(struct iovec))
+#include "shadowmount.h"
+#include "index.h"
+#include "watcher.h"
+#include "scan.h"
+#include "walk.h"
+#include "copy.h"
+#include "install.h"
+#include "param.h"
+#include "log.h"
+#include "stats.h"
+#include "mounts.h"
+#include "schedule.h"
+#include "pending.h"
+#include "verify.h"
+#include "dircache.h"
+#include "restore.h"
+#include "devmap.h"
+#include "control.h"
+#include "sources.h"
+#include "assets.h"
+#include "journal.h"
+#include "health.h"
 
 // --- SDK Imports ---
 int sceAppInstUtilInitialize(void);
-int sceAppInstUtilAppInstallTitleDir(const char* title_id, const char* install_path, void* reserved);
-int sceKernelUsleep(unsigned int microseconds);
 int sceUserServiceInitialize(void*);
 void sceUserServiceTerminate(void);
 
 // --- Forward Declarations ---
-bool get_game_info(const char* base_path, char* out_id, char* out_name);
-bool is_installed(const char* title_id);
-bool is_data_mounted(const char* title_id);
 bool is_game_ready(const char* title_id);
 bool is_installation_valid(const char* title_id);
-int check_installation_integrity(const char* title_id);
 bool repair_installation(const char* src_path, const char* title_id, const char* title_name);
-void notify_system(const char* fmt, ...);
-void log_debug(const char* fmt, ...);
-void scan_directory_recursive(const char* dir_path, int depth);
-static int copy_dir(const char* src, const char* dst);
-int copy_file(const char* src, const char* dst);
 
 // Standard Notification
 typedef struct notify_request { char unused[45]; char message[3075]; } notify_request_t;
 int sceKernelSendNotificationRequest(int, notify_request_t*, size_t, int);
 
-// Scan Paths - Only specific folders (no parent/child duplicates)
-const char* SCAN_PATHS[] = {
-    // Internal Storage
-    "/data/homebrew", 
-    "/data/etaHEN/games",
-
-    // Extended Storage (ext0)
-    "/mnt/ext0/homebrew", 
-    "/mnt/ext0/etaHEN/homebrew", 
-    "/mnt/ext0/etaHEN/games",
-
-    // M.2 Drive (ext1)
-    "/mnt/ext1/homebrew", 
-    "/mnt/ext1/etaHEN/homebrew", 
-    "/mnt/ext1/etaHEN/games",
-    
-    // USB Subfolders (usb0-usb7) - only specific paths, no root scan
-    "/mnt/usb0/homebrew", "/mnt/usb1/homebrew", "/mnt/usb2/homebrew", "/mnt/usb3/homebrew",
-    "/mnt/usb4/homebrew", "/mnt/usb5/homebrew", "/mnt/usb6/homebrew", "/mnt/usb7/homebrew",
-    
-    "/mnt/usb0/etaHEN/games", "/mnt/usb1/etaHEN/games", "/mnt/usb2/etaHEN/games", "/mnt/usb3/etaHEN/games",
-    "/mnt/usb4/etaHEN/games", "/mnt/usb5/etaHEN/games", "/mnt/usb6/etaHEN/games", "/mnt/usb7/etaHEN/games",
-    
-    NULL
-};
-
-struct GameCache { 
-    char path[MAX_PATH]; 
-    char title_id[MAX_TITLE_ID]; 
-    char title_name[MAX_TITLE_NAME]; 
-    bool valid; 
-};
-struct GameCache cache[MAX_PENDING];
-
-// --- Global counters for installed/mounted games ---
-static int g_installed_count = 0;
-static int g_mounted_count = 0;
-
-// --- LOGGING ---
-static bool log_initialized = false;
-
-void log_to_file(const char* fmt, va_list args) {
-    if (!log_initialized) return; // Skip if not initialized
-    FILE* fp = fopen(LOG_FILE, "a");
-    if (fp) {
-        time_t rawtime; struct tm * timeinfo; char buffer[80];
-        time(&rawtime); timeinfo = localtime(&rawtime); strftime(buffer, sizeof(buffer), "%H:%M:%S", timeinfo);
-        fprintf(fp, "[%s] ", buffer); vfprintf(fp, fmt, args); fprintf(fp, "\n"); fclose(fp);
-    }
-}
-void log_debug(const char* fmt, ...) {
-    va_list args; va_start(args, fmt); vprintf(fmt, args); printf("\n"); 
-    va_list args2; va_start(args2, fmt); log_to_file(fmt, args2); va_end(args2);
-    va_end(args);
-}
-
 // --- NOTIFICATIONS ---
 void notify_system(const char* fmt, ...) {
     notify_request_t req; memset(&req, 0, sizeof(req));
@@ -130,17 +70,13 @@ void trigger_rich_toast(const char* title_id, const char* game_name, const char*
 }
 
 // --- FILESYSTEM ---
-bool is_installed(const char* title_id) { 
-    char path[MAX_PATH]; 
-    snprintf(path, sizeof(path), "/user/app/%s", title_id); 
-    struct stat st; 
-    return (stat(path, &st) == 0); 
+// Both answer from the per-pass snapshot (mounts.c), no filesystem access
+bool is_installed(const char* title_id) {
+    return mounts_is_installed(title_id);
 }
 
-bool is_data_mounted(const char* title_id) { 
-    char path[MAX_PATH]; 
-    snprintf(path, sizeof(path), "/system_ex/app/%s/sce_sys/param.json", title_id); 
-    return (access(path, F_OK) == 0); 
+bool is_data_mounted(const char* title_id) {
+    return mounts_is_mounted(title_id);
 }
 
 // --- INTEGRITY CHECK ---
@@ -188,6 +124,11 @@ bool is_installation_valid(const char* title_id) {
     if (!is_installed(title_id)) {
         return false;
     }
+    // Param.json alone proves nothing while an install is unfinished
+    if (journal_is_open(title_id)) {
+        log_debug("  [DEBUG] %s install unfinished", title_id);
+        return false;
+    }
     int integrity = check_installation_integrity(title_id);
     if (integrity != 0) {
         // Log why integrity failed for debugging
@@ -199,7 +140,7 @@ bool is_installation_valid(const char* title_id) {
 
 // Repair a broken installation by re-copying files
 bool repair_installation(const char* src_path, const char* title_id, const char* title_name) {
-    char user_app_dir[MAX_PATH];
+    char user_app_dir[sizeof("/user/app/") + MAX_TITLE_ID];
     char user_sce_sys[MAX_PATH];
     char src_sce_sys[MAX_PATH];
     
@@ -214,7 +155,9 @@ bool repair_installation(const char* src_path, const char* title_id, const char*
     
     // Copy sce_sys from source
     snprintf(src_sce_sys, sizeof(src_sce_sys), "%s/sce_sys", src_path);
-    if (copy_dir(src_sce_sys, user_sce_sys) != 0) {
+    struct CopyReport rep = {0};
+    if (copy_tree(src_sce_sys, user_sce_sys, &rep) != 0) {
+        copy_log_report("Repair sce_sys", &rep);
         log_debug("  [REPAIR] Failed to copy sce_sys");
         return false;
     }
@@ -223,17 +166,19 @@ bool repair_installation(const char* src_path, const char* title_id, const char*
     char icon_src[MAX_PATH], icon_dst[MAX_PATH];
     snprintf(icon_src, sizeof(icon_src), "%s/sce_sys/icon0.png", src_path);
     snprintf(icon_dst, sizeof(icon_dst), "/user/app/%s/icon0.png", title_id);
-    copy_file(icon_src, icon_dst);
+    copy_file_ex(icon_src, icon_dst, &rep);
+    copy_log_report("Repair", &rep);
     
     // Verify repair was successful
     if (check_installation_integrity(title_id) != 0) {
         log_debug("  [REPAIR] Verification failed - files may not have copied correctly");
         return false;
     }
+    verify_record(title_id);
     
     // Re-register with the system
     int res = sceAppInstUtilAppInstallTitleDir(title_id, "/user/app/", 0);
-    sceKernelUsleep(200000);
+    if (res == 0 || res == 0x80990002) wait_for_registration(title_id, REG_READY_TIMEOUT_MS);
     
     if (res == 0 || res == 0x80990002) {
         log_debug("  [REPAIR] Successfully repaired %s", title_name);
@@ -245,367 +190,37 @@ bool repair_installation(const char* src_path, const char* title_id, const char*
     }
 }
 
-// --- FAST STABILITY CHECK ---
-bool wait_for_stability_fast(const char* path, const char* name) {
-    struct stat st;
-    time_t now = time(NULL);
-
-    // 1. Check Root Folder Timestamp
-    if (stat(path, &st) != 0) return false; 
-    double diff = difftime(now, st.st_mtime);
-
-    // If modified > 10 seconds ago, it's stable.
-    if (diff > 10.0) {
-        // Double check sce_sys just to be sure
-        char sys_path[MAX_PATH];
-        snprintf(sys_path, sizeof(sys_path), "%s/sce_sys", path);
-        if (stat(sys_path, &st) == 0) {
-            if (difftime(now, st.st_mtime) > 10.0) {
-                 return true;
-            }
-        } else {
-             return true; // No sce_sys? Trust root.
-        }
-    }
-    
-    log_debug("  [WAIT] %s modified %.0fs ago. Waiting...", name, diff);
-    sceKernelUsleep(2000000); // Wait 2s
-    return false; // Force re-scan next cycle
-}
-
-static int remount_system_ex(void) {
-    struct iovec iov[] = { 
-        IOVEC_ENTRY("from"), IOVEC_ENTRY("/dev/ssd0.system_ex"), 
-        IOVEC_ENTRY("fspath"), IOVEC_ENTRY("/system_ex"), 
-        IOVEC_ENTRY("fstype"), IOVEC_ENTRY("exfatfs"), 
-        IOVEC_ENTRY("large"), IOVEC_ENTRY("yes"), 
-        IOVEC_ENTRY("timezone"), IOVEC_ENTRY("static"), 
-        IOVEC_ENTRY("async"), IOVEC_ENTRY(NULL), 
-        IOVEC_ENTRY("ignoreacl"), IOVEC_ENTRY(NULL) 
-    };
-    return nmount(iov, IOVEC_SIZE(iov), MNT_UPDATE);
-}
-
-static int mount_nullfs(const char* src, const char* dst) {
-    struct iovec iov[] = { 
-        IOVEC_ENTRY("fstype"), IOVEC_ENTRY("nullfs"), 
-        IOVEC_ENTRY("from"), IOVEC_ENTRY(src), 
-        IOVEC_ENTRY("fspath"), IOVEC_ENTRY(dst) 
-    };
-    return nmount(iov, IOVEC_SIZE(iov), MNT_RDONLY); 
-}
-
-static int copy_dir(const char* src, const char* dst) {
-    if (mkdir(dst, 0777) < 0 && errno != EEXIST) return -1;
-    DIR* d = opendir(src); 
-    if (!d) return -1;
-    
-    struct dirent* e; 
-    char ss[MAX_PATH], dd[MAX_PATH]; 
-    struct stat st;
-    
-    while ((e = readdir(d))) {
-        if (!strcmp(e->d_name, ".") || !strcmp(e->d_name, "..")) continue;
-        snprintf(ss, sizeof(ss), "%s/%s", src, e->d_name); 
-        snprintf(dd, sizeof(dd), "%s/%s", dst, e->d_name);
-        if (stat(ss, &st) != 0) continue;
-        if (S_ISDIR(st.st_mode)) copy_dir(ss, dd);
-        else {
-            FILE* fs = fopen(ss, "rb"); if (!fs) continue;
-            FILE* fd = fopen(dd, "wb"); if (!fd) { fclose(fs); continue; }
-            char buf[65536]; size_t n; // 64KB buffer for better performance
-            while ((n = fread(buf, 1, sizeof(buf), fs)) > 0) fwrite(buf, 1, n, fd);
-            fclose(fd); fclose(fs);
-        }
-    }
-    closedir(d); 
-    return 0;
-}
-
-int copy_file(const char* src, const char* dst) {
-    char buf[65536]; // 64KB buffer
-    FILE* fs = fopen(src, "rb"); 
-    if (!fs) return -1;
-    FILE* fd = fopen(dst, "wb"); 
-    if (!fd) { fclose(fs); return -1; }
-    size_t n; 
-    while ((n = fread(buf, 1, sizeof(buf), fs)) > 0) fwrite(buf, 1, n, fd);
-    fclose(fd); fclose(fs); 
-    return 0;
-}
-
-// --- JSON & DRM ---
-static int extract_json_string(const char* json, const char* key, char* out, size_t out_size) {
-    char search[64]; 
-    snprintf(search, sizeof(search), "\"%s\"", key);
-    const char* p = strstr(json, search); 
-    if (!p) return -1;
-    p = strchr(p + strlen(search), ':'); 
-    if (!p) return -2;
-    while (*++p && isspace(*p)) { /*skip*/ } 
-    if (*p != '"') return -3; 
-    p++;
-    size_t i = 0;
-    bool escape = false;
-    while (i < out_size - 1 && p[i]) {
-        if (!escape && p[i] == '"') break; // End of string
-        if (p[i] == '\\' && !escape) {
-            escape = true;
-            p++; // Skip the backslash
-            continue;
-        }
-        escape = false;
-        out[i] = p[i]; 
-        i++;
-    }
-    out[i] = '\0'; 
-    return 0;
-}
-
-static int fix_application_drm_type(const char* path) {
-    FILE* f = fopen(path, "rb+"); 
-    if (!f) return -1;
-    fseek(f, 0, SEEK_END); 
-    long len = ftell(f); 
-    fseek(f, 0, SEEK_SET);
-    if (len <= 0 || len > 1024 * 1024 * 5) { fclose(f); return -1; } 
-    char* buf = (char*)malloc(len + 1); 
-    fread(buf, 1, len, f); 
-    buf[len] = '\0'; 
-    const char* key = "\"applicationDrmType\""; 
-    char* p = strstr(buf, key);
-    if (!p) { free(buf); fclose(f); return 0; }
-    char* colon = strchr(p + strlen(key), ':'); 
-    char* q1 = colon ? strchr(colon, '"') : NULL; 
-    char* q2 = q1 ? strchr(q1 + 1, '"') : NULL;
-    if (!q1 || !q2) { free(buf); fclose(f); return -1; }
-    if ((q2 - q1 - 1) == strlen("standard") && !strncmp(q1 + 1, "standard", strlen("standard"))) { 
-        free(buf); fclose(f); return 0; 
-    }
-    size_t new_len = (q1 - buf) + 1 + strlen("standard") + 1 + strlen(q2 + 1);
-    char* out = (char*)malloc(new_len + 1);
-    memcpy(out, buf, q1 - buf + 1); 
-    memcpy(out + (q1 - buf + 1), "standard", strlen("standard")); 
-    strcpy(out + (q1 - buf + 1 + strlen("standard")), q2);
-    fseek(f, 0, SEEK_SET); 
-    fwrite(out, 1, strlen(out), f); 
-    fclose(f); 
-    free(buf); 
-    free(out); 
-    return 1;
-}
-
-bool get_game_info(const char* base_path, char* out_id, char* out_name) {
-    char path[MAX_PATH]; 
-    snprintf(path, sizeof(path), "%s/sce_sys/param.json", base_path);
-    fix_application_drm_type(path); 
-    FILE* f = fopen(path, "rb");
-    if (f) {
-        fseek(f, 0, SEEK_END); 
-        long len = ftell(f); 
-        fseek(f, 0, SEEK_SET);
-        // Safety: limit file size to 1MB to prevent memory issues
-        if (len > 0 && len < 1024 * 1024) {
-            char* buf = (char*)malloc(len + 1);
-            if (buf) {
-                fread(buf, 1, len, f); 
-                buf[len] = '\0';
-                int res = extract_json_string(buf, "titleId", out_id, MAX_TITLE_ID);
-                if (res != 0) res = extract_json_string(buf, "title_id", out_id, MAX_TITLE_ID);
-                if (res == 0) {
-                    const char* en_ptr = strstr(buf, "\"en-US\""); 
-                    const char* search_start = en_ptr ? en_ptr : buf;
-                    if (extract_json_string(search_start, "titleName", out_name, MAX_TITLE_NAME) != 0) 
-                        extract_json_string(buf, "titleName", out_name, MAX_TITLE_NAME);
-                    if (strlen(out_name) == 0) snprintf(out_name, MAX_TITLE_NAME, "%s", out_id);
-                    free(buf); 
-                    fclose(f); 
-                    return true;
-                }
-                free(buf);
-            }
-        }
-        fclose(f);
-    }
-    return false;
-}
-
-// --- MOUNT & INSTALL ---
-bool mount_and_install(const char* src_path, const char* title_id, const char* title_name, bool is_remount) {
-    char system_ex_app[MAX_PATH]; 
-    char user_app_dir[MAX_PATH]; 
-    char user_sce_sys[MAX_PATH]; 
-    char src_sce_sys[MAX_PATH];
-    
-    // MOUNT
-    snprintf(system_ex_app, sizeof(system_ex_app), "/system_ex/app/%s", title_id); 
-    mkdir(system_ex_app, 0777); 
-    remount_system_ex(); 
-    unmount(system_ex_app, 0); 
-    if (mount_nullfs(src_path, system_ex_app) < 0) { 
-        log_debug("  [MOUNT] FAIL: %s", strerror(errno)); 
-        return false; 
-    }
-
-    // COPY FILES
-    if (!is_remount) {
-        snprintf(user_app_dir, sizeof(user_app_dir), "/user/app/%s", title_id); 
-        snprintf(user_sce_sys, sizeof(user_sce_sys), "%s/sce_sys", user_app_dir);
-        mkdir(user_app_dir, 0777); 
-        mkdir(user_sce_sys, 0777);
-
-        snprintf(src_sce_sys, sizeof(src_sce_sys), "%s/sce_sys", src_path); 
-        copy_dir(src_sce_sys, user_sce_sys); 
-        
-        char icon_src[MAX_PATH], icon_dst[MAX_PATH]; 
-        snprintf(icon_src, sizeof(icon_src), "%s/sce_sys/icon0.png", src_path);
-        snprintf(icon_dst, sizeof(icon_dst), "/user/app/%s/icon0.png", title_id); 
-        copy_file(icon_src, icon_dst);
-    } else {
-        log_debug("  [SPEED] Skipping file copy (Assets already exist)");
-    }
-
-    // WRITE TRACKER
-    char lnk_path[MAX_PATH]; 
-    snprintf(lnk_path, sizeof(lnk_path), "/user/app/%s/mount.lnk", title_id);
-    FILE* flnk = fopen(lnk_path, "w"); 
-    if (flnk) { fprintf(flnk, "%s", src_path); fclose(flnk); }
-    
-    // REGISTER
-    int res = sceAppInstUtilAppInstallTitleDir(title_id, "/user/app/", 0);
-    sceKernelUsleep(200000); 
-
-    if (res == 0) { 
-        log_debug("  [REG] Installed NEW!"); 
-        trigger_rich_toast(title_id, title_name, "Installed"); 
-    }
-    else if (res == 0x80990002) { 
-        log_debug("  [REG] Restored."); 
-    }
-    else { 
-        log_debug("  [REG] FAIL: 0x%x", res); 
-        return false; 
+// --- GAME INFO ---
+// name is resolved relative to dir_fd (AT_FDCWD + absolute path works too).
+// Unchanged titles are answered from the library index without opening
+// param.json.
+bool get_game_info_at(int dir_fd, const char* name, char* out_id, char* out_name) {
+    char rel[MAX_PATH];
+    snprintf(rel, sizeof(rel), "%s/sce_sys/param.json", name);
+    struct stat param_st, dir_st;
+    if (walk_stat(dir_fd, rel, &param_st) != 0) return false;
+    bool have_dir = walk_stat(dir_fd, name, &dir_st) == 0;
+    if (have_dir && index_lookup(&dir_st, &param_st, out_id, out_name)) return true;
+
+    bool drm_fixed = false;
+    if (!param_read_at(dir_fd, rel, param_st.st_size, out_id, out_name, &drm_fixed)) return false;
+
+    // Record the post-patch param.json state so the next pass trusts it
+    if (have_dir && (!drm_fixed || walk_stat(dir_fd, rel, &param_st) == 0)) {
+        index_store(&dir_st, &param_st, out_id, out_name, drm_fixed);
     }
     return true;
 }
 
-// --- RECURSIVE SCAN HELPER ---
-void scan_directory_recursive(const char* dir_path, int depth) {
-    // Limit recursion depth to avoid infinite loops
-    if (depth > MAX_RECURSION_DEPTH) {
-        return;
-    }
-    
-    DIR* d = opendir(dir_path);
-    if (!d) {
-        return;
-    }
-    
-    log_debug("[RECURSIVE] Scanning: %s (depth=%d)", dir_path, depth);
-    
-    struct dirent* entry;
-    while ((entry = readdir(d)) != NULL) {
-        // Skip hidden files and special directories
-        if (entry->d_name[0] == '.') continue;
-        
-        char full_path[MAX_PATH];
-        snprintf(full_path, sizeof(full_path), "%s/%s", dir_path, entry->d_name);
-        
-        struct stat st;
-        if (stat(full_path, &st) != 0 || !S_ISDIR(st.st_mode)) {
-            continue;
-        }
-        
-        // Check if this is a valid game folder
-        char title_id[MAX_TITLE_ID] = {0};
-        char title_name[MAX_TITLE_NAME] = {0};
-        
-        if (get_game_info(full_path, title_id, title_name)) {
-            // This is a valid game folder
-            
-            // STEP 1: Check current state
-            bool installed = is_installed(title_id);
-            bool mounted = is_data_mounted(title_id);
-            
-            // STEP 2: If mounted, the game is working - skip completely
-            // (nullfs provides all needed files via /system_ex/app/)
-            if (mounted) {
-                // Game is functional, no action needed
-                continue;
-            }
-            
-            // STEP 3: Check cache to avoid processing the same game multiple times
-            bool already_processed = false;
-            for (int k = 0; k < MAX_PENDING; k++) {
-                if (cache[k].valid && strcmp(cache[k].title_id, title_id) == 0) {
-                    already_processed = true;
-                    break;
-                }
-            }
-            
-            if (already_processed) {
-                // Already handled this title_id in this session, skip
-                continue;
-            }
-            
-            // STEP 4: Add to cache to prevent re-processing
-            for (int k = 0; k < MAX_PENDING; k++) {
-                if (!cache[k].valid) {
-                    snprintf(cache[k].path, MAX_PATH, "%s", full_path);
-                    snprintf(cache[k].title_id, MAX_TITLE_ID, "%s", title_id);
-                    snprintf(cache[k].title_name, MAX_TITLE_NAME, "%s", title_name);
-                    cache[k].valid = true;
-                    break;
-                }
-            }
-            
-            // STEP 5: Not mounted - determine action needed
-            log_debug("[PROCESS] %s (%s) - installed=%d", title_name, title_id, installed);
-            
-            // CASE A: Installed but not mounted -> Just mount
-            if (installed) {
-                log_debug("[MOUNT] %s", title_name);
-                if (mount_and_install(full_path, title_id, title_name, true)) {
-                    g_mounted_count++;
-                }
-                continue;
-            }
-            
-            // CASE B: Not installed at all -> Fresh install
-            log_debug("[INSTALL] %s (%s)", title_name, title_id);
-            if (!wait_for_stability_fast(full_path, title_name)) {
-                continue;
-            }
-            if (mount_and_install(full_path, title_id, title_name, false)) {
-                g_installed_count++;
-            }
-        } else {
-            // Not a game folder, scan recursively
-            scan_directory_recursive(full_path, depth + 1);
-        }
-    }
-    closedir(d);
+bool get_game_info(const char* base_path, char* out_id, char* out_name) {
+    return get_game_info_at(AT_FDCWD, base_path, out_id, out_name);
 }
 
-// --- MAIN SCAN FUNCTION ---
-void scan_all_paths() {
-    // Cache Cleaner - Remove invalid entries
-    for (int k = 0; k < MAX_PENDING; k++) {
-        if (cache[k].valid && access(cache[k].path, F_OK) != 0) {
-            log_debug("[CACHE] Removed stale entry: %s", cache[k].path);
-            cache[k].valid = false;
-        }
-    }
-
-    // Scan all configured paths recursively
-    for (int i = 0; SCAN_PATHS[i] != NULL; i++) {
-        // Check if path exists before scanning
-        struct stat st;
-        if (stat(SCAN_PATHS[i], &st) == 0 && S_ISDIR(st.st_mode)) {
-            log_debug("[SCAN] Starting scan: %s", SCAN_PATHS[i]);
-            scan_directory_recursive(SCAN_PATHS[i], 0);
-        }
-    }
+// --- TIME ---
+long long monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
 }
 
 // --- MAIN ---
@@ -621,7 +236,24 @@ int main() {
     if (mkdir(LOG_DIR, 0777) < 0 && errno != EEXIST) {
         // Can't create log dir, continue anyway
     }
-    log_initialized = true;
+    log_init(LOG_FILE);
+    index_load(INDEX_FILE);
+    dircache_load(DIRCACHE_FILE);
+
+    // A hung drive is quarantined before anything below touches it
+    health_init();
+    health_check();
+
+    // Event-driven change detection (falls back to polling if unavailable)
+    bool watching = watcher_init();
+    if (watching) {
+        watcher_set_gone_handler(scan_forget_path);
+        watcher_add(LOG_DIR, -1, WATCH_CONTROL);
+        scan_refresh_root_watches();
+        // The startup pass below covers every present root
+        char dummy[MAX_PATH];
+        while (watcher_pop(dummy, sizeof(dummy), NULL)) { }
+    }
     
     log_debug("==============================================");
     log_debug("SHADOWMOUNT v1.4 - by Jamzi & VoidWhisper");
@@ -631,13 +263,27 @@ int main() {
     log_debug("Configured scan paths:");
     for (int i = 0; SCAN_PATHS[i] != NULL; i++) {
         struct stat st;
-        const char* status = (stat(SCAN_PATHS[i], &st) == 0) ? "EXISTS" : "NOT FOUND";
+        const char* status = !health_usable(SCAN_PATHS[i]) ? "NOT RESPONDING" :
+                             (stat(SCAN_PATHS[i], &st) == 0) ? "EXISTS" : "NOT FOUND";
         log_debug("  [%s] %s", status, SCAN_PATHS[i]);
     }
     
+    // Speed overrides apply from the first pass on
+    sources_reload_config();
+
+    // --- FAST RESTORE ---
+    // Installs cut off by a crash are finished (or undone) first, then known
+    // titles come back from their mount.lnk before any scanning
+    int restored = journal_recover();
+    restored += restore_known_mounts();
+
     // --- SINGLE PASS STARTUP ---
     // Show scanning notification immediately
-    notify_system("ShadowMount v1.4\nby Jamzi & VoidWhisper\n\nScanning...");
+    if (restored > 0) {
+        notify_system("ShadowMount v1.4\nby Jamzi & VoidWhisper\n\n%d game(s) restored, scanning...", restored);
+    } else {
+        notify_system("ShadowMount v1.4\nby Jamzi & VoidWhisper\n\nScanning...");
+    }
     
     // Reset counters
     g_installed_count = 0;
@@ -649,8 +295,8 @@ int main() {
     // Show result based on what happened
     if (g_installed_count > 0) {
         notify_system("Installed %d new game(s)!", g_installed_count);
-    } else if (g_mounted_count > 0) {
-        notify_system("Library Ready!\n%d game(s) mounted.", g_mounted_count);
+    } else if (g_mounted_count + restored > 0) {
+        notify_system("Library Ready!\n%d game(s) mounted.", g_mounted_count + restored);
     } else {
         notify_system("Library Ready!");
     }
@@ -659,34 +305,130 @@ int main() {
     int lock = open(LOCK_FILE, O_CREAT | O_EXCL | O_RDWR, 0666);
     if (lock < 0 && errno == EEXIST) { 
         log_debug("[DAEMON] Lock file exists, exiting.");
+        log_shutdown();
         return 0; 
     }
 
-    log_debug("[DAEMON] Entering monitoring loop (interval: %dms)", SCAN_INTERVAL_US / 1000);
+    verify_start();
+    assets_start();
+    control_start();
+
+    // Watches report changes; idle walks are only a safety net then
+    sched_init(watching ? SAFETY_SCAN_INTERVAL_US : SCHED_MIN_IDLE_US);
+    if (watching) {
+        log_debug("[DAEMON] Entering event loop (idle walks: %ds-%ds)",
+                  SAFETY_SCAN_INTERVAL_US / 1000000, SCHED_MAX_IDLE_US / 1000000);
+    } else {
+        log_debug("[DAEMON] Entering monitoring loop (checks: %dms, idle walks: %ds-%ds)",
+                  SCHED_TICK_US / 1000, SCHED_MIN_IDLE_US / 1000000, SCHED_MAX_IDLE_US / 1000000);
+    }
+    int due[SCHED_MAX_ROOTS];
     
     while (true) {
         if (access(KILL_FILE, F_OK) == 0) { 
             log_debug("[DAEMON] Kill file detected, shutting down.");
             remove(KILL_FILE); 
-            remove(LOCK_FILE); 
-            return 0; 
+            break;
         }
         
-        // Sleep FIRST since we just finished scan above
-        sceKernelUsleep(SCAN_INTERVAL_US);
-        
+        log_reload_level();
+        pending_reload_config();
+        verify_reload_config();
+        sources_reload_config();
+
         // Reset counters for daemon loop
         g_installed_count = 0;
         g_mounted_count = 0;
+        // scan_subtree() needs a mount snapshot; one serves every path of a wakeup
+        bool mounts_taken = false;
+
+        // Commands from the control socket run between passes
+        if (control_poll(&g_installed_count, &g_mounted_count)) {
+            log_debug("[DAEMON] Shutdown requested over the control socket.");
+            break;
+        }
         
-        scan_all_paths();
+        if (!watching) {
+            // Sleep FIRST since we just finished scan above
+            sceKernelUsleep(SCHED_TICK_US);
+            health_check();
+            // Unplugged/replugged drives first, so the walk finds their titles mounted
+            devmap_check();
+            int n = sched_poll(due, SCHED_MAX_ROOTS);
+            if (n > 0) {
+                scan_roots(due, n);
+                sched_mark_walked(due, n, g_installed_count + g_mounted_count > 0);
+            }
+        } else {
+            long long wait_us = sched_next_due_us();
+            long long pending_us = pending_next_due_us();
+            if (pending_us >= 0 && pending_us < wait_us) wait_us = pending_us;
+            long long devmap_us = devmap_next_due_us();
+            if (devmap_us >= 0 && devmap_us < wait_us) wait_us = devmap_us;
+            long long health_us = health_next_due_us();
+            if (health_us >= 0 && health_us < wait_us) wait_us = health_us;
+            watcher_wait((int)(wait_us / 1000));
+            health_check();
+            devmap_check();
+
+            if (watcher_take_overflow()) {
+                // Safety net: catches anything the watches could not cover
+                scan_all_paths();
+                sched_mark_all_walked(g_installed_count + g_mounted_count > 0);
+            } else if (sched_next_due_us() == 0) {
+                int n = sched_poll(due, SCHED_MAX_ROOTS);
+                if (n > 0) {
+                    scan_roots(due, n);
+                    sched_mark_walked(due, n, g_installed_count + g_mounted_count > 0);
+                }
+            } else {
+                if (watcher_take_roots_changed()) scan_refresh_root_watches();
+                char dirty[MAX_PATH];
+                int depth;
+                bool any = false;
+                while (watcher_pop(dirty, sizeof(dirty), &depth)) {
+                    if (!mounts_taken) {
+                        mounts_refresh();
+                        mounts_taken = true;
+                    }
+                    scan_subtree(dirty, depth);
+                    any = true;
+                }
+                // Everything found by this wakeup shares one mount batch
+                install_flush(&g_installed_count, &g_mounted_count);
+                if (any) {
+                    stats_add(STAT_EVENT_PASSES, 1);
+                    stats_write(STATS_FILE);
+                }
+            }
+        }
         
+        // Copies that went quiet are rescanned and installed now
+        pending_poll();
+        char ready[MAX_PATH];
+        int ready_depth;
+        bool released = false;
+        while (pending_pop_ready(ready, sizeof(ready), &ready_depth)) {
+            if (!mounts_taken) {
+                mounts_refresh();
+                mounts_taken = true;
+            }
+            scan_subtree(ready, ready_depth);
+            released = true;
+        }
+        if (released) install_flush(&g_installed_count, &g_mounted_count);
+
         // Notify only if new games were installed during daemon loop
         if (g_installed_count > 0) {
             notify_system("New game(s) detected!\nInstalled %d.", g_installed_count);
         }
     }
-    
-    sceUserServiceTerminate();
+
+    control_shutdown();
+    watcher_shutdown();
+    verify_shutdown();
+    assets_shutdown();
+    remove(LOCK_FILE);
+    log_shutdown();
     return 0;
 }
@@ -0,0 +1,256 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/param.h>
+#include <sys/mount.h>
+
+#include <ps5/kernel.h>
+
+#include "shadowmount.h"
+#include "mounts.h"
+#include "walk.h"
+#include "arena.h"
+#include "cache.h"
+#include "util.h"
+
+#define MOUNT_MOUNTED       0x01
+#define MOUNT_INSTALLED     0x02
+#define MOUNTS_MAX_BACKING  64
+
+// --- TABLE ---
+// Open addressing on title_id; an empty title_id marks a free slot.
+// Entries are never removed between refreshes, only rebuilt.
+struct MountEntry {
+    char title_id[MAX_TITLE_ID];
+    path_id source;
+    uint8_t flags;
+};
+
+static struct MountEntry* slots = NULL;
+static uint32_t slot_count = 0;      // Power of two
+static uint32_t used_count = 0;
+static int last_mounted = 0;
+static int last_installed = 0;
+static int last_stale = 0;
+static struct statfs* fs_buf = NULL;   // Only held during a refresh
+static pthread_mutex_t mounts_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static struct MountEntry* find(const char* title_id) {
+    if (!slot_count) return NULL;
+    uint32_t mask = slot_count - 1;
+    for (uint32_t s = str_hash(title_id) & mask;; s = (s + 1) & mask) {
+        if (!slots[s].title_id[0]) return NULL;
+        if (strcmp(slots[s].title_id, title_id) == 0) return &slots[s];
+    }
+}
+
+static bool grow(void) {
+    uint32_t n = slot_count ? slot_count * 2 : MOUNTS_MIN_SLOTS;
+    struct MountEntry* fresh = (struct MountEntry*)calloc(n, sizeof(struct MountEntry));
+    if (!fresh) return false;
+    for (uint32_t i = 0; i < slot_count; i++) {
+        if (!slots[i].title_id[0]) continue;
+        uint32_t s = str_hash(slots[i].title_id) & (n - 1);
+        while (fresh[s].title_id[0]) s = (s + 1) & (n - 1);
+        fresh[s] = slots[i];
+    }
+    free(slots);
+    slots = fresh;
+    slot_count = n;
+    return true;
+}
+
+static struct MountEntry* find_or_add(const char* title_id) {
+    struct MountEntry* e = find(title_id);
+    if (e) return e;
+    if ((used_count + 1) * 2 > slot_count && !grow()) return NULL;
+    uint32_t mask = slot_count - 1;
+    uint32_t s = str_hash(title_id) & mask;
+    while (slots[s].title_id[0]) s = (s + 1) & mask;
+    snprintf(slots[s].title_id, sizeof(slots[s].title_id), "%s", title_id);
+    used_count++;
+    return &slots[s];
+}
+
+static void set_source(struct MountEntry* e, const char* src_path) {
+    e->source = path_intern(src_path);
+    e->flags |= MOUNT_MOUNTED;
+}
+
+static void clear_table(void) {
+    if (slot_count) memset(slots, 0, slot_count * sizeof(struct MountEntry));
+    used_count = 0;
+}
+
+// --- SNAPSHOT ---
+static bool is_nullfs(const struct statfs* fs) {
+    return strcmp(fs->f_fstypename, "nullfs") == 0;
+}
+
+// True when path lies on the filesystem mounted at mnt
+static bool path_under(const char* path, const char* mnt) {
+    size_t len = strlen(mnt);
+    if (len == 1 && mnt[0] == '/') return true;
+    return strncmp(path, mnt, len) == 0 && (path[len] == '/' || path[len] == '\0');
+}
+
+// Index of the filesystem that holds path (longest mount point match).
+// getfsstat() lists mounts oldest first, so a nullfs mount listed before its
+// backing filesystem was made before that drive was (re)attached: stale.
+static int backing_index(const int* backing, int backing_count, const char* path) {
+    int best = -1;
+    size_t best_len = 0;
+    for (int b = 0; b < backing_count; b++) {
+        const char* mnt = fs_buf[backing[b]].f_mntonname;
+        size_t len = strlen(mnt);
+        if (len >= best_len && path_under(path, mnt)) {
+            best = backing[b];
+            best_len = len;
+        }
+    }
+    return best;
+}
+
+// A statfs is ~2KB and every mounted title has one, so the snapshot is
+// sized per call and dropped again once the table is rebuilt.
+static int read_mount_table(void) {
+    int n = getfsstat(NULL, 0, MNT_NOWAIT);
+    if (n < 0) return -1;
+    int cap = n + 16;
+    fs_buf = (struct statfs*)malloc((size_t)cap * sizeof(struct statfs));
+    if (!fs_buf) return -1;
+    return getfsstat(fs_buf, (long)cap * (long)sizeof(struct statfs), MNT_NOWAIT);
+}
+
+static void release_mount_table(void) {
+    free(fs_buf);
+    fs_buf = NULL;
+}
+
+bool mounts_refresh(void) {
+    pthread_mutex_lock(&mounts_lock);
+    clear_table();
+    last_mounted = last_installed = last_stale = 0;
+
+    int n = read_mount_table();
+    if (n < 0) {
+        release_mount_table();
+        pthread_mutex_unlock(&mounts_lock);
+        log_debug("[MOUNTS] getfsstat failed, assuming nothing is mounted");
+        return false;
+    }
+
+    int backing[MOUNTS_MAX_BACKING];
+    int backing_count = 0;
+    for (int i = 0; i < n && backing_count < MOUNTS_MAX_BACKING; i++) {
+        if (!is_nullfs(&fs_buf[i])) backing[backing_count++] = i;
+    }
+
+    size_t prefix_len = strlen(MOUNTS_APP_DIR);
+    for (int i = 0; i < n; i++) {
+        const struct statfs* fs = &fs_buf[i];
+        if (!is_nullfs(fs) || strncmp(fs->f_mntonname, MOUNTS_APP_DIR, prefix_len) != 0) continue;
+        const char* title_id = fs->f_mntonname + prefix_len;
+        if (!title_id[0] || strchr(title_id, '/') || strlen(title_id) >= MAX_TITLE_ID) continue;
+
+        if (backing_index(backing, backing_count, fs->f_mntfromname) > i) {
+            log_debug("[MOUNTS] %s predates its source filesystem (%s), treating as unmounted",
+                      title_id, fs->f_mntfromname);
+            last_stale++;
+            // Its claim is stale too: the scan mounts it again
+            title_cache_remove(title_id);
+            continue;
+        }
+        struct MountEntry* e = find_or_add(title_id);
+        if (!e) break;
+        set_source(e, fs->f_mntfromname);
+        last_mounted++;
+    }
+    release_mount_table();
+
+    struct WalkDir w;
+    if (walk_open(&w, AT_FDCWD, "/user/app")) {
+        struct WalkEntry we;
+        while (walk_next(&w, &we)) {
+            if (we.name[0] == '.' || we.type != DT_DIR || strlen(we.name) >= MAX_TITLE_ID) continue;
+            struct MountEntry* e = find_or_add(we.name);
+            if (!e) break;
+            e->flags |= MOUNT_INSTALLED;
+            last_installed++;
+        }
+        walk_close(&w);
+    }
+    pthread_mutex_unlock(&mounts_lock);
+    return true;
+}
+
+// --- LOOKUPS ---
+static bool has_flag(const char* title_id, uint8_t flag) {
+    pthread_mutex_lock(&mounts_lock);
+    struct MountEntry* e = find(title_id);
+    bool set = e && (e->flags & flag);
+    pthread_mutex_unlock(&mounts_lock);
+    return set;
+}
+
+bool mounts_is_mounted(const char* title_id) {
+    return has_flag(title_id, MOUNT_MOUNTED);
+}
+
+bool mounts_is_installed(const char* title_id) {
+    return has_flag(title_id, MOUNT_INSTALLED);
+}
+
+bool mounts_get_source(const char* title_id, char* out, size_t size) {
+    pthread_mutex_lock(&mounts_lock);
+    struct MountEntry* e = find(title_id);
+    bool found = e && (e->flags & MOUNT_MOUNTED) && path_get(e->source, out, size);
+    pthread_mutex_unlock(&mounts_lock);
+    return found;
+}
+
+void mounts_note_mounted(const char* title_id, const char* src_path) {
+    pthread_mutex_lock(&mounts_lock);
+    struct MountEntry* e = find_or_add(title_id);
+    if (e) set_source(e, src_path);
+    pthread_mutex_unlock(&mounts_lock);
+}
+
+void mounts_note_installed(const char* title_id) {
+    pthread_mutex_lock(&mounts_lock);
+    struct MountEntry* e = find_or_add(title_id);
+    if (e) e->flags |= MOUNT_INSTALLED;
+    pthread_mutex_unlock(&mounts_lock);
+}
+
+void mounts_note_unmounted(const char* title_id) {
+    pthread_mutex_lock(&mounts_lock);
+    struct MountEntry* e = find(title_id);
+    if (e) {
+        e->source = 0;
+        e->flags &= (uint8_t)~MOUNT_MOUNTED;
+    }
+    pthread_mutex_unlock(&mounts_lock);
+}
+
+void mounts_foreach(mounts_visit_fn fn, void* ctx) {
+    pthread_mutex_lock(&mounts_lock);
+    for (uint32_t i = 0; i < slot_count; i++) {
+        const struct MountEntry* e = &slots[i];
+        if (!e->title_id[0] || !e->flags) continue;
+        bool mounted = (e->flags & MOUNT_MOUNTED) != 0;
+        fn(e->title_id, mounted, (e->flags & MOUNT_INSTALLED) != 0, mounted ? e->source : 0, ctx);
+    }
+    pthread_mutex_unlock(&mounts_lock);
+}
+
+void mounts_get_counts(int* mounted, int* installed, int* stale) {
+    pthread_mutex_lock(&mounts_lock);
+    *mounted = last_mounted;
+    *installed = last_installed;
+    *stale = last_stale;
+    pthread_mutex_unlock(&mounts_lock);
+}
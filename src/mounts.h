@@ -0,0 +1,40 @@
+#ifndef MOUNTS_H
+#define MOUNTS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "arena.h"
+
+// --- MOUNT TABLE SNAPSHOT ---
+// Taken once per pass: one getfsstat() for the nullfs mounts under
+// /system_ex/app and one read of /user/app. State checks are then lookups
+// that never reach through a mount to a (possibly sleeping) source drive.
+// Our own mounts and installs are noted so the snapshot stays current.
+// All functions are thread-safe.
+
+#define MOUNTS_APP_DIR      "/system_ex/app/"
+#define MOUNTS_MIN_SLOTS    256
+
+bool mounts_refresh(void);
+
+bool mounts_is_mounted(const char* title_id);
+bool mounts_is_installed(const char* title_id);
+
+// Copies the nullfs source of a mounted title; false if it is not mounted
+bool mounts_get_source(const char* title_id, char* out, size_t size);
+
+void mounts_note_mounted(const char* title_id, const char* src_path);
+void mounts_note_installed(const char* title_id);
+void mounts_note_unmounted(const char* title_id);
+
+// Calls fn for every known title with the lock held (fn must not call back
+// into this module). source is 0 when the title is not mounted.
+typedef void (*mounts_visit_fn)(const char* title_id, bool mounted, bool installed,
+                                path_id source, void* ctx);
+void mounts_foreach(mounts_visit_fn fn, void* ctx);
+
+// Results of the last refresh
+void mounts_get_counts(int* mounted, int* installed, int* stale);
+
+#endif
@@ -0,0 +1,282 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#include "shadowmount.h"
+#include "param.h"
+#include "stats.h"
+#include "iobuf.h"
+
+#define DRM_STANDARD "standard"
+
+// --- TOKENIZER ---
+static bool span_eq(struct ParamSpan s, const char* lit) {
+    size_t n = strlen(lit);
+    return s.p && s.len == n && memcmp(s.p, lit, n) == 0;
+}
+
+static const char* skip_ws(const char* p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) p++;
+    return p;
+}
+
+// p is just past the opening quote; returns the closing quote or NULL
+static const char* scan_string(const char* p, const char* end) {
+    while (p < end) {
+        const char* q = (const char*)memchr(p, '"', (size_t)(end - p));
+        if (!q) return NULL;
+        // Escaped if preceded by an odd number of backslashes
+        const char* b = q;
+        while (b > p && b[-1] == '\\') b--;
+        if (((q - b) & 1) == 0) return q;
+        p = q + 1;
+    }
+    return NULL;
+}
+
+// keys[d] names the value currently being parsed inside container d
+// (NULL inside arrays). Only the paths ShadowMount cares about are kept.
+static void on_string(struct ParamFields* f, const struct ParamSpan* keys, int depth, struct ParamSpan v) {
+    if (depth == 1) {
+        if (span_eq(keys[1], "titleId")) f->title_id = v;
+        else if (span_eq(keys[1], "title_id") && !f->title_id.p) f->title_id = v;
+        else if (span_eq(keys[1], "titleName")) f->title_name = v;
+        else if (span_eq(keys[1], "applicationDrmType")) f->drm_type = v;
+        return;
+    }
+    if (!span_eq(keys[1], "localizedParameters")) return;
+    if (depth == 2 && span_eq(keys[2], "defaultLanguage")) {
+        f->default_lang = v;
+    } else if (depth == 3 && keys[2].p && span_eq(keys[3], "titleName") && f->lang_count < PARAM_MAX_LANGS) {
+        f->langs[f->lang_count] = keys[2];
+        f->lang_names[f->lang_count] = v;
+        f->lang_count++;
+    }
+}
+
+bool param_parse(const char* buf, size_t len, struct ParamFields* f) {
+    memset(f, 0, sizeof(*f));
+    struct ParamSpan keys[PARAM_MAX_DEPTH];
+    bool is_object[PARAM_MAX_DEPTH];
+    int depth = 0;
+    bool want_key = false;
+    const char* p = buf;
+    const char* end = buf + len;
+
+    while ((p = skip_ws(p, end)) < end) {
+        char c = *p;
+        if (c == '{' || c == '[') {
+            if (depth + 1 >= PARAM_MAX_DEPTH) return false;
+            depth++;
+            is_object[depth] = (c == '{');
+            keys[depth].p = NULL;
+            keys[depth].len = 0;
+            want_key = is_object[depth];
+            p++;
+        } else if (c == '}' || c == ']') {
+            if (depth == 0) return false;
+            depth--;
+            want_key = false;
+            p++;
+        } else if (c == ',') {
+            if (depth == 0) return false;
+            want_key = is_object[depth];
+            if (!is_object[depth]) keys[depth].p = NULL;
+            p++;
+        } else if (c == '"') {
+            const char* close = scan_string(p + 1, end);
+            if (!close) return false;
+            struct ParamSpan s = { p + 1, (size_t)(close - p - 1) };
+            p = close + 1;
+            if (want_key) {
+                keys[depth] = s;
+                p = skip_ws(p, end);
+                if (p >= end || *p != ':') return false;
+                p++;
+                want_key = false;
+            } else if (depth > 0 && is_object[depth]) {
+                on_string(f, keys, depth, s);
+            }
+        } else {
+            // Number, true, false, null
+            while (p < end && *p != ',' && *p != '}' && *p != ']' &&
+                   *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r') p++;
+        }
+    }
+    return f->title_id.p && f->title_id.len > 0;
+}
+
+// --- STRINGS ---
+static int hex4(const char* p, const char* end) {
+    if (end - p < 4) return -1;
+    int v = 0;
+    for (int i = 0; i < 4; i++) {
+        char c = p[i];
+        v <<= 4;
+        if (c >= '0' && c <= '9') v |= c - '0';
+        else if (c >= 'a' && c <= 'f') v |= c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') v |= c - 'A' + 10;
+        else return -1;
+    }
+    return v;
+}
+
+void param_copy(struct ParamSpan s, char* out, size_t size) {
+    const char* p = s.p;
+    const char* end = s.p + s.len;
+    size_t o = 0;
+    while (p < end && o + 1 < size) {
+        if (*p != '\\' || p + 1 >= end) {
+            out[o++] = *p++;
+            continue;
+        }
+        char e = p[1];
+        p += 2;
+        char c;
+        switch (e) {
+            case 'n': c = '\n'; break;
+            case 't': c = '\t'; break;
+            case 'r': c = '\r'; break;
+            case 'b': c = '\b'; break;
+            case 'f': c = '\f'; break;
+            case 'u': {
+                int cp = hex4(p, end);
+                if (cp < 0) { c = '?'; break; }
+                p += 4;
+                // Surrogate pair
+                if (cp >= 0xD800 && cp <= 0xDBFF && end - p >= 6 && p[0] == '\\' && p[1] == 'u') {
+                    int lo = hex4(p + 2, end);
+                    if (lo >= 0xDC00 && lo <= 0xDFFF) {
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                        p += 6;
+                    }
+                }
+                char u[4];
+                size_t n;
+                if (cp < 0x80) { u[0] = (char)cp; n = 1; }
+                else if (cp < 0x800) { u[0] = (char)(0xC0 | (cp >> 6)); u[1] = (char)(0x80 | (cp & 0x3F)); n = 2; }
+                else if (cp < 0x10000) { u[0] = (char)(0xE0 | (cp >> 12)); u[1] = (char)(0x80 | ((cp >> 6) & 0x3F)); u[2] = (char)(0x80 | (cp & 0x3F)); n = 3; }
+                else { u[0] = (char)(0xF0 | (cp >> 18)); u[1] = (char)(0x80 | ((cp >> 12) & 0x3F)); u[2] = (char)(0x80 | ((cp >> 6) & 0x3F)); u[3] = (char)(0x80 | (cp & 0x3F)); n = 4; }
+                if (o + n >= size) goto done; // Never cut a character in half
+                memcpy(out + o, u, n);
+                o += n;
+                continue;
+            }
+            default: c = e; break; // \" \\ \/
+        }
+        out[o++] = c;
+    }
+done:
+    out[o] = '\0';
+}
+
+void param_pick_name(const struct ParamFields* f, char* out, size_t size) {
+    int pick = -1;
+    for (int i = 0; i < f->lang_count && pick < 0; i++) {
+        if (span_eq(f->langs[i], "en-US")) pick = i;
+    }
+    for (int i = 0; i < f->lang_count && pick < 0 && f->default_lang.p; i++) {
+        if (f->langs[i].len == f->default_lang.len &&
+            memcmp(f->langs[i].p, f->default_lang.p, f->langs[i].len) == 0) pick = i;
+    }
+    if (pick < 0 && f->lang_count > 0) pick = 0;
+
+    out[0] = '\0';
+    if (pick >= 0) param_copy(f->lang_names[pick], out, size);
+    if (!out[0] && f->title_name.p) param_copy(f->title_name, out, size);
+    if (!out[0]) param_copy(f->title_id, out, size);
+}
+
+// --- DRM PATCH ---
+// "upgradable" and friends are longer than "standard", so the value is
+// rewritten in place and padded with whitespace. Anything shorter needs the
+// file rewritten (temp file + rename).
+static bool write_all_at(int fd, const char* data, size_t len, off_t off) {
+    while (len > 0) {
+        ssize_t n = pwrite(fd, data, len, off);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        len -= (size_t)n;
+        off += n;
+    }
+    return true;
+}
+
+static bool patch_drm(int dir_fd, const char* rel, const char* buf, size_t len, struct ParamSpan v) {
+    const size_t std_len = sizeof(DRM_STANDARD) - 1;
+    size_t off = (size_t)(v.p - buf);
+
+    if (v.len >= std_len) {
+        char patch[64];
+        if (v.len + 1 > sizeof(patch)) return false;
+        memcpy(patch, DRM_STANDARD "\"", std_len + 1);
+        memset(patch + std_len + 1, ' ', v.len - std_len);
+        int fd = openat(dir_fd, rel, O_WRONLY | O_CLOEXEC);
+        if (fd < 0) return false;
+        bool ok = write_all_at(fd, patch, v.len + 1, (off_t)off);
+        if (close(fd) != 0) ok = false;
+        return ok;
+    }
+
+    char tmp[MAX_PATH];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", rel);
+    int fd = openat(dir_fd, tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd < 0) return false;
+    size_t tail = off + v.len;
+    bool ok = write_all_at(fd, buf, off, 0) &&
+              write_all_at(fd, DRM_STANDARD, std_len, (off_t)off) &&
+              write_all_at(fd, buf + tail, len - tail, (off_t)(off + std_len)) &&
+              fsync(fd) == 0;
+    if (close(fd) != 0) ok = false;
+    if (ok && renameat(dir_fd, tmp, dir_fd, rel) == 0) return true;
+    unlinkat(dir_fd, tmp, 0);
+    return false;
+}
+
+// --- FILE ---
+bool param_read_at(int dir_fd, const char* rel, off_t size,
+                   char* out_id, char* out_name, bool* drm_patched) {
+    *drm_patched = false;
+    if (size <= 0 || size > PARAM_MAX_SIZE) return false;
+    int fd = openat(dir_fd, rel, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    stats_add(STAT_PARAM_READS, 1);
+
+    // Larger files go to a pooled buffer, never a mapping: a drive unplugged
+    // or a file truncated mid-read is a read error, not a SIGBUS
+    char stack_buf[PARAM_STACK_BUF];
+    size_t cap = size <= PARAM_STACK_BUF ? PARAM_STACK_BUF : IOBUF_LARGE;
+    char* pooled = cap == PARAM_STACK_BUF ? NULL : iobuf_get(cap);
+    char* buf = cap == PARAM_STACK_BUF ? stack_buf : pooled;
+    size_t len = 0;
+    ssize_t n = -1;
+    if (buf) {
+        while ((n = read(fd, buf + len, cap - len)) > 0) len += (size_t)n;
+    }
+    close(fd);
+    // A short read (file changed since the stat) is a failure like an I/O error
+    if (n != 0 || len != (size_t)size) buf = NULL;
+
+    struct ParamFields f;
+    bool ok = buf && param_parse(buf, len, &f);
+    if (ok) {
+        param_copy(f.title_id, out_id, MAX_TITLE_ID);
+        param_pick_name(&f, out_name, MAX_TITLE_NAME);
+        if (f.drm_type.p && !span_eq(f.drm_type, DRM_STANDARD)) {
+            if (patch_drm(dir_fd, rel, buf, len, f.drm_type)) {
+                *drm_patched = true;
+                log_debug("  [DRM] %s: applicationDrmType patched to standard", out_id);
+            } else {
+                log_debug("  [DRM] %s: patch failed: %s", out_id, strerror(errno));
+            }
+        }
+    }
+    iobuf_put(pooled, cap);
+    return ok;
+}
@@ -0,0 +1,48 @@
+#ifndef PARAM_H
+#define PARAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+// --- PARAM.JSON ---
+// One forward pass over the file (read onto the stack, or into a pooled
+// iobuf for large files) finds titleId, every localized titleName and
+// applicationDrmType. Fields are spans into the buffer, still JSON-escaped.
+
+#define PARAM_MAX_SIZE      (1024 * 1024) // Fits one IOBUF_LARGE buffer
+#define PARAM_STACK_BUF     (16 * 1024)   // Smaller files are read onto the stack
+#define PARAM_MAX_DEPTH     16
+#define PARAM_MAX_LANGS     64
+
+struct ParamSpan {
+    const char* p;
+    size_t len;
+};
+
+struct ParamFields {
+    struct ParamSpan title_id;      // titleId (or legacy title_id)
+    struct ParamSpan title_name;    // Top-level titleName, if any
+    struct ParamSpan default_lang;  // localizedParameters.defaultLanguage
+    struct ParamSpan drm_type;      // applicationDrmType value
+    int lang_count;
+    struct ParamSpan langs[PARAM_MAX_LANGS];
+    struct ParamSpan lang_names[PARAM_MAX_LANGS];
+};
+
+// False on malformed input or when no title id was found
+bool param_parse(const char* buf, size_t len, struct ParamFields* out);
+
+// en-US, then defaultLanguage, then the first localized name, then the
+// top-level titleName, then the title id
+void param_pick_name(const struct ParamFields* f, char* out, size_t size);
+
+// Copies a span with JSON escapes decoded (\uXXXX becomes UTF-8)
+void param_copy(struct ParamSpan s, char* out, size_t size);
+
+// Parses dir_fd/rel and patches applicationDrmType to "standard" on disk when
+// needed; size is the file size from a prior stat.
+bool param_read_at(int dir_fd, const char* rel, off_t size,
+                   char* out_id, char* out_name, bool* drm_patched);
+
+#endif
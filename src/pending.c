@@ -0,0 +1,293 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "shadowmount.h"
+#include "pending.h"
+#include "arena.h"
+#include "health.h"
+#include "walk.h"
+
+#define RELEASE_TIMEOUT_US  30000000    // Forget a released game nobody picked up
+
+enum pending_state {
+    PENDING_WAITING,
+    PENDING_READY,      // Quiet long enough, waiting for pending_pop_ready()
+    PENDING_RELEASED    // Popped, the rescan's pending_check() will let it through
+};
+
+struct Sample {
+    unsigned long long bytes;
+    unsigned long files;
+    long long newest_ns;
+};
+
+struct PendingCopy {
+    path_id path;
+    const char* title_id;       // Interned
+    const char* title_name;
+    int depth;
+    enum pending_state state;
+    struct Sample last;
+    bool sampled;
+    long long first_seen_us;
+    long long last_change_us;
+    long long next_sample_us;
+    long long released_us;
+    long long last_progress_us;
+};
+
+static struct PendingCopy items[PENDING_MAX];
+static int item_count = 0;
+static long long quiet_us = PENDING_QUIET_MS * 1000LL;
+static pthread_mutex_t pending_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static struct PendingCopy* find(path_id path) {
+    for (int i = 0; path && i < item_count; i++) {
+        if (items[i].path == path) return &items[i];
+    }
+    return NULL;
+}
+
+static void remove_item(struct PendingCopy* p) {
+    struct PendingCopy* last = &items[item_count - 1];
+    if (p != last) *p = *last;
+    item_count--;
+}
+
+// Folder and sce_sys untouched for the whole quiet window: no need to sample
+static bool looks_settled(const char* path) {
+    struct stat st;
+    time_t now = time(NULL);
+    long quiet_s = (long)(__atomic_load_n(&quiet_us, __ATOMIC_RELAXED) / 1000000);
+    if (stat(path, &st) != 0 || difftime(now, st.st_mtime) <= quiet_s) return false;
+    char sys_path[MAX_PATH];
+    snprintf(sys_path, sizeof(sys_path), "%s/sce_sys", path);
+    if (stat(sys_path, &st) != 0) return true; // No sce_sys? Trust root.
+    return difftime(now, st.st_mtime) > quiet_s;
+}
+
+// --- PUBLIC API ---
+bool pending_check(const char* path, const char* title_id, const char* title_name, int depth) {
+    pthread_mutex_lock(&pending_lock);
+    struct PendingCopy* p = find(path_find(path));
+    if (p) {
+        bool go = p->state != PENDING_WAITING;
+        if (go) remove_item(p);
+        pthread_mutex_unlock(&pending_lock);
+        return go;
+    }
+    pthread_mutex_unlock(&pending_lock);
+
+    if (looks_settled(path)) return true;
+
+    // Out of memory: nothing to park it with, install it as is
+    path_id id = path_intern(path);
+    const char* tid = intern_str(title_id);
+    const char* name = intern_str(title_name);
+    if (!id || !tid || !name) return true;
+
+    pthread_mutex_lock(&pending_lock);
+    if (!find(id)) {
+        if (item_count == PENDING_MAX) {
+            pthread_mutex_unlock(&pending_lock);
+            log_debug("  [WAIT] Pending queue full, %s will be retried on a later pass", title_name);
+            return false;
+        }
+        p = &items[item_count++];
+        memset(p, 0, sizeof(*p));
+        p->path = id;
+        p->title_id = tid;
+        p->title_name = name;
+        p->depth = depth;
+        p->first_seen_us = p->last_change_us = p->next_sample_us = monotonic_us();
+        log_debug("  [WAIT] %s is still changing, sampling it until quiet for %llds",
+                  title_name, __atomic_load_n(&quiet_us, __ATOMIC_RELAXED) / 1000000);
+    }
+    pthread_mutex_unlock(&pending_lock);
+    return false;
+}
+
+// --- SAMPLING ---
+static void sample_dir(int parent_fd, const char* name, int depth, struct Sample* s) {
+    struct WalkDir w;
+    if (depth > PENDING_MAX_DEPTH || !walk_open(&w, parent_fd, name)) return;
+    struct WalkEntry e;
+    while (walk_next(&w, &e)) {
+        if (e.type == DT_DIR) {
+            sample_dir(w.fd, e.name, depth + 1, s);
+            continue;
+        }
+        struct stat st;
+        if (e.has_stat) st = e.st;
+        else if (walk_stat(w.fd, e.name, &st) != 0) continue;
+        long long ns = (long long)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+        if (ns > s->newest_ns) s->newest_ns = ns;
+        s->bytes += (unsigned long long)st.st_size;
+        s->files++;
+    }
+    // Entries being added or removed show up here even before any file grows
+    struct stat dst;
+    if (fstat(w.fd, &dst) == 0) {
+        long long ns = (long long)dst.st_mtim.tv_sec * 1000000000LL + dst.st_mtim.tv_nsec;
+        if (ns > s->newest_ns) s->newest_ns = ns;
+    }
+    walk_close(&w);
+}
+
+static void report_progress(struct PendingCopy* p, long long now) {
+    double gb = p->last.bytes / (1024.0 * 1024.0 * 1024.0);
+    double secs = (now - p->first_seen_us) / 1000000.0;
+    log_debug("  [WAIT] %s: %.1f GB in %lu file(s), copying for %.0fs", p->title_name, gb, p->last.files, secs);
+    notify_system("Copying %s\n%.1f GB so far", p->title_name, gb);
+}
+
+static void apply_sample(struct PendingCopy* p, const struct Sample* s, long long cost, long long now) {
+    long long quiet = __atomic_load_n(&quiet_us, __ATOMIC_RELAXED);
+    bool changed = !p->sampled || s->bytes != p->last.bytes || s->files != p->last.files ||
+                   s->newest_ns != p->last.newest_ns;
+    if (changed) {
+        if (p->sampled && s->bytes != p->last.bytes) {
+            long long dt = now - p->last_change_us;
+            log_trace("  [WAIT] %s: %llu MB, %lu file(s), %.1f MB/s", p->title_name,
+                      s->bytes >> 20, s->files,
+                      dt > 0 ? (double)(long long)(s->bytes - p->last.bytes) / dt : 0.0);
+        }
+        p->last = *s;
+        p->sampled = true;
+        p->last_change_us = now;
+        if (s->bytes >= PENDING_PROGRESS_BYTES && now - p->last_progress_us >= PENDING_PROGRESS_US) {
+            p->last_progress_us = now;
+            report_progress(p, now);
+        }
+    } else if (now - p->last_change_us >= quiet) {
+        log_debug("  [WAIT] %s quiet for %llds (%llu MB, %lu file(s)), installing",
+                  p->title_name, quiet / 1000000, s->bytes >> 20, s->files);
+        p->state = PENDING_READY;
+        return;
+    }
+    long long interval = PENDING_SAMPLE_MS * 1000LL;
+    if (cost * PENDING_SAMPLE_SHARE > interval) interval = cost * PENDING_SAMPLE_SHARE;
+    p->next_sample_us = now + interval;
+}
+
+void pending_poll(void) {
+    char path[MAX_PATH];
+    pthread_mutex_lock(&pending_lock);
+    int i = 0;
+    while (i < item_count) {
+        struct PendingCopy* p = &items[i];
+        long long now = monotonic_us();
+        if (p->state == PENDING_RELEASED && now - p->released_us > RELEASE_TIMEOUT_US) {
+            remove_item(p);
+            continue;
+        }
+        if (p->state != PENDING_WAITING || now < p->next_sample_us || !path_get(p->path, path, sizeof(path))) {
+            i++;
+            continue;
+        }
+        // A parked copy on a quarantined drive waits for it to come back
+        if (!health_usable(path)) {
+            i++;
+            continue;
+        }
+
+        // Sample without the lock so scan workers are never held up
+        path_id id = p->path;
+        pthread_mutex_unlock(&pending_lock);
+        struct Sample s = {0};
+        struct stat st;
+        bool ready = health_ready(path);
+        bool exists = ready && stat(path, &st) == 0;
+        if (exists) sample_dir(AT_FDCWD, path, 0, &s);
+        long long done = monotonic_us();
+        pthread_mutex_lock(&pending_lock);
+
+        p = find(id);
+        if (!p) continue;
+        if (!ready) {
+            i++;
+            continue;
+        }
+        if (!exists) {
+            log_debug("  [WAIT] %s disappeared, dropping it", p->title_name);
+            remove_item(p);
+            continue;
+        }
+        apply_sample(p, &s, done - now, done);
+        i++;
+    }
+    pthread_mutex_unlock(&pending_lock);
+}
+
+bool pending_pop_ready(char* out_path, size_t size, int* out_depth) {
+    pthread_mutex_lock(&pending_lock);
+    for (int i = 0; i < item_count; i++) {
+        struct PendingCopy* p = &items[i];
+        if (p->state != PENDING_READY) continue;
+        if (!path_get(p->path, out_path, size)) continue;
+        p->state = PENDING_RELEASED;
+        p->released_us = monotonic_us();
+        *out_depth = p->depth;
+        pthread_mutex_unlock(&pending_lock);
+        return true;
+    }
+    pthread_mutex_unlock(&pending_lock);
+    return false;
+}
+
+long long pending_next_due_us(void) {
+    pthread_mutex_lock(&pending_lock);
+    long long now = monotonic_us();
+    long long next = -1;
+    for (int i = 0; i < item_count; i++) {
+        long long due;
+        if (items[i].state == PENDING_WAITING) due = items[i].next_sample_us;
+        else if (items[i].state == PENDING_READY) due = now;
+        else continue;
+        if (next < 0 || due < next) next = due;
+    }
+    pthread_mutex_unlock(&pending_lock);
+    if (next < 0) return -1;
+    return next > now ? next - now : 0;
+}
+
+int pending_count(void) {
+    pthread_mutex_lock(&pending_lock);
+    int n = item_count;
+    pthread_mutex_unlock(&pending_lock);
+    return n;
+}
+
+void pending_reload_config(void) {
+    static time_t last_mtime = 0;
+    static bool had_file = false;
+    struct stat st;
+    if (stat(PENDING_QUIET_FILE, &st) != 0) {
+        if (had_file) __atomic_store_n(&quiet_us, PENDING_QUIET_MS * 1000LL, __ATOMIC_RELAXED);
+        had_file = false;
+        return;
+    }
+    if (had_file && st.st_mtime == last_mtime) return;
+    had_file = true;
+    last_mtime = st.st_mtime;
+
+    char buf[16] = {0};
+    FILE* f = fopen(PENDING_QUIET_FILE, "r");
+    if (!f) return;
+    size_t n = fread(buf, 1, sizeof(buf) - 1, f);
+    fclose(f);
+    buf[n] = '\0';
+    int secs = atoi(buf);
+    if (secs < 1 || secs > 3600) {
+        log_debug("[WAIT] Ignoring stability window '%s' (1-3600 seconds)", buf);
+        return;
+    }
+    __atomic_store_n(&quiet_us, secs * 1000000LL, __ATOMIC_RELAXED);
+    log_debug("[WAIT] Stability window set to %ds", secs);
+}
@@ -0,0 +1,39 @@
+#ifndef PENDING_H
+#define PENDING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// --- PENDING COPIES ---
+// Games whose folder changed recently are parked here instead of sleeping
+// inside the scan. The main loop samples each one (total size, file count,
+// newest mtime) and hands it back for install once nothing has changed for
+// the quiet window. Large copies get progress reports while they run.
+
+#define PENDING_MAX             32
+#define PENDING_QUIET_MS        10000   // Default quiet window
+#define PENDING_QUIET_FILE      "/data/shadowmount/stability_window" // Seconds, optional
+#define PENDING_SAMPLE_MS       2000
+#define PENDING_SAMPLE_SHARE    10      // Sampling may use at most 1/N of the time
+#define PENDING_MAX_DEPTH       32
+#define PENDING_PROGRESS_BYTES  (1024ULL * 1024 * 1024) // Report copies larger than this
+#define PENDING_PROGRESS_US     60000000
+
+// Thread-safe. True when the game may be installed now; false when it was
+// (or still is) parked. A parked game that became ready is released here.
+bool pending_check(const char* path, const char* title_id, const char* title_name, int depth);
+
+// Main loop: samples every candidate that is due
+void pending_poll(void);
+
+// Next candidate that has been quiet long enough (call pending_check via a rescan)
+bool pending_pop_ready(char* out_path, size_t size, int* out_depth);
+
+// Microseconds until the next sample is due (-1 = nothing pending)
+long long pending_next_due_us(void);
+int pending_count(void);
+
+// Re-reads PENDING_QUIET_FILE when it changed
+void pending_reload_config(void);
+
+#endif
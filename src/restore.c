@@ -0,0 +1,147 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <pthread.h>
+
+#include "shadowmount.h"
+#include "restore.h"
+#include "install.h"
+#include "mounts.h"
+#include "scan.h"
+#include "walk.h"
+#include "devmap.h"
+#include "arena.h"
+#include "health.h"
+
+struct RestoreItem {
+    char title_id[MAX_TITLE_ID];
+    const char* title_name;     // Interned once the source checked out
+    path_id source;
+    int device;
+    bool ok;
+};
+
+struct RestoreDevice {
+    char key[MAX_PATH];
+    struct RestoreItem* items;
+    int item_count;
+    int index;
+    pthread_t thread;
+    bool threaded;
+};
+
+// The source must still be a game with the same title_id
+static void* check_worker(void* arg) {
+    struct RestoreDevice* d = (struct RestoreDevice*)arg;
+    for (int i = 0; i < d->item_count; i++) {
+        struct RestoreItem* it = &d->items[i];
+        if (it->device != d->index) continue;
+        char source[MAX_PATH] = "?", title_id[MAX_TITLE_ID], title_name[MAX_TITLE_NAME];
+        it->ok = path_get(it->source, source, sizeof(source)) &&
+                 get_game_info(source, title_id, title_name) && strcmp(title_id, it->title_id) == 0 &&
+                 (it->title_name = intern_str(title_name)) != NULL;
+        if (!it->ok) log_debug("  [RESTORE] %s: source %s is gone", it->title_id, source);
+    }
+    return NULL;
+}
+
+static int collect(struct RestoreItem** out) {
+    struct RestoreItem* items = NULL;
+    int count = 0, capacity = 0;
+    struct WalkDir w;
+    if (!walk_open(&w, AT_FDCWD, "/user/app")) return 0;
+    struct WalkEntry e;
+    char source[MAX_PATH], mounted_from[MAX_PATH];
+    while (walk_next(&w, &e)) {
+        if (e.name[0] == '.' || e.type != DT_DIR || strlen(e.name) >= MAX_TITLE_ID) continue;
+        if (!install_read_tracker(e.name, source, sizeof(source))) continue;
+        // Seed the device map even for drives that are not plugged in yet
+        devmap_note(e.name, NULL, source);
+        if (!health_usable(source)) continue;
+        // Still mounted from the same place (daemon restarted without a reboot)
+        if (mounts_get_source(e.name, mounted_from, sizeof(mounted_from)) &&
+            strcmp(mounted_from, source) == 0) continue;
+        if (count == capacity) {
+            int cap = capacity ? capacity * 2 : 64;
+            struct RestoreItem* grown = (struct RestoreItem*)realloc(items, cap * sizeof(*items));
+            if (!grown) break;
+            items = grown;
+            capacity = cap;
+        }
+        struct RestoreItem* it = &items[count++];
+        memset(it, 0, sizeof(*it));
+        snprintf(it->title_id, sizeof(it->title_id), "%s", e.name);
+        it->source = path_intern(source);
+        if (!it->source) count--;
+    }
+    walk_close(&w);
+    *out = items;
+    return count;
+}
+
+int restore_known_mounts(void) {
+    long long t0 = monotonic_us();
+    mounts_refresh();
+    struct RestoreItem* items = NULL;
+    int count = collect(&items);
+    if (count == 0) {
+        free(items);
+        return 0;
+    }
+
+    // Group sources by drive so a sleeping USB disk only delays its own titles
+    struct RestoreDevice devices[RESTORE_MAX_DEVICES];
+    int device_count = 0;
+    for (int i = 0; i < count; i++) {
+        char key[MAX_PATH], source[MAX_PATH];
+        path_get(items[i].source, source, sizeof(source));
+        devmap_device_of(source, key, sizeof(key));
+        int d = 0;
+        while (d < device_count && strcmp(devices[d].key, key) != 0) d++;
+        if (d == device_count) {
+            if (device_count == RESTORE_MAX_DEVICES) d = 0;
+            else {
+                memset(&devices[d], 0, sizeof(devices[d]));
+                snprintf(devices[d].key, sizeof(devices[d].key), "%s", key);
+                devices[d].items = items;
+                devices[d].item_count = count;
+                devices[d].index = d;
+                device_count++;
+            }
+        }
+        items[i].device = d;
+    }
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, SCAN_WORKER_STACK);
+    for (int d = 0; d < device_count; d++) {
+        if (device_count > 1 && pthread_create(&devices[d].thread, &attr, check_worker, &devices[d]) == 0) {
+            devices[d].threaded = true;
+        } else {
+            check_worker(&devices[d]);
+        }
+    }
+    pthread_attr_destroy(&attr);
+    for (int d = 0; d < device_count; d++) {
+        if (devices[d].threaded) pthread_join(devices[d].thread, NULL);
+    }
+    long long checked_us = monotonic_us();
+
+    int queued = 0;
+    char source[MAX_PATH];
+    for (int i = 0; i < count; i++) {
+        if (!items[i].ok || !path_get(items[i].source, source, sizeof(source))) continue;
+        install_queue(source, items[i].title_id, items[i].title_name, true);
+        queued++;
+    }
+    int installed = 0, mounted = 0;
+    install_flush(&installed, &mounted);
+    free(items);
+
+    log_debug("[RESTORE] %d of %d tracked title(s) remounted in %lldms (%d drive(s) checked in %lldms)",
+              mounted, count, (monotonic_us() - t0) / 1000, device_count, (checked_us - t0) / 1000);
+    if (queued < count) log_debug("[RESTORE] %d title(s) left for the scan to find", count - queued);
+    return mounted;
+}
@@ -0,0 +1,15 @@
+#ifndef RESTORE_H
+#define RESTORE_H
+
+// --- BOOT RESTORE ---
+// Before the first scan, every installed title with a mount.lnk tracker is
+// remounted straight from the recorded source. Sources are checked by one
+// worker per drive, then all surviving titles go through a single mount
+// batch, so known games are playable before discovery starts.
+
+#define RESTORE_MAX_DEVICES 16
+
+// Returns the number of titles remounted
+int restore_known_mounts(void);
+
+#endif
@@ -0,0 +1,668 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include "shadowmount.h"
+#include "cache.h"
+#include "index.h"
+#include "watcher.h"
+#include "scan.h"
+#include "walk.h"
+#include "install.h"
+#include "stats.h"
+#include "mounts.h"
+#include "schedule.h"
+#include "pending.h"
+#include "dircache.h"
+#include "sources.h"
+#include "health.h"
+#include "journal.h"
+
+// Scan Paths - Only specific folders (no parent/child duplicates)
+const char* SCAN_PATHS[] = {
+    // Internal Storage
+    "/data/homebrew", 
+    "/data/etaHEN/games",
+
+    // Extended Storage (ext0)
+    "/mnt/ext0/homebrew", 
+    "/mnt/ext0/etaHEN/homebrew", 
+    "/mnt/ext0/etaHEN/games",
+
+    // M.2 Drive (ext1)
+    "/mnt/ext1/homebrew", 
+    "/mnt/ext1/etaHEN/homebrew", 
+    "/mnt/ext1/etaHEN/games",
+    
+    // USB Subfolders (usb0-usb7) - only specific paths, no root scan
+    "/mnt/usb0/homebrew", "/mnt/usb1/homebrew", "/mnt/usb2/homebrew", "/mnt/usb3/homebrew",
+    "/mnt/usb4/homebrew", "/mnt/usb5/homebrew", "/mnt/usb6/homebrew", "/mnt/usb7/homebrew",
+    
+    "/mnt/usb0/etaHEN/games", "/mnt/usb1/etaHEN/games", "/mnt/usb2/etaHEN/games", "/mnt/usb3/etaHEN/games",
+    "/mnt/usb4/etaHEN/games", "/mnt/usb5/etaHEN/games", "/mnt/usb6/etaHEN/games", "/mnt/usb7/etaHEN/games",
+    
+    NULL
+};
+
+// --- Global counters for installed/mounted games ---
+int g_installed_count = 0;
+int g_mounted_count = 0;
+
+#define SCAN_ROOT_COUNT ((int)(sizeof(SCAN_PATHS) / sizeof(SCAN_PATHS[0])) - 1)
+
+// --- SYNCHRONIZATION ---
+// Device workers share the title cache (whoever claims a title_id first
+// processes it) and only queue mounts; a batch runs as each drive finishes.
+static bool deterministic = false;
+
+void scan_set_deterministic(bool enabled) {
+    deterministic = enabled;
+}
+
+// Duplicate copies met during the current pass; a gauge, not a total
+static int pass_mismatches = 0;
+
+
+// --- RECURSIVE SCAN HELPER ---
+static void process_game(const char* full_path, const char* title_id, const char* title_name, int depth) {
+    // STEP 1: Check current state
+    bool installed = is_installed(title_id);
+    bool mounted = is_data_mounted(title_id);
+    sources_note(title_id, full_path);
+    // Cut off by a crash and left open while its drive was out: redone as a
+    // fresh install, the journal skips the steps already done
+    bool unfinished = journal_is_open(title_id);
+    
+    // STEP 2: If mounted, the game is working - skip completely
+    // (nullfs provides all needed files via /system_ex/app/)
+    if (mounted && !unfinished) {
+        char source[MAX_PATH];
+        if (!mounts_get_source(title_id, source, sizeof(source)) || strcmp(source, full_path) == 0) {
+            // Game is functional, no action needed
+            return;
+        }
+        // Mounted from another copy: keep it while that copy still exists,
+        // unless this one sits on a clearly faster drive
+        __atomic_fetch_add(&pass_mismatches, 1, __ATOMIC_RELAXED);
+        struct stat st;
+        if (stat(source, &st) != 0) {
+            log_debug("[MOUNTS] %s source %s is gone, remounting from %s", title_id, source, full_path);
+        } else if (sources_prefer(full_path, source)) {
+            log_debug("[SOURCES] %s: moving from %s to faster copy %s", title_id, source, full_path);
+            stats_add(STAT_SOURCE_SWITCHES, 1);
+        } else {
+            log_trace("[MOUNTS] %s mounted from %s, duplicate at %s", title_id, source, full_path);
+            return;
+        }
+    }
+    
+    // STEP 3: Claim the title so no other worker (or later pass) processes it again
+    if (!title_cache_claim(full_path, title_id, title_name)) {
+        // Already handled this title_id in this session: another copy found
+        // on a faster drive, or any copy once the claimed folder is gone
+        // (renamed or deleted without a watcher event), takes over the claim
+        char claimed[MAX_PATH];
+        struct stat st;
+        if (!title_cache_get_path(title_id, claimed, sizeof(claimed)) || strcmp(claimed, full_path) == 0 ||
+            (!sources_prefer(full_path, claimed) && (!health_usable(claimed) || stat(claimed, &st) == 0))) {
+            stats_add(STAT_TITLE_CACHE_HITS, 1);
+            return;
+        }
+        title_cache_remove(title_id);
+        if (!title_cache_claim(full_path, title_id, title_name)) return;
+    }
+    stats_add(STAT_TITLE_CACHE_CLAIMS, 1);
+    
+    // STEP 5: Not mounted - determine action needed
+    log_debug("[PROCESS] %s (%s) - installed=%d", title_name, title_id, installed);
+    
+    // CASE A: Installed but not mounted -> Just mount
+    if (installed && !unfinished) {
+        install_queue(full_path, title_id, title_name, true);
+        return;
+    }
+    
+    // CASE B: Not installed at all -> Fresh install
+    if (!pending_check(full_path, title_id, title_name, depth)) {
+        // Still copying: the pending queue hands it back once it is quiet
+        title_cache_remove(title_id);
+        return;
+    }
+    install_queue(full_path, title_id, title_name, false);
+}
+
+// Subfolder names of a listing, recorded in the directory cache
+struct NameList {
+    char* buf;
+    size_t len;
+    size_t cap;
+    uint32_t count;
+    bool failed;
+};
+
+static void names_add(struct NameList* n, const char* name, size_t name_len) {
+    if (n->failed) return;
+    if (n->len + name_len + 1 > n->cap) {
+        size_t cap = n->cap ? n->cap * 2 : 256;
+        while (cap < n->len + name_len + 1) cap *= 2;
+        char* grown = (char*)realloc(n->buf, cap);
+        if (!grown) {
+            n->failed = true;
+            return;
+        }
+        n->buf = grown;
+        n->cap = cap;
+    }
+    memcpy(n->buf + n->len, name, name_len + 1);
+    n->len += name_len + 1;
+    n->count++;
+}
+
+// Every kqueue watch holds an open fd, which makes a plain unmount of the
+// drive fail with EBUSY. On removable drives (under /mnt) only the scan
+// roots are watched; new folders deeper down are found by the scheduler's
+// root mtime checks and idle walks.
+static void watch_folder(const char* path, int depth) {
+    if (depth > 0 && strncmp(path, "/mnt/", 5) == 0) return;
+    watcher_add(path, depth, WATCH_SCAN);
+}
+
+static bool scan_walk(struct WalkDir* w, char* path, size_t len, int depth, struct NameList* names);
+static bool scan_cached(const char* names, uint32_t count, char* path, size_t len, int depth);
+
+// --- STACK DEPTH ---
+// The walk recurses once per folder level on a fixed SCAN_WORKER_STACK, so
+// the deepest frame reached is tracked per pass (stack grows down).
+static __thread uintptr_t stack_base = 0;
+static size_t stack_peak = 0;
+
+static void stack_note(void) {
+    uintptr_t here = (uintptr_t)__builtin_frame_address(0);
+    if (!stack_base || here > stack_base) return;
+    size_t used = stack_base - here;
+    size_t peak = __atomic_load_n(&stack_peak, __ATOMIC_RELAXED);
+    while (used > peak && !__atomic_compare_exchange_n(&stack_peak, &peak, used, true,
+                                                       __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {}
+}
+
+size_t scan_get_stack_peak(void) {
+    return __atomic_load_n(&stack_peak, __ATOMIC_RELAXED);
+}
+
+// --- WALK PROGRESS ---
+// Threaded device workers stamp every folder they reach, so scan_pass()
+// can tell a drive that hangs mid-walk from one that is merely large
+static __thread long long* walk_progress = NULL;
+
+static void progress_note(void) {
+    if (walk_progress) __atomic_store_n(walk_progress, monotonic_us(), __ATOMIC_RELAXED);
+}
+
+// Kept out of scan_entry() so the title buffers are not part of every
+// recursion level's frame
+static __attribute__((noinline)) bool scan_game(int parent_fd, const char* name, const char* path, int depth) {
+    char title_id[MAX_TITLE_ID] = {0};
+    char title_name[MAX_TITLE_NAME] = {0};
+    if (!get_game_info_at(parent_fd, name, title_id, title_name)) return false;
+    // Recognized games no longer need their own watches
+    watcher_remove_tree(path);
+    process_game(path, title_id, title_name, depth);
+    return true;
+}
+
+// Handle one directory found at the given depth: install it if it is a game,
+// otherwise descend into it. name is relative to parent_fd; path is the same
+// folder as an absolute path in a MAX_PATH buffer the walk appends to; st is
+// its stat when the caller already has one (NULL = stat it here).
+// Returns true when nothing below it is a game or a copy in progress.
+static bool scan_entry(int parent_fd, const char* name, char* path, size_t len, int depth,
+                       const struct stat* known) {
+    stack_note();
+    progress_note();
+    struct stat st;
+    bool have_st = false, stated = false;
+
+    // Recorded folders held no sce_sys when listed, and gaining one changes
+    // their mtime: a cache hit needs no game probe
+    if (depth <= MAX_RECURSION_DEPTH && dircache_has(path)) {
+        if (known) st = *known;
+        have_st = known || walk_stat(parent_fd, name, &st) == 0;
+        stated = true;
+        uint32_t count = 0;
+        char* cached = have_st ? dircache_lookup(path, &st, &count) : NULL;
+        if (cached) {
+            // Game-free and unchanged since it was listed: only its subfolders need a look
+            log_trace("[RECURSIVE] Cached: %s (depth=%d, %u subfolder(s))", path, depth, count);
+            watch_folder(path, depth);
+            bool quiet = scan_cached(cached, count, path, len, depth);
+            free(cached);
+            if (!quiet) dircache_forget(path);
+            return quiet;
+        }
+    }
+
+    // Check if this is a valid game folder
+    if (scan_game(parent_fd, name, path, depth)) return false;
+
+    const char* base = strrchr(path, '/');
+    if (base && strcmp(base + 1, "sce_sys") == 0) {
+        // Game still being copied (no param.json yet): wait for it to show up
+        watch_folder(path, depth);
+        return false;
+    }
+
+    // Not a game folder, scan recursively (limit depth to avoid infinite loops)
+    if (depth > MAX_RECURSION_DEPTH) return true;
+    if (!stated) {
+        if (known) st = *known;
+        have_st = known || walk_stat(parent_fd, name, &st) == 0;
+    }
+
+    struct WalkDir w;
+    if (!walk_open(&w, parent_fd, name)) return true;
+    log_trace("[RECURSIVE] Scanning: %s (depth=%d)", path, depth);
+    watch_folder(path, depth);
+    struct NameList names = {0};
+    bool quiet = scan_walk(&w, path, len, depth, &names);
+    walk_close(&w);
+    if (quiet && have_st && !names.failed) dircache_store(path, &st, names.buf, names.len, names.count);
+    else if (!quiet) dircache_forget(path);
+    free(names.buf);
+    return quiet;
+}
+
+static bool scan_walk(struct WalkDir* w, char* path, size_t len, int depth, struct NameList* names) {
+    bool quiet = true;
+    struct WalkEntry e;
+    while (walk_next(w, &e)) {
+        // Skip hidden entries and anything that is not a directory
+        if (e.name[0] == '.' || e.type != DT_DIR) continue;
+
+        size_t name_len = strlen(e.name);
+        if (len + 1 + name_len >= MAX_PATH) continue;
+        if (names) names_add(names, e.name, name_len);
+        path[len] = '/';
+        memcpy(path + len + 1, e.name, name_len + 1);
+        // The walk already stat'ed entries whose d_type it had to resolve
+        if (!scan_entry(w->fd, e.name, path, len + 1 + name_len, depth + 1, e.has_stat ? &e.st : NULL)) {
+            quiet = false;
+        }
+        path[len] = '\0';
+    }
+    return quiet;
+}
+
+// Same as scan_walk() over the subfolder names recorded by the directory cache
+static bool scan_cached(const char* names, uint32_t count, char* path, size_t len, int depth) {
+    bool quiet = true;
+    for (uint32_t i = 0; i < count; i++) {
+        size_t name_len = strlen(names);
+        if (len + 1 + name_len < MAX_PATH) {
+            path[len] = '/';
+            memcpy(path + len + 1, names, name_len + 1);
+            if (!scan_entry(AT_FDCWD, path, path, len + 1 + name_len, depth + 1, NULL)) quiet = false;
+            path[len] = '\0';
+        }
+        names += name_len + 1;
+    }
+    return quiet;
+}
+
+void scan_directory_recursive(const char* dir_path, int depth) {
+    // Limit recursion depth to avoid infinite loops
+    if (depth > MAX_RECURSION_DEPTH) {
+        return;
+    }
+    
+    char path[MAX_PATH];
+    size_t len = (size_t)snprintf(path, sizeof(path), "%s", dir_path);
+    if (len >= sizeof(path)) return;
+
+    struct WalkDir w;
+    if (!walk_open(&w, AT_FDCWD, path)) {
+        return;
+    }
+    
+    log_trace("[RECURSIVE] Scanning: %s (depth=%d)", path, depth);
+    watch_folder(path, depth);
+    bool outer = !stack_base;
+    if (outer) stack_base = (uintptr_t)__builtin_frame_address(0);
+    scan_walk(&w, path, len, depth, NULL);
+    if (outer) stack_base = 0;
+    walk_close(&w);
+}
+
+// --- DEVICE WORKERS ---
+// Threaded workers count themselves out here so the pass can start
+// installing what a finished drive found while the others still walk.
+// A worker whose walk stalls is left behind: it owns its ScanDevice from
+// then on and frees it if the walk ever returns.
+static pthread_mutex_t device_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t device_cond = PTHREAD_COND_INITIALIZER;
+static int devices_finished = 0;
+
+struct ScanDevice {
+    dev_t dev;
+    int roots[SCAN_ROOT_COUNT];
+    int root_count;
+    long elapsed_ms;
+    struct timespec finished;
+    pthread_t thread;
+    bool threaded;
+    bool done;              // Under device_lock
+    bool abandoned;
+    long long progress_us;  // Last folder reached (atomic)
+};
+
+static void* scan_device_worker(void* arg) {
+    struct ScanDevice* sd = (struct ScanDevice*)arg;
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    if (sd->threaded) walk_progress = &sd->progress_us;
+    for (int r = 0; r < sd->root_count; r++) {
+        const char* root = SCAN_PATHS[sd->roots[r]];
+        log_debug("[SCAN] Starting scan: %s", root);
+        progress_note();
+        long long root_start = monotonic_us();
+        scan_directory_recursive(root, 0);
+        stats_root_time(root, monotonic_us() - root_start);
+    }
+    walk_progress = NULL;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    sd->elapsed_ms = (t1.tv_sec - t0.tv_sec) * 1000 + (t1.tv_nsec - t0.tv_nsec) / 1000000;
+    sd->finished = t1;
+    if (sd->threaded) {
+        pthread_mutex_lock(&device_lock);
+        bool abandoned = sd->abandoned;
+        if (!abandoned) {
+            sd->done = true;
+            devices_finished++;
+            pthread_cond_signal(&device_cond);
+        }
+        pthread_mutex_unlock(&device_lock);
+        if (abandoned) {
+            const char* root = SCAN_PATHS[sd->roots[0]];
+            log_debug("[SCAN] Late walk of %s returned after %ldms", root, sd->elapsed_ms);
+            health_walk_returned(root);
+            free(sd);
+        }
+    }
+    return NULL;
+}
+
+// Caller holds device_lock. A threaded walk counts as stalled once it has
+// reached no new folder for HEALTH_PROBE_TIMEOUT_US, and never sooner than
+// that after the last drive finished. Returns the earliest such deadline.
+static long long stall_deadline(struct ScanDevice* const* devices, int count, long long last_finished_us) {
+    long long deadline = -1;
+    for (int d = 0; d < count; d++) {
+        const struct ScanDevice* sd = devices[d];
+        if (!sd || !sd->threaded || sd->done) continue;
+        long long since = __atomic_load_n(&sd->progress_us, __ATOMIC_RELAXED);
+        if (since < last_finished_us) since = last_finished_us;
+        if (deadline < 0 || since + HEALTH_PROBE_TIMEOUT_US < deadline) deadline = since + HEALTH_PROBE_TIMEOUT_US;
+    }
+    return deadline;
+}
+
+// Caller holds device_lock. Leaves every stalled walk to its drive, which
+// the next health_check() quarantines; returns how many were left.
+static int abandon_stalled(struct ScanDevice** devices, int count, long long last_finished_us) {
+    long long now = monotonic_us();
+    int left = 0;
+    for (int d = 0; d < count; d++) {
+        struct ScanDevice* sd = devices[d];
+        if (!sd || !sd->threaded || sd->done) continue;
+        long long since = __atomic_load_n(&sd->progress_us, __ATOMIC_RELAXED);
+        if (since < last_finished_us) since = last_finished_us;
+        if (now < since + HEALTH_PROBE_TIMEOUT_US) continue;
+        const char* root = SCAN_PATHS[sd->roots[0]];
+        log_debug("[SCAN] Device 0x%llx: walk of %s stalled for %lldms, leaving it behind",
+                  (unsigned long long)sd->dev, root, (now - since) / 1000);
+        health_walk_stalled(root);
+        sd->abandoned = true;
+        pthread_detach(sd->thread);
+        devices[d] = NULL;
+        left++;
+    }
+    return left;
+}
+
+// Caller holds device_lock
+static void wait_device(long long deadline_us) {
+    long long wait = deadline_us - monotonic_us();
+    if (wait <= 0) return;
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += wait / 1000000;
+    ts.tv_nsec += (wait % 1000000) * 1000;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    pthread_cond_timedwait(&device_cond, &device_lock, &ts);
+}
+
+// --- MAIN SCAN FUNCTION ---
+// Walks the selected roots (NULL = all of them)
+static void scan_pass(const bool* selected) {
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    index_reset_pass_stats();
+    dircache_reset_pass_stats();
+    __atomic_store_n(&stack_peak, 0, __ATOMIC_RELAXED);
+    walk_reset_stats();
+    stats_begin_pass();
+    if (!selected) __atomic_store_n(&pass_mismatches, 0, __ATOMIC_RELAXED);
+
+    // Quarantine drives that stop answering before anything below touches them
+    bool usable[SCAN_ROOT_COUNT];
+    for (int i = 0; SCAN_PATHS[i] != NULL; i++) {
+        usable[i] = (!selected || selected[i]) && health_ready(SCAN_PATHS[i]);
+    }
+
+    // Stale title cache entries are dropped as their folders go (watcher,
+    // unplug, stale mounts, claim conflicts), not swept here
+    mounts_refresh();
+    int snap_mounted, snap_installed, snap_stale;
+    mounts_get_counts(&snap_mounted, &snap_installed, &snap_stale);
+    stats_set(GAUGE_STALE_MOUNTS, (unsigned long long)snap_stale);
+
+    // Group existing roots by backing device; a stalled worker keeps its
+    // ScanDevice, so they live on the heap
+    struct ScanDevice* devices[SCAN_ROOT_COUNT];
+    int device_count = 0;
+    for (int i = 0; SCAN_PATHS[i] != NULL; i++) {
+        if (!usable[i]) continue;
+        // Check if path exists before scanning
+        struct stat st;
+        if (stat(SCAN_PATHS[i], &st) != 0 || !S_ISDIR(st.st_mode)) continue;
+        int d = 0;
+        while (d < device_count && devices[d]->dev != st.st_dev) d++;
+        if (d == device_count) {
+            devices[d] = (struct ScanDevice*)calloc(1, sizeof(struct ScanDevice));
+            if (!devices[d]) continue;
+            devices[d]->dev = st.st_dev;
+            device_count++;
+        }
+        devices[d]->roots[devices[d]->root_count++] = i;
+    }
+
+    // One worker per device; deterministic mode (or a single device) stays inline
+    bool parallel = !deterministic && device_count > 1;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, SCAN_WORKER_STACK);
+    devices_finished = 0;
+    int running = 0;
+    for (int d = 0; d < device_count; d++) {
+        devices[d]->threaded = parallel;
+        devices[d]->progress_us = monotonic_us();
+        if (parallel && pthread_create(&devices[d]->thread, &attr, scan_device_worker, devices[d]) == 0) {
+            running++;
+        } else {
+            devices[d]->threaded = false;
+            scan_device_worker(devices[d]);
+        }
+    }
+    pthread_attr_destroy(&attr);
+
+    // Each time a drive finishes, the batch queued so far (one /system_ex
+    // remount) runs while the slower drives keep walking and queue the next.
+    // A drive that hangs mid-walk holds the pass up until it counts as stalled.
+    long long last_finished_us = 0;
+    pthread_mutex_lock(&device_lock);
+    for (int flushed = 0; flushed < running; ) {
+        if (devices_finished == flushed) {
+            long long deadline = stall_deadline(devices, device_count, last_finished_us);
+            if (monotonic_us() < deadline) wait_device(deadline);
+            else running -= abandon_stalled(devices, device_count, last_finished_us);
+            continue;
+        }
+        flushed = devices_finished;
+        last_finished_us = monotonic_us();
+        pthread_mutex_unlock(&device_lock);
+        install_flush(&g_installed_count, &g_mounted_count);
+        pthread_mutex_lock(&device_lock);
+    }
+    pthread_mutex_unlock(&device_lock);
+    for (int d = 0; d < device_count; d++) {
+        if (devices[d] && devices[d]->threaded) pthread_join(devices[d]->thread, NULL);
+    }
+
+    // Persist the library index only when something changed
+    if (index_is_dirty()) index_save(INDEX_FILE);
+    if (dircache_is_dirty()) dircache_save(DIRCACHE_FILE);
+
+    // The pass ends with the last walk, not with the installs it overlapped
+    t1 = t0;
+    for (int d = 0; d < device_count; d++) {
+        if (!devices[d]) continue;
+        const struct timespec* f = &devices[d]->finished;
+        if (f->tv_sec > t1.tv_sec || (f->tv_sec == t1.tv_sec && f->tv_nsec > t1.tv_nsec)) t1 = *f;
+    }
+    // Inline walks, and titles queued after the last flush started
+    install_flush(&g_installed_count, &g_mounted_count);
+    stats_add(selected ? STAT_ROOT_PASSES : STAT_FULL_PASSES, 1);
+    // Root and event passes see only part of the library
+    if (!selected) stats_set(GAUGE_MOUNT_MISMATCHES, (unsigned long long)__atomic_load_n(&pass_mismatches, __ATOMIC_RELAXED));
+    int hits, misses, pruned, listed;
+    index_get_pass_stats(&hits, &misses);
+    dircache_get_pass_stats(&pruned, &listed);
+    for (int d = 0; d < device_count; d++) {
+        if (!devices[d]) continue;
+        log_debug("[SCAN] Device 0x%llx: %d root(s) in %ldms (first: %s)",
+                  (unsigned long long)devices[d]->dev, devices[d]->root_count,
+                  devices[d]->elapsed_ms, SCAN_PATHS[devices[d]->roots[0]]);
+        free(devices[d]);
+    }
+    struct WalkStats ws;
+    walk_get_stats(&ws);
+    long ms = (t1.tv_sec - t0.tv_sec) * 1000 + (t1.tv_nsec - t0.tv_nsec) / 1000000;
+    log_debug("[SCAN] Pass done in %ldms (index: %d hit, %d parsed; folders: %d cached, %d listed; "
+              "syscalls: %lu open, %lu dirread, %lu stat; stack: %zu KB)",
+              ms, hits, misses, pruned, listed, ws.opens, ws.reads, ws.stats, scan_get_stack_peak() / 1024);
+    log_debug("[SCAN] Snapshot: %d mounted, %d installed, %d stale mount(s)", snap_mounted, snap_installed, snap_stale);
+    stats_record_us(HIST_SCAN_PASS, (t1.tv_sec - t0.tv_sec) * 1000000LL + (t1.tv_nsec - t0.tv_nsec) / 1000);
+    stats_write(STATS_FILE);
+}
+
+void scan_all_paths(void) {
+    scan_pass(NULL);
+}
+
+void scan_roots(const int* roots, int count) {
+    bool selected[SCAN_ROOT_COUNT] = {0};
+    for (int r = 0; r < count; r++) {
+        if (roots[r] >= 0 && roots[r] < SCAN_ROOT_COUNT) selected[roots[r]] = true;
+    }
+    scan_pass(selected);
+}
+
+// --- TARGETED RESCAN ---
+int scan_root_of(const char* path, int* out_depth) {
+    for (int i = 0; SCAN_PATHS[i] != NULL; i++) {
+        size_t len = strlen(SCAN_PATHS[i]);
+        if (strncmp(path, SCAN_PATHS[i], len) != 0 || (path[len] != '\0' && path[len] != '/')) continue;
+        int depth = 0;
+        for (const char* p = path + len; *p; p++) {
+            if (*p == '/' && p[1] && p[1] != '/') depth++;
+        }
+        if (out_depth) *out_depth = depth;
+        return i;
+    }
+    return -1;
+}
+
+
+void scan_forget_path(const char* path) {
+    title_cache_remove_tree(path);
+}
+
+// Rescan a single subtree reported by the watcher
+void scan_subtree(const char* path, int depth) {
+    char target[MAX_PATH];
+    snprintf(target, sizeof(target), "%s", path);
+
+    // A change inside sce_sys means its game folder may now be complete
+    char* base = strrchr(target, '/');
+    if (base && base != target && strcmp(base + 1, "sce_sys") == 0) {
+        *base = '\0';
+        depth--;
+    }
+
+    // A drive that stopped answering would hang the walk (see health.h)
+    if (!health_ready(target)) {
+        log_debug("[WATCH] %s: drive not responding, skipped", target);
+        return;
+    }
+
+    struct stat st;
+    if (stat(target, &st) == 0 && S_ISDIR(st.st_mode)) {
+        log_debug("[WATCH] Rescanning: %s", target);
+        if (depth <= 0) {
+            scan_directory_recursive(target, 0);
+        } else {
+            stack_base = (uintptr_t)__builtin_frame_address(0);
+            scan_entry(AT_FDCWD, target, target, strlen(target), depth, &st);
+            stack_base = 0;
+        }
+    }
+    if (index_is_dirty()) index_save(INDEX_FILE);
+    if (dircache_is_dirty()) dircache_save(DIRCACHE_FILE);
+}
+
+// Watch every scan root; missing roots are covered by watching their nearest
+// existing parent so a drive or folder appearing later is noticed.
+// Roots that appeared since the last call are queued for a rescan.
+void scan_refresh_root_watches(void) {
+    static bool present[sizeof(SCAN_PATHS) / sizeof(SCAN_PATHS[0])];
+    for (int i = 0; SCAN_PATHS[i] != NULL; i++) {
+        // Left as it was until the drive answers again
+        if (!health_ready(SCAN_PATHS[i])) continue;
+        struct stat st;
+        bool exists = stat(SCAN_PATHS[i], &st) == 0 && S_ISDIR(st.st_mode);
+        if (exists) {
+            if (!present[i]) watcher_queue(SCAN_PATHS[i], 0);
+            watcher_add(SCAN_PATHS[i], 0, WATCH_SCAN);
+        } else {
+            char parent[MAX_PATH];
+            snprintf(parent, sizeof(parent), "%s", SCAN_PATHS[i]);
+            char* slash;
+            while ((slash = strrchr(parent, '/')) && slash != parent) {
+                *slash = '\0';
+                if (stat(parent, &st) == 0) {
+                    watcher_add(parent, -1, WATCH_ANCESTOR);
+                    break;
+                }
+            }
+        }
+        present[i] = exists;
+    }
+}
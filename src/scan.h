@@ -0,0 +1,40 @@
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// --- SCANNER ---
+// Roots are grouped by backing device (st_dev) and every device is walked by
+// its own worker, so a slow USB drive never holds up internal storage.
+
+#define SCAN_WORKER_STACK   (1024 * 1024)
+
+extern const char* SCAN_PATHS[];
+
+// Per-pass results (reset by the caller)
+extern int g_installed_count;
+extern int g_mounted_count;
+
+void scan_all_paths(void);
+// Same as a full pass, limited to the given SCAN_PATHS indexes
+void scan_roots(const int* roots, int count);
+// Rescans one folder; the caller takes the mounts_refresh() snapshot first,
+// once for all the folders it rescans together
+void scan_subtree(const char* path, int depth);
+// SCAN_PATHS index of the root path lies under (-1 if none) and how many
+// folder levels below that root it is
+int scan_root_of(const char* path, int* out_depth);
+void scan_directory_recursive(const char* dir_path, int depth);
+void scan_refresh_root_watches(void);
+// Forgets the titles claimed at or below a folder that is gone (watcher hook)
+void scan_forget_path(const char* path);
+
+// Deepest stack use of the walk in the last pass, in bytes
+size_t scan_get_stack_peak(void);
+
+// Deterministic mode: devices are scanned one after another in SCAN_PATHS
+// order on the calling thread (used for reproducible test runs).
+void scan_set_deterministic(bool enabled);
+
+#endif
@@ -0,0 +1,162 @@
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "shadowmount.h"
+#include "schedule.h"
+#include "scan.h"
+#include "health.h"
+
+struct DeviceDir {
+    char path[64];          // "/data", "/mnt/usb0", ...
+    bool present;
+    dev_t dev;              // A new st_dev means a drive was mounted here
+};
+
+struct RootState {
+    int device;             // Index into devices[]
+    bool present;
+    struct timespec mtime;
+    int idle_streak;
+    long long next_due;
+};
+
+static struct DeviceDir devices[SCHED_DEVICE_DIRS];
+static int device_count = 0;
+static struct RootState roots[SCHED_MAX_ROOTS];
+static int root_count = 0;
+static long long min_idle = SCHED_MIN_IDLE_US;
+
+// "/mnt/usb0/homebrew" -> "/mnt/usb0", "/data/homebrew" -> "/data"
+static int device_of(const char* root) {
+    char dir[64];
+    const char* p = root + 1;
+    if (strncmp(root, "/mnt/", 5) == 0) p = root + 5;
+    const char* slash = strchr(p, '/');
+    size_t len = slash ? (size_t)(slash - root) : strlen(root);
+    if (len >= sizeof(dir)) len = sizeof(dir) - 1;
+    memcpy(dir, root, len);
+    dir[len] = '\0';
+
+    for (int d = 0; d < device_count; d++) {
+        if (strcmp(devices[d].path, dir) == 0) return d;
+    }
+    if (device_count == SCHED_DEVICE_DIRS) return -1;
+    struct DeviceDir* dd = &devices[device_count];
+    memset(dd, 0, sizeof(*dd));
+    snprintf(dd->path, sizeof(dd->path), "%s", dir);
+    return device_count++;
+}
+
+static long long idle_interval(int streak) {
+    long long us = min_idle;
+    while (streak-- > 0 && us < SCHED_MAX_IDLE_US) us *= 2;
+    return us < SCHED_MAX_IDLE_US ? us : SCHED_MAX_IDLE_US;
+}
+
+static bool same_time(const struct timespec* a, const struct timespec* b) {
+    return a->tv_sec == b->tv_sec && a->tv_nsec == b->tv_nsec;
+}
+
+// --- STATE ---
+void sched_init(long long min_idle_us) {
+    min_idle = min_idle_us;
+    device_count = 0;
+    root_count = 0;
+    long long now = monotonic_us();
+    for (int i = 0; SCAN_PATHS[i] != NULL && i < SCHED_MAX_ROOTS; i++) {
+        struct RootState* r = &roots[root_count++];
+        memset(r, 0, sizeof(*r));
+        r->device = device_of(SCAN_PATHS[i]);
+        r->next_due = now + min_idle;
+        struct stat st;
+        if (stat(SCAN_PATHS[i], &st) == 0 && S_ISDIR(st.st_mode)) {
+            r->present = true;
+            r->mtime = st.st_mtim;
+        }
+    }
+    for (int d = 0; d < device_count; d++) {
+        struct stat st;
+        devices[d].present = stat(devices[d].path, &st) == 0 && S_ISDIR(st.st_mode);
+        devices[d].dev = devices[d].present ? st.st_dev : 0;
+    }
+}
+
+int sched_poll(int* due, int max) {
+    long long now = monotonic_us();
+
+    // One stat per device folder; roots below a missing one are not touched
+    bool appeared[SCHED_DEVICE_DIRS] = {0};
+    for (int d = 0; d < device_count; d++) {
+        struct DeviceDir* dd = &devices[d];
+        // Bounded by the health prober; quarantined counts as gone, so
+        // re-admission walks the drive again
+        bool present;
+        dev_t dev;
+        if (!health_presence(dd->path, &present, &dev)) {
+            struct stat st;
+            present = stat(dd->path, &st) == 0 && S_ISDIR(st.st_mode);
+            dev = present ? st.st_dev : 0;
+        }
+        if (present && (!dd->present || dev != dd->dev)) {
+            log_debug("[SCHED] Device appeared: %s", dd->path);
+            appeared[d] = true;
+        } else if (!present && dd->present) {
+            log_debug("[SCHED] Device gone: %s", dd->path);
+        }
+        dd->present = present;
+        dd->dev = dev;
+    }
+
+    int n = 0;
+    for (int i = 0; i < root_count && n < max; i++) {
+        struct RootState* r = &roots[i];
+        if (r->device < 0 || !devices[r->device].present) {
+            r->present = false;
+            continue;
+        }
+        struct stat st;
+        if (stat(SCAN_PATHS[i], &st) != 0 || !S_ISDIR(st.st_mode)) {
+            r->present = false;
+            continue;
+        }
+        bool changed = !r->present || appeared[r->device] || !same_time(&st.st_mtim, &r->mtime);
+        r->present = true;
+        r->mtime = st.st_mtim;
+        if (changed) {
+            log_trace("[SCHED] %s changed, walking now", SCAN_PATHS[i]);
+            r->idle_streak = 0;
+            due[n++] = i;
+        } else if (now >= r->next_due) {
+            due[n++] = i;
+        }
+    }
+    return n;
+}
+
+void sched_mark_walked(const int* list, int count, bool found_new) {
+    long long now = monotonic_us();
+    for (int k = 0; k < count; k++) {
+        if (list[k] < 0 || list[k] >= root_count) continue;
+        struct RootState* r = &roots[list[k]];
+        r->idle_streak = found_new ? 0 : r->idle_streak + 1;
+        r->next_due = now + idle_interval(r->idle_streak);
+        log_trace("[SCHED] %s next idle walk in %llds", SCAN_PATHS[list[k]],
+                  (r->next_due - now) / 1000000);
+    }
+}
+
+void sched_mark_all_walked(bool found_new) {
+    int list[SCHED_MAX_ROOTS];
+    for (int i = 0; i < root_count; i++) list[i] = i;
+    sched_mark_walked(list, root_count, found_new);
+}
+
+long long sched_next_due_us(void) {
+    long long now = monotonic_us();
+    long long next = now + SCHED_MAX_IDLE_US;
+    for (int i = 0; i < root_count; i++) {
+        if (roots[i].present && roots[i].next_due < next) next = roots[i].next_due;
+    }
+    return next > now ? next - now : 0;
+}
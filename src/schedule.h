@@ -0,0 +1,33 @@
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+#include <stdbool.h>
+
+// --- ROOT SCHEDULER ---
+// Decides which scan roots need a walk. Roots on the same device folder
+// (/data, /mnt/usb0, ...) share one stat of that folder per check, so an
+// unplugged drive costs a single stat. A present root is walked when its
+// top-level mtime changes or its device (re)appears, and otherwise on an
+// idle interval that doubles after every walk that found nothing new.
+
+#define SCHED_TICK_US       1000000     // Presence/mtime check interval when polling
+#define SCHED_MIN_IDLE_US   3000000
+#define SCHED_MAX_IDLE_US   300000000   // 5 min
+#define SCHED_MAX_ROOTS     64
+#define SCHED_DEVICE_DIRS   16
+
+// min_idle_us is the first idle interval (grows up to SCHED_MAX_IDLE_US).
+// Call after a full pass; every present root counts as just walked.
+void sched_init(long long min_idle_us);
+
+// Fills due[] with SCAN_PATHS indexes to walk now; returns how many
+int sched_poll(int* due, int max);
+
+// After walking roots returned by sched_poll(); found_new resets the backoff
+void sched_mark_walked(const int* roots, int count, bool found_new);
+void sched_mark_all_walked(bool found_new);
+
+// Microseconds until the next idle walk is due (0 = now)
+long long sched_next_due_us(void);
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef SHADOWMOUNT_H
+#define SHADOWMOUNT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/stat.h>
+
+// --- Configuration ---
+#define MAX_PATH            1024
+#define MAX_TITLE_ID        32
+#define MAX_TITLE_NAME      256
+#define MAX_RECURSION_DEPTH 5
+#define LOG_DIR             "/data/shadowmount"
+#define LOG_FILE            "/data/shadowmount/debug.log"
+#define LOCK_FILE           "/data/shadowmount/daemon.lock"
+#define KILL_FILE           "/data/shadowmount/STOP"
+#define TOAST_FILE          "/data/shadowmount/notify.txt"
+#define INDEX_FILE          "/data/shadowmount/library.idx"
+#define IOVEC_ENTRY(x) { (void*)(x), iovec_len(x) }
+#define IOVEC_SIZE(x)  (sizeof(x) / sizeof(struct iovec))
+
+// nmount() option length; a NULL value is a flag without one
+static inline size_t iovec_len(const char* s) {
+    return s ? strlen(s) + 1 : 0;
+}
+
+// --- SDK Imports ---
+int sceAppInstUtilAppInstallTitleDir(const char* title_id, const char* install_path, void* reserved);
+int sceKernelUsleep(unsigned int microseconds);
+
+// --- Logging (log.c) ---
+void log_debug(const char* fmt, ...);
+void log_trace(const char* fmt, ...); // Only at LOG_LEVEL_TRACE
+
+// --- Shared Helpers (main.c) ---
+void notify_system(const char* fmt, ...);
+bool get_game_info(const char* base_path, char* out_id, char* out_name);
+bool get_game_info_at(int dir_fd, const char* name, char* out_id, char* out_name);
+bool is_installed(const char* title_id);
+bool is_data_mounted(const char* title_id);
+int check_installation_integrity(const char* title_id);
+void trigger_rich_toast(const char* title_id, const char* game_name, const char* msg);
+long long monotonic_us(void);
+
+#endif
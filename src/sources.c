@@ -0,0 +1,299 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "shadowmount.h"
+#include "sources.h"
+#include "devmap.h"
+#include "iobuf.h"
+#include "arena.h"
+#include "health.h"
+#include "util.h"
+
+#define SOURCES_MIN_SLOTS   256
+#define PROBE_FIRST_READ    4096
+
+// --- CANDIDATES ---
+// Open addressing on the interned title_id; a NULL id marks a free slot.
+struct TitleSources {
+    const char* title_id;
+    path_id paths[SOURCES_MAX_COPIES];
+    int count;
+};
+
+static struct TitleSources* slots = NULL;
+static uint32_t slot_count = 0;      // Power of two
+static uint32_t used_count = 0;
+
+// --- DRIVE SPEEDS ---
+struct DriveSpeed {
+    char key[64];           // devmap_device_of() form
+    dev_t dev;              // Another drive mounted here invalidates the probe
+    bool healthy;
+    double mbps;
+    long long latency_us;
+    long long probed_us;
+};
+
+struct DrivePin {
+    char key[64];
+    double mbps;            // 0 = only as a last resort
+};
+
+static struct DriveSpeed drives[SOURCES_MAX_DEVICES];
+static int drive_count = 0;
+static struct DrivePin pins[SOURCES_MAX_DEVICES];
+static int pin_count = 0;
+static pthread_mutex_t sources_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t probe_lock = PTHREAD_MUTEX_INITIALIZER;   // One probe at a time
+
+static struct TitleSources* find(const char* title_id) {
+    if (!slot_count) return NULL;
+    uint32_t mask = slot_count - 1;
+    for (uint32_t s = str_hash(title_id) & mask;; s = (s + 1) & mask) {
+        if (!slots[s].title_id) return NULL;
+        if (strcmp(slots[s].title_id, title_id) == 0) return &slots[s];
+    }
+}
+
+static bool grow(void) {
+    uint32_t n = slot_count ? slot_count * 2 : SOURCES_MIN_SLOTS;
+    struct TitleSources* fresh = (struct TitleSources*)calloc(n, sizeof(*fresh));
+    if (!fresh) return false;
+    for (uint32_t i = 0; i < slot_count; i++) {
+        if (!slots[i].title_id) continue;
+        uint32_t s = str_hash(slots[i].title_id) & (n - 1);
+        while (fresh[s].title_id) s = (s + 1) & (n - 1);
+        fresh[s] = slots[i];
+    }
+    free(slots);
+    slots = fresh;
+    slot_count = n;
+    return true;
+}
+
+void sources_note(const char* title_id, const char* path) {
+    path_id id = path_intern(path);
+    const char* interned = intern_str(title_id);
+    if (!id || !interned) return;
+    pthread_mutex_lock(&sources_lock);
+    struct TitleSources* t = find(title_id);
+    if (!t) {
+        if ((used_count + 1) * 2 > slot_count && !grow()) {
+            pthread_mutex_unlock(&sources_lock);
+            return;
+        }
+        uint32_t mask = slot_count - 1;
+        uint32_t s = str_hash(title_id) & mask;
+        while (slots[s].title_id) s = (s + 1) & mask;
+        t = &slots[s];
+        t->title_id = interned;
+        used_count++;
+    }
+    bool known = false;
+    for (int i = 0; i < t->count && !known; i++) known = t->paths[i] == id;
+    if (!known) {
+        // Full: the copy recorded first makes room
+        if (t->count == SOURCES_MAX_COPIES) {
+            memmove(t->paths, t->paths + 1, (SOURCES_MAX_COPIES - 1) * sizeof(path_id));
+            t->count--;
+        }
+        t->paths[t->count++] = id;
+        if (t->count > 1) log_debug("[SOURCES] %s: copy %d at %s", title_id, t->count, path);
+    }
+    pthread_mutex_unlock(&sources_lock);
+}
+
+// --- PROBE ---
+static int open_probe(const char* file) {
+#ifdef O_DIRECT
+    // Past the buffer cache, or a recently read copy always wins
+    int fd = open(file, O_RDONLY | O_DIRECT);
+    if (fd >= 0) return fd;
+#endif
+    return open(file, O_RDONLY);
+}
+
+// Reads the start of a file in folder: latency of open plus the first
+// block, throughput over the whole read (bytes/us == MB/s)
+static bool probe_folder(const char* folder, double* mbps, long long* latency_us) {
+    static const char* files[] = { "eboot.bin", "sce_sys/param.json" };
+    char file[MAX_PATH];
+    char* buf = iobuf_get(IOBUF_SMALL);
+    if (!buf) return false;
+
+    long long t0 = monotonic_us();
+    int fd = -1;
+    for (size_t i = 0; i < sizeof(files) / sizeof(files[0]) && fd < 0; i++) {
+        snprintf(file, sizeof(file), "%s/%s", folder, files[i]);
+        fd = open_probe(file);
+    }
+    if (fd < 0) {
+        iobuf_put(buf, IOBUF_SMALL);
+        return false;
+    }
+    ssize_t n = read(fd, buf, PROBE_FIRST_READ);
+    long long t1 = monotonic_us();
+    size_t total = n > 0 ? (size_t)n : 0;
+    while (n > 0 && total < SOURCES_PROBE_BYTES) {
+        n = read(fd, buf, IOBUF_SMALL);
+        if (n > 0) total += (size_t)n;
+    }
+    long long t2 = monotonic_us();
+    close(fd);
+    iobuf_put(buf, IOBUF_SMALL);
+    if (n < 0 || total == 0) return false;
+
+    *latency_us = t1 - t0;
+    *mbps = (double)total / (double)(t2 > t0 ? t2 - t0 : 1);
+    return *latency_us <= SOURCES_MAX_LATENCY_US;
+}
+
+static struct DriveSpeed* find_drive(const char* key) {
+    for (int i = 0; i < drive_count; i++) {
+        if (strcmp(drives[i].key, key) == 0) return &drives[i];
+    }
+    return NULL;
+}
+
+// Expected time to read SOURCES_PROBE_BYTES from the drive holding path;
+// false when that drive is gone, failed its probe or is pinned at 0
+static bool drive_cost(const char* path, long long* cost_us) {
+    char key[64];
+    devmap_device_of(path, key, sizeof(key));
+
+    pthread_mutex_lock(&sources_lock);
+    for (int i = 0; i < pin_count; i++) {
+        if (strcmp(pins[i].key, key) != 0) continue;
+        double mbps = pins[i].mbps;
+        pthread_mutex_unlock(&sources_lock);
+        if (mbps <= 0) return false;
+        *cost_us = (long long)(SOURCES_PROBE_BYTES / mbps);
+        return true;
+    }
+    pthread_mutex_unlock(&sources_lock);
+
+    // Scan workers ask too: a drive that hangs before it is quarantined
+    // costs them one bounded probe, not an unbounded stat or read
+    struct stat st;
+    if (!health_ready(key) || stat(key, &st) != 0) return false;
+
+    pthread_mutex_lock(&probe_lock);
+    pthread_mutex_lock(&sources_lock);
+    struct DriveSpeed* d = find_drive(key);
+    long long now = monotonic_us();
+    bool fresh = d && d->dev == st.st_dev && now - d->probed_us < SOURCES_PROBE_TTL_US;
+    struct DriveSpeed result = fresh ? *d : (struct DriveSpeed){0};
+    pthread_mutex_unlock(&sources_lock);
+
+    if (!fresh) {
+        snprintf(result.key, sizeof(result.key), "%s", key);
+        result.dev = st.st_dev;
+        result.healthy = probe_folder(path, &result.mbps, &result.latency_us);
+        result.probed_us = monotonic_us();
+        if (result.healthy) {
+            log_debug("[SOURCES] %s: %.1f MB/s, first read %.1fms", key, result.mbps, result.latency_us / 1000.0);
+        } else {
+            log_debug("[SOURCES] %s: probe failed, not using its copies", key);
+        }
+        pthread_mutex_lock(&sources_lock);
+        d = find_drive(key);
+        if (!d && drive_count < SOURCES_MAX_DEVICES) d = &drives[drive_count++];
+        if (d) *d = result;
+        pthread_mutex_unlock(&sources_lock);
+    }
+    pthread_mutex_unlock(&probe_lock);
+
+    if (!result.healthy) return false;
+    *cost_us = result.latency_us + (long long)(SOURCES_PROBE_BYTES / (result.mbps > 0 ? result.mbps : 1));
+    return true;
+}
+
+// --- SELECTION ---
+bool sources_prefer(const char* candidate, const char* current) {
+    char ka[64], kb[64];
+    devmap_device_of(candidate, ka, sizeof(ka));
+    devmap_device_of(current, kb, sizeof(kb));
+    if (strcmp(ka, kb) == 0) return false;
+    long long ca, cb;
+    if (!drive_cost(candidate, &ca)) return false;
+    if (!drive_cost(current, &cb)) return true;
+    return ca * SOURCES_SWITCH_PERCENT < cb * 100;
+}
+
+bool sources_fallback(const char* title_id, const char* gone_device, char* out, size_t size) {
+    path_id paths[SOURCES_MAX_COPIES];
+    int count = 0;
+    pthread_mutex_lock(&sources_lock);
+    struct TitleSources* t = find(title_id);
+    if (t) {
+        count = t->count;
+        memcpy(paths, t->paths, (size_t)count * sizeof(path_id));
+    }
+    pthread_mutex_unlock(&sources_lock);
+
+    // Fastest healthy copy; a copy on an unhealthy drive only when nothing else is left
+    bool found = false, found_healthy = false;
+    long long best_cost = 0;
+    char path[MAX_PATH], key[64];
+    for (int i = 0; i < count; i++) {
+        if (!path_get(paths[i], path, sizeof(path))) continue;
+        devmap_device_of(path, key, sizeof(key));
+        struct stat st;
+        if (strcmp(key, gone_device) == 0 || !health_ready(path) || stat(path, &st) != 0 || !S_ISDIR(st.st_mode)) continue;
+        long long cost;
+        bool healthy = drive_cost(path, &cost);
+        if (found && (found_healthy ? !healthy || cost >= best_cost : !healthy)) continue;
+        snprintf(out, size, "%s", path);
+        found = true;
+        found_healthy = healthy;
+        best_cost = cost;
+    }
+    return found;
+}
+
+// --- CONFIG ---
+void sources_reload_config(void) {
+    static time_t last_mtime = 0;
+    static bool had_file = false;
+    struct stat st;
+    if (stat(SOURCES_SPEED_FILE, &st) != 0) {
+        if (had_file) {
+            pthread_mutex_lock(&sources_lock);
+            pin_count = 0;
+            pthread_mutex_unlock(&sources_lock);
+            log_debug("[SOURCES] Speed overrides removed, probing every drive");
+        }
+        had_file = false;
+        return;
+    }
+    if (had_file && st.st_mtime == last_mtime) return;
+    had_file = true;
+    last_mtime = st.st_mtime;
+
+    FILE* f = fopen(SOURCES_SPEED_FILE, "r");
+    if (!f) return;
+    struct DrivePin fresh[SOURCES_MAX_DEVICES];
+    int n = 0;
+    char line[256];
+    while (n < SOURCES_MAX_DEVICES && fgets(line, sizeof(line), f)) {
+        char key[64];
+        double mbps;
+        if (line[0] == '#' || sscanf(line, "%63s %lf", key, &mbps) != 2 || key[0] != '/') continue;
+        snprintf(fresh[n].key, sizeof(fresh[n].key), "%s", key);
+        fresh[n].mbps = mbps < 0 ? 0 : mbps;
+        log_debug("[SOURCES] %s pinned at %.1f MB/s", fresh[n].key, fresh[n].mbps);
+        n++;
+    }
+    fclose(f);
+    pthread_mutex_lock(&sources_lock);
+    memcpy(pins, fresh, (size_t)n * sizeof(*fresh));
+    pin_count = n;
+    pthread_mutex_unlock(&sources_lock);
+}
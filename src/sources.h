@@ -0,0 +1,39 @@
+#ifndef SOURCES_H
+#define SOURCES_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// --- SOURCE SELECTION ---
+// Every folder found holding a title is recorded as a candidate source for
+// its title_id. When a title has more than one copy, the drives holding them
+// are compared by a short read probe (first-read latency plus throughput
+// over SOURCES_PROBE_BYTES of eboot.bin). Results are cached per drive until
+// the drive changes or SOURCES_PROBE_TTL_US passes. Drives that fail the
+// probe are unhealthy and never chosen. Thread-safe.
+
+#define SOURCES_MAX_COPIES      4
+#define SOURCES_MAX_DEVICES     16
+#define SOURCES_PROBE_BYTES     (1024 * 1024)
+#define SOURCES_PROBE_TTL_US    600000000LL     // Re-probe a drive after 10 minutes
+#define SOURCES_MAX_LATENCY_US  2000000         // Slower first read: unhealthy
+#define SOURCES_SWITCH_PERCENT  125             // Move only to a copy this much faster
+// Optional "<drive> <MB/s>" lines ("/mnt/usb0 40") that replace the probe
+// for that drive; 0 keeps its copies from being used while others exist.
+#define SOURCES_SPEED_FILE      "/data/shadowmount/source_speeds"
+
+// Records path as a copy of title_id
+void sources_note(const char* title_id, const char* path);
+
+// True when candidate is on a healthy drive that is clearly faster than the
+// one holding current (or current's drive is unhealthy). Probes as needed.
+bool sources_prefer(const char* candidate, const char* current);
+
+// Best remaining copy of title_id outside the drive folder gone_device
+// (devmap_device_of() form); false when no other copy exists
+bool sources_fallback(const char* title_id, const char* gone_device, char* out, size_t size);
+
+// Re-reads SOURCES_SPEED_FILE when it changed
+void sources_reload_config(void);
+
+#endif
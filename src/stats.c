@@ -0,0 +1,167 @@
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "shadowmount.h"
+#include "stats.h"
+#include "index.h"
+#include "walk.h"
+#include "dircache.h"
+#include "scan.h"
+#include "arena.h"
+#include "util.h"
+
+#define STATS_BUF_SIZE (16 * 1024)
+
+static const char* counter_names[STAT_COUNTER_COUNT] = {
+    "param_reads", "title_cache_hits", "title_cache_claims",
+    "mounts", "mount_failures",
+    "registrations", "registration_failures",
+    "files_copied", "files_skipped", "copy_failures", "copy_untimed", "bytes_copied",
+    "verified_files", "verify_damaged", "verify_repairs",
+    "full_passes", "root_passes", "event_passes", "dirs_pruned",
+    "source_switches", "source_fallbacks", "assets_deferred",
+    "slow_probes", "drive_quarantines",
+};
+
+static const char* gauge_names[GAUGE_COUNT] = {
+    "stale_mounts", "mount_mismatches",
+};
+
+static const char* hist_names[HIST_COUNT] = {
+    "nmount", "register", "register_ready", "scan_pass", "install", "batch",
+};
+
+struct Histogram {
+    unsigned long long buckets[STATS_HIST_BUCKETS];
+    unsigned long long count;
+    unsigned long long sum_us;
+    unsigned long long max_us;
+};
+
+static unsigned long long counters[STAT_COUNTER_COUNT];
+static unsigned long long gauges[GAUGE_COUNT];
+static struct Histogram hists[HIST_COUNT];
+
+struct RootTime {
+    const char* root;
+    long long us;
+};
+static struct RootTime roots[STATS_MAX_ROOTS];
+static int root_count = 0;
+static pthread_mutex_t root_lock = PTHREAD_MUTEX_INITIALIZER;
+static long long started_us = 0;
+
+// --- RECORDING ---
+void stats_add(enum stat_counter c, unsigned long long n) {
+    __atomic_fetch_add(&counters[c], n, __ATOMIC_RELAXED);
+}
+
+unsigned long long stats_get(enum stat_counter c) {
+    return __atomic_load_n(&counters[c], __ATOMIC_RELAXED);
+}
+
+void stats_set(enum stat_gauge g, unsigned long long value) {
+    __atomic_store_n(&gauges[g], value, __ATOMIC_RELAXED);
+}
+
+void stats_record_us(enum stat_hist h, long long us) {
+    if (us < 0) us = 0;
+    struct Histogram* hg = &hists[h];
+    int b = 0;
+    while (b < STATS_HIST_BUCKETS - 1 && (1LL << b) <= us) b++;
+    __atomic_fetch_add(&hg->buckets[b], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&hg->count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&hg->sum_us, (unsigned long long)us, __ATOMIC_RELAXED);
+    unsigned long long prev = __atomic_load_n(&hg->max_us, __ATOMIC_RELAXED);
+    while ((unsigned long long)us > prev &&
+           !__atomic_compare_exchange_n(&hg->max_us, &prev, (unsigned long long)us, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) { }
+}
+
+void stats_begin_pass(void) {
+    if (!started_us) started_us = monotonic_us();
+    pthread_mutex_lock(&root_lock);
+    root_count = 0;
+    pthread_mutex_unlock(&root_lock);
+}
+
+void stats_root_time(const char* root, long long us) {
+    pthread_mutex_lock(&root_lock);
+    if (root_count < STATS_MAX_ROOTS) {
+        roots[root_count].root = root;
+        roots[root_count].us = us;
+        root_count++;
+    }
+    pthread_mutex_unlock(&root_lock);
+}
+
+// --- EXPORT ---
+// Upper bound (us) of the bucket holding the given percentile
+static unsigned long long percentile(const unsigned long long* buckets, unsigned long long count, int pct) {
+    if (count == 0) return 0;
+    unsigned long long want = (count * (unsigned long long)pct + 99) / 100;
+    unsigned long long seen = 0;
+    for (int b = 0; b < STATS_HIST_BUCKETS; b++) {
+        seen += buckets[b];
+        if (seen >= want) return 1ULL << b;
+    }
+    return 1ULL << (STATS_HIST_BUCKETS - 1);
+}
+
+#define APPEND(...) do { \
+    if (len < sizeof(buf)) len += (size_t)snprintf(buf + len, sizeof(buf) - len, __VA_ARGS__); \
+} while (0)
+
+bool stats_write(const char* path) {
+    char buf[STATS_BUF_SIZE];
+    size_t len = 0;
+
+    struct WalkStats ws;
+    walk_get_stats(&ws);
+    int hits, misses;
+    index_get_pass_stats(&hits, &misses);
+    int pruned, listed;
+    dircache_get_pass_stats(&pruned, &listed);
+
+    APPEND("{\n  \"uptime_s\": %lld,\n", started_us ? (monotonic_us() - started_us) / 1000000 : 0);
+    APPEND("  \"last_pass\": {\n    \"dirs_opened\": %lu,\n    \"dir_reads\": %lu,\n    \"stats\": %lu,\n",
+           ws.opens, ws.reads, ws.stats);
+    int lookups = hits + misses;
+    APPEND("    \"index_hits\": %d,\n    \"index_misses\": %d,\n    \"index_hit_rate\": %.3f,\n",
+           hits, misses, lookups ? (double)hits / lookups : 0.0);
+    APPEND("    \"dirs_pruned\": %d,\n    \"dirs_listed\": %d,\n", pruned, listed);
+    APPEND("    \"stack_peak\": %zu,\n    \"interned_bytes\": %zu,\n", scan_get_stack_peak(), intern_memory());
+    APPEND("    \"roots\": [");
+    pthread_mutex_lock(&root_lock);
+    for (int i = 0; i < root_count; i++) {
+        APPEND("%s\n      { \"path\": \"%s\", \"walk_us\": %lld }", i ? "," : "", roots[i].root, roots[i].us);
+    }
+    pthread_mutex_unlock(&root_lock);
+    APPEND("\n    ]\n  },\n  \"totals\": {");
+    for (int c = 0; c < STAT_COUNTER_COUNT; c++) {
+        APPEND("%s\n    \"%s\": %llu", c ? "," : "", counter_names[c],
+               __atomic_load_n(&counters[c], __ATOMIC_RELAXED));
+    }
+    APPEND("\n  },\n  \"current\": {");
+    for (int g = 0; g < GAUGE_COUNT; g++) {
+        APPEND("%s\n    \"%s\": %llu", g ? "," : "", gauge_names[g],
+               __atomic_load_n(&gauges[g], __ATOMIC_RELAXED));
+    }
+    APPEND("\n  },\n  \"latency_us\": {");
+    for (int h = 0; h < HIST_COUNT; h++) {
+        unsigned long long b[STATS_HIST_BUCKETS];
+        for (int i = 0; i < STATS_HIST_BUCKETS; i++) b[i] = __atomic_load_n(&hists[h].buckets[i], __ATOMIC_RELAXED);
+        unsigned long long count = __atomic_load_n(&hists[h].count, __ATOMIC_RELAXED);
+        unsigned long long sum = __atomic_load_n(&hists[h].sum_us, __ATOMIC_RELAXED);
+        APPEND("%s\n    \"%s\": { \"count\": %llu, \"avg\": %llu, \"p50\": %llu, \"p90\": %llu, \"p99\": %llu, \"max\": %llu }",
+               h ? "," : "", hist_names[h], count, count ? sum / count : 0,
+               percentile(b, count, 50), percentile(b, count, 90), percentile(b, count, 99),
+               __atomic_load_n(&hists[h].max_us, __ATOMIC_RELAXED));
+    }
+    APPEND("\n  }\n}\n");
+    if (len >= sizeof(buf)) return false;
+
+    // Readers only ever see a complete file; a lost snapshot is harmless, so no fsync
+    return write_file_atomic(path, buf, len, false);
+}
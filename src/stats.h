@@ -0,0 +1,71 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdbool.h>
+
+// --- STATS ---
+// Lifetime counters, gauges and log2 latency histograms, updated with
+// relaxed atomics so they stay on in production. stats_write() snapshots them (plus
+// the walker/index counters of the last pass) into STATS_FILE atomically.
+
+#define STATS_FILE          "/data/shadowmount/stats.json"
+#define STATS_HIST_BUCKETS  24    // Bucket i counts samples < 2^i us
+#define STATS_MAX_ROOTS     32
+
+enum stat_counter {
+    STAT_PARAM_READS,
+    STAT_TITLE_CACHE_HITS,      // Title already claimed this session
+    STAT_TITLE_CACHE_CLAIMS,
+    STAT_MOUNTS,
+    STAT_MOUNT_FAILURES,
+    STAT_REGISTRATIONS,
+    STAT_REGISTRATION_FAILURES,
+    STAT_FILES_COPIED,
+    STAT_FILES_SKIPPED,
+    STAT_COPY_FAILURES,
+    STAT_COPY_UNTIMED,          // Copied, but the source mtime could not be set
+    STAT_BYTES_COPIED,
+    STAT_VERIFIED_FILES,
+    STAT_VERIFY_DAMAGED,
+    STAT_VERIFY_REPAIRS,
+    STAT_FULL_PASSES,
+    STAT_ROOT_PASSES,           // Scheduler passes over some roots only
+    STAT_EVENT_PASSES,
+    STAT_DIRS_PRUNED,           // Game-free folders answered by the directory cache
+    STAT_SOURCE_SWITCHES,       // Mount moved to a faster copy
+    STAT_SOURCE_FALLBACKS,      // Mount moved to another copy after an unplug
+    STAT_ASSETS_DEFERRED,       // Titles whose remaining sce_sys was copied in the background
+    STAT_SLOW_PROBES,           // Drive health probes past HEALTH_SLOW_US
+    STAT_DRIVE_QUARANTINES,     // Drives quarantined after a failed or hung probe
+    STAT_COUNTER_COUNT
+};
+
+// Current values, set (not added) from each snapshot
+enum stat_gauge {
+    GAUGE_STALE_MOUNTS,         // Mounts older than their source filesystem
+    GAUGE_MOUNT_MISMATCHES,     // Copies found apart from the one mounted, last full pass
+    GAUGE_COUNT
+};
+
+enum stat_hist {
+    HIST_NMOUNT,            // nullfs mount and /system_ex remount
+    HIST_REGISTER,          // sceAppInstUtilAppInstallTitleDir()
+    HIST_REGISTER_READY,    // Until the title shows up in appmeta
+    HIST_SCAN_PASS,
+    HIST_INSTALL,           // Fresh install: mount start until registered
+    HIST_BATCH,             // Mount batch holding fresh installs, start to end
+    HIST_COUNT
+};
+
+void stats_add(enum stat_counter c, unsigned long long n);
+unsigned long long stats_get(enum stat_counter c);
+void stats_set(enum stat_gauge g, unsigned long long value);
+void stats_record_us(enum stat_hist h, long long us);
+
+// Per-root walk time of the current full pass
+void stats_begin_pass(void);
+void stats_root_time(const char* root, long long us);
+
+bool stats_write(const char* path);
+
+#endif
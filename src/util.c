@@ -0,0 +1,135 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#include "shadowmount.h"
+#include "util.h"
+#include "crc32c.h"
+
+// --- HASHING ---
+uint32_t fnv1a(const void* data, size_t len, uint32_t seed) {
+    const uint8_t* p = (const uint8_t*)data;
+    uint32_t h = seed;
+    for (size_t i = 0; i < len; i++) { h ^= p[i]; h *= 0x01000193u; }
+    return h;
+}
+
+uint32_t str_hash(const char* s) {
+    return fnv1a(s, strlen(s), FNV1A_SEED);
+}
+
+// --- SLOT TABLES ---
+uint32_t* slots_build(uint32_t count, uint32_t* out_slot_count, uint32_t (*hash_of)(uint32_t idx)) {
+    uint32_t n = 64;
+    while (n < count * 2) n <<= 1;
+    uint32_t* fresh = (uint32_t*)calloc(n, sizeof(uint32_t));
+    if (!fresh) return NULL;
+    for (uint32_t i = 0; i < count; i++) slots_insert(fresh, n, hash_of(i), i);
+    *out_slot_count = n;
+    return fresh;
+}
+
+void slots_insert(uint32_t* slots, uint32_t slot_count, uint32_t hash, uint32_t idx) {
+    uint32_t s = hash & (slot_count - 1);
+    while (slots[s]) s = (s + 1) & (slot_count - 1);
+    slots[s] = idx + 1;
+}
+
+// --- FILES ---
+bool write_full(int fd, const void* data, size_t len) {
+    const uint8_t* p = (const uint8_t*)data;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+bool fsync_parent(int dir_fd, const char* name) {
+    const char* slash = strrchr(name, '/');
+    if (!slash && dir_fd != AT_FDCWD) return fsync(dir_fd) == 0;
+    char dir[MAX_PATH];
+    size_t len = !slash ? 0 : slash == name ? 1 : (size_t)(slash - name);
+    if (len >= sizeof(dir)) return false;
+    if (len == 0) dir[len++] = '.';
+    else memcpy(dir, name, len);
+    dir[len] = '\0';
+    int fd = openat(dir_fd, dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) return false;
+    bool ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+}
+
+bool write_file_atomic(const char* path, const void* data, size_t len, bool sync) {
+    char tmp_path[MAX_PATH];
+    int n = snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    if (n < 0 || (size_t)n >= sizeof(tmp_path)) return false;
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    bool ok = fd >= 0 && write_full(fd, data, len) && (!sync || fsync(fd) == 0);
+    if (fd >= 0 && close(fd) != 0) ok = false;
+    if (ok && rename(tmp_path, path) != 0) ok = false;
+    if (ok && sync && !fsync_parent(AT_FDCWD, path)) return false;
+    if (!ok) {
+        int saved = errno;
+        unlink(tmp_path);
+        errno = saved;
+    }
+    return ok;
+}
+
+// --- RECORD FILES ---
+uint8_t* record_file_load(const char* path, const char* tag, uint32_t magic, uint16_t version,
+                          size_t max_size, uint32_t* count, uint32_t* payload_len) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return NULL;
+    struct stat st;
+    uint8_t* buf = NULL;
+    bool ok = fstat(fd, &st) == 0 && st.st_size >= RECORD_HEADER_SIZE && (size_t)st.st_size <= max_size &&
+              (buf = (uint8_t*)malloc((size_t)st.st_size)) != NULL &&
+              read(fd, buf, (size_t)st.st_size) == st.st_size;
+    close(fd);
+    if (!ok) {
+        free(buf);
+        return NULL;
+    }
+
+    uint32_t file_magic, checksum;
+    uint16_t file_version;
+    memcpy(&file_magic, buf, 4);
+    memcpy(&file_version, buf + 4, 2);
+    memcpy(count, buf + 8, 4);
+    memcpy(payload_len, buf + 12, 4);
+    memcpy(&checksum, buf + 16, 4);
+    if (file_magic != magic || file_version != version ||
+        *payload_len != (uint64_t)st.st_size - RECORD_HEADER_SIZE ||
+        crc32c(0, buf + RECORD_HEADER_SIZE, *payload_len) != checksum) {
+        log_debug("%s Ignoring invalid %s (version/checksum mismatch)", tag, path);
+        free(buf);
+        return NULL;
+    }
+    return buf;
+}
+
+bool record_file_save(const char* path, uint8_t* buf, size_t len, uint32_t magic, uint16_t version,
+                      uint32_t count) {
+    uint32_t payload_len = (uint32_t)(len - RECORD_HEADER_SIZE);
+    uint32_t checksum = crc32c(0, buf + RECORD_HEADER_SIZE, payload_len);
+    uint16_t reserved = 0;
+    memcpy(buf, &magic, 4);
+    memcpy(buf + 4, &version, 2);
+    memcpy(buf + 6, &reserved, 2);
+    memcpy(buf + 8, &count, 4);
+    memcpy(buf + 12, &payload_len, 4);
+    memcpy(buf + 16, &checksum, 4);
+    return write_file_atomic(path, buf, len, true);
+}
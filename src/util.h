@@ -0,0 +1,54 @@
+#ifndef UTIL_H
+#define UTIL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// --- HASHING ---
+// FNV-1a, the hash behind every in-memory table keyed by a string
+#define FNV1A_SEED  0x811C9DC5u
+
+uint32_t fnv1a(const void* data, size_t len, uint32_t seed);
+uint32_t str_hash(const char* s);
+
+// --- SLOT TABLES ---
+// Open addressing over a dense entry array: slots hold entry index + 1
+// (0 = empty); tables are a power of two at least twice the entry count.
+// Returns a fresh table for entries 0..count-1 and its size, NULL when out
+// of memory (the caller keeps its old table).
+uint32_t* slots_build(uint32_t count, uint32_t* out_slot_count, uint32_t (*hash_of)(uint32_t idx));
+void slots_insert(uint32_t* slots, uint32_t slot_count, uint32_t hash, uint32_t idx);
+
+// --- FILES ---
+// Writes all of data, retrying short writes and EINTR
+bool write_full(int fd, const void* data, size_t len);
+
+// fsyncs the directory holding name (relative to dir_fd), so a rename into
+// it survives a power cut
+bool fsync_parent(int dir_fd, const char* name);
+
+// Replaces path with data through path.tmp and a rename, so readers see
+// the old file or the new one, never a mix. sync fsyncs the temp file
+// first and the directory after the rename (files that must survive a
+// power cut). No temp file is left behind.
+bool write_file_atomic(const char* path, const void* data, size_t len, bool sync);
+
+// --- RECORD FILES ---
+// Library index, directory cache and manifests share one layout: magic,
+// version, reserved, record count, payload length and the payload's
+// CRC32C, then the records.
+#define RECORD_HEADER_SIZE  20
+
+// Reads and checks a whole record file of at most max_size bytes. Returns a
+// malloc'd buffer holding the payload at RECORD_HEADER_SIZE, or NULL when
+// the file is missing or invalid (logged under tag).
+uint8_t* record_file_load(const char* path, const char* tag, uint32_t magic, uint16_t version,
+                          size_t max_size, uint32_t* count, uint32_t* payload_len);
+
+// Fills in the header of buf, whose records already follow it, and writes
+// it with write_file_atomic() (synced)
+bool record_file_save(const char* path, uint8_t* buf, size_t len, uint32_t magic, uint16_t version,
+                      uint32_t count);
+
+#endif
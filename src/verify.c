@@ -0,0 +1,453 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "shadowmount.h"
+#include "verify.h"
+#include "crc32c.h"
+#include "copy.h"
+#include "walk.h"
+#include "stats.h"
+#include "install.h"
+#include "iobuf.h"
+#include "assets.h"
+#include "util.h"
+
+// On-disk layout (native endian, one file per title in VERIFY_DIR): the
+// record file header (util.h), then per file
+//   record: size i64 | mtime i64 | crc u32 | name_len u16 | name (relative to sce_sys)
+#define MANIFEST_RECORD_FIXED   22
+#define MANIFEST_MAX_FILE       (RECORD_HEADER_SIZE + (size_t)VERIFY_MAX_FILES * (MANIFEST_RECORD_FIXED + MAX_PATH))
+#define MANIFEST_MAX_DEPTH      8
+
+struct ManifestEntry {
+    int64_t size;
+    int64_t mtime;
+    uint32_t crc;
+    uint32_t name;      // Offset in Manifest.names
+};
+
+// Both arrays grow as files are added; names are packed NUL-terminated
+struct Manifest {
+    struct ManifestEntry* entries;
+    uint32_t count;
+    uint32_t capacity;
+    char* names;
+    size_t names_len;
+    size_t names_cap;
+    bool truncated;     // sce_sys holds more than VERIFY_MAX_FILES files
+};
+
+static pthread_t verifier;
+static bool running = false;
+static bool stopping = false;
+static pthread_mutex_t wake_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wake_cond;
+static int budget_kbps = VERIFY_BUDGET_KBPS;
+
+static int64_t mtime_ns(const struct stat* st) {
+    return (int64_t)st->st_mtim.tv_sec * 1000000000LL + st->st_mtim.tv_nsec;
+}
+
+static void manifest_path(char* out, size_t size, const char* title_id) {
+    snprintf(out, size, "%s/%s.smv", VERIFY_DIR, title_id);
+}
+
+// --- MANIFESTS ---
+static const char* entry_name(const struct Manifest* m, const struct ManifestEntry* e) {
+    return m->names + e->name;
+}
+
+// Appends a zeroed entry named name; NULL when out of memory
+static struct ManifestEntry* manifest_add(struct Manifest* m, const char* name, size_t name_len) {
+    if (m->count == m->capacity) {
+        uint32_t cap = m->capacity ? m->capacity * 2 : 32;
+        struct ManifestEntry* grown = (struct ManifestEntry*)realloc(m->entries, cap * sizeof(*grown));
+        if (!grown) return NULL;
+        m->entries = grown;
+        m->capacity = cap;
+    }
+    if (m->names_len + name_len + 1 > m->names_cap) {
+        size_t cap = m->names_cap ? m->names_cap * 2 : 1024;
+        while (cap < m->names_len + name_len + 1) cap *= 2;
+        char* grown = (char*)realloc(m->names, cap);
+        if (!grown) return NULL;
+        m->names = grown;
+        m->names_cap = cap;
+    }
+    struct ManifestEntry* e = &m->entries[m->count++];
+    memset(e, 0, sizeof(*e));
+    e->name = (uint32_t)m->names_len;
+    memcpy(m->names + m->names_len, name, name_len);
+    m->names[m->names_len + name_len] = '\0';
+    m->names_len += name_len + 1;
+    return e;
+}
+
+static void manifest_free(struct Manifest* m) {
+    free(m->entries);
+    free(m->names);
+    memset(m, 0, sizeof(*m));
+}
+
+// --- HASHING ---
+// Sleeps as needed so reads stay within the budget (throttle = verifier)
+static bool hash_file(int dir_fd, const char* rel, char* buf, bool throttle, uint32_t* out_crc, int64_t* out_size) {
+    int fd = openat(dir_fd, rel, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    uint32_t crc = 0;
+    int64_t total = 0;
+    bool ok = true;
+    while (true) {
+        ssize_t n = read(fd, buf, VERIFY_BUF_SIZE);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            ok = false;
+            break;
+        }
+        if (n == 0) break;
+        crc = crc32c(crc, buf, (size_t)n);
+        total += n;
+        int kbps = __atomic_load_n(&budget_kbps, __ATOMIC_RELAXED);
+        if (throttle && kbps > 0) sceKernelUsleep((unsigned)((long long)n * 1000000LL / ((long long)kbps * 1024)));
+    }
+    close(fd);
+    *out_crc = crc;
+    *out_size = total;
+    return ok;
+}
+
+// Lists regular files below sce_sys (names relative to it); false when out of memory
+static bool list_files(int dir_fd, const char* prefix, int depth, struct Manifest* m) {
+    struct WalkDir w;
+    if (depth > MANIFEST_MAX_DEPTH || !walk_open(&w, dir_fd, depth ? prefix : ".")) return true;
+    struct WalkEntry e;
+    bool ok = true;
+    while (ok && !m->truncated && walk_next(&w, &e)) {
+        char rel[MAX_PATH];
+        int len = depth ? snprintf(rel, sizeof(rel), "%s/%s", prefix, e.name) : snprintf(rel, sizeof(rel), "%s", e.name);
+        if (len < 0 || (size_t)len >= sizeof(rel)) continue;
+        if (e.type == DT_DIR) {
+            ok = list_files(dir_fd, rel, depth + 1, m);
+        } else if (e.type == DT_REG && !strstr(e.name, COPY_TEMP_SUFFIX)) {
+            if (m->count == VERIFY_MAX_FILES) m->truncated = true;
+            else ok = manifest_add(m, rel, (size_t)len) != NULL;
+        }
+    }
+    walk_close(&w);
+    return ok;
+}
+
+// --- MANIFEST FILES ---
+static bool manifest_save(const char* title_id, const struct Manifest* m) {
+    size_t cap = RECORD_HEADER_SIZE;
+    cap += (size_t)m->count * MANIFEST_RECORD_FIXED + m->names_len;
+    uint8_t* buf = (uint8_t*)malloc(cap);
+    if (!buf) return false;
+
+    uint8_t* p = buf + RECORD_HEADER_SIZE;
+    for (uint32_t i = 0; i < m->count; i++) {
+        const struct ManifestEntry* e = &m->entries[i];
+        uint16_t name_len = (uint16_t)strlen(entry_name(m, e));
+        memcpy(p, &e->size, 8);
+        memcpy(p + 8, &e->mtime, 8);
+        memcpy(p + 16, &e->crc, 4);
+        memcpy(p + 20, &name_len, 2);
+        memcpy(p + MANIFEST_RECORD_FIXED, entry_name(m, e), name_len);
+        p += MANIFEST_RECORD_FIXED + name_len;
+    }
+    char path[MAX_PATH];
+    manifest_path(path, sizeof(path), title_id);
+    mkdir(VERIFY_DIR, 0777);
+    bool ok = record_file_save(path, buf, (size_t)(p - buf), VERIFY_MAGIC, VERIFY_VERSION, m->count);
+    free(buf);
+    return ok;
+}
+
+static bool manifest_load(const char* title_id, struct Manifest* m) {
+    char path[MAX_PATH];
+    manifest_path(path, sizeof(path), title_id);
+    uint32_t count = 0, payload_len = 0;
+    uint8_t* buf = record_file_load(path, "[VERIFY]", VERIFY_MAGIC, VERIFY_VERSION, MANIFEST_MAX_FILE,
+                                    &count, &payload_len);
+    memset(m, 0, sizeof(*m));
+    if (!buf) return false;
+    if (count > VERIFY_MAX_FILES) {
+        free(buf);
+        return false;
+    }
+
+    const uint8_t* p = buf + RECORD_HEADER_SIZE;
+    const uint8_t* end = p + payload_len;
+    for (uint32_t i = 0; i < count; i++) {
+        if (end - p < MANIFEST_RECORD_FIXED) break;
+        uint16_t name_len;
+        memcpy(&name_len, p + 20, 2);
+        if (name_len >= MAX_PATH || end - p - MANIFEST_RECORD_FIXED < name_len) break;
+        struct ManifestEntry* e = manifest_add(m, (const char*)p + MANIFEST_RECORD_FIXED, name_len);
+        if (!e) break;
+        memcpy(&e->size, p, 8);
+        memcpy(&e->mtime, p + 8, 8);
+        memcpy(&e->crc, p + 16, 4);
+        p += MANIFEST_RECORD_FIXED + name_len;
+    }
+    free(buf);
+    if (m->count == count) return true;
+    manifest_free(m);
+    return false;
+}
+
+static int open_sce_sys(const char* title_id) {
+    char path[MAX_PATH];
+    snprintf(path, sizeof(path), "/user/app/%s/sce_sys", title_id);
+    return open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+}
+
+// Hashes every file of the title's sce_sys into a fresh manifest
+static bool record(const char* title_id, char* buf, bool throttle) {
+    int dir_fd = open_sce_sys(title_id);
+    if (dir_fd < 0) return false;
+    struct Manifest m = {0};
+    if (!list_files(dir_fd, "", 0, &m)) {
+        close(dir_fd);
+        manifest_free(&m);
+        return false;
+    }
+    if (m.truncated) {
+        log_debug("  [VERIFY] %s: sce_sys holds more than %d files, only the first %d are covered",
+                  title_id, VERIFY_MAX_FILES, VERIFY_MAX_FILES);
+    }
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < m.count; i++) {
+        struct ManifestEntry* e = &m.entries[i];
+        struct stat st;
+        if (fstatat(dir_fd, entry_name(&m, e), &st, 0) != 0) continue;
+        if (!hash_file(dir_fd, entry_name(&m, e), buf, throttle, &e->crc, &e->size)) continue;
+        e->mtime = mtime_ns(&st);
+        m.entries[kept++] = *e;
+    }
+    m.count = kept;
+    close(dir_fd);
+    bool ok = manifest_save(title_id, &m);
+    manifest_free(&m);
+    return ok;
+}
+
+bool verify_record(const char* title_id) {
+    char* buf = iobuf_get(VERIFY_BUF_SIZE);
+    if (!buf) return false;
+    bool ok = record(title_id, buf, false);
+    iobuf_put(buf, VERIFY_BUF_SIZE);
+    if (!ok) log_debug("  [VERIFY] Could not write manifest for %s", title_id);
+    return ok;
+}
+
+// --- REPAIR ---
+// Re-copies the damaged files (indexes into m) from the title's source folder
+static int repair_files(const char* title_id, const struct Manifest* m, const uint32_t* damaged, int count) {
+    char source[MAX_PATH];
+    if (!install_read_tracker(title_id, source, sizeof(source))) {
+        log_debug("  [VERIFY] %s: no mount.lnk, cannot repair", title_id);
+        return 0;
+    }
+
+    int repaired = 0;
+    struct CopyReport rep = {0};
+    for (int i = 0; i < count; i++) {
+        const char* name = entry_name(m, &m->entries[damaged[i]]);
+        char src[MAX_PATH], dst[MAX_PATH];
+        int src_len = snprintf(src, sizeof(src), "%s/sce_sys/%s", source, name);
+        int dst_len = snprintf(dst, sizeof(dst), "/user/app/%s/sce_sys/%s", title_id, name);
+        if (src_len < 0 || (size_t)src_len >= sizeof(src) || dst_len < 0 || (size_t)dst_len >= sizeof(dst)) {
+            log_debug("  [VERIFY] %s: path of %s too long, not repaired", title_id, name);
+            continue;
+        }
+        struct stat st;
+        if (stat(src, &st) != 0) {
+            log_debug("  [VERIFY] %s: source %s unavailable, will retry", title_id, src);
+            continue;
+        }
+        // The damaged copy may still match size and mtime; never skip it
+        unlink(dst);
+        char* slash = strrchr(dst, '/');
+        *slash = '\0';
+        mkdir(dst, 0777);
+        *slash = '/';
+        if (copy_file_ex(src, dst, &rep) == 0) repaired++;
+    }
+    copy_log_report(title_id, &rep);
+    return repaired;
+}
+
+// --- VERIFIER ---
+// Returns false when the thread should stop
+static bool idle(long long us) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += us / 1000000;
+    deadline.tv_nsec += (us % 1000000) * 1000;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    pthread_mutex_lock(&wake_lock);
+    while (!stopping && pthread_cond_timedwait(&wake_cond, &wake_lock, &deadline) != ETIMEDOUT) { }
+    bool go_on = !stopping;
+    pthread_mutex_unlock(&wake_lock);
+    return go_on;
+}
+
+static bool should_stop(void) {
+    return __atomic_load_n(&stopping, __ATOMIC_ACQUIRE);
+}
+
+static void verify_title(const char* title_id, char* buf) {
+    // Still being copied; its manifest is recorded once the copy is done
+    if (assets_pending(title_id)) return;
+    struct Manifest m;
+    if (!manifest_load(title_id, &m)) {
+        // Installed before manifests existed: trust what is there now. No
+        // mount.lnk yet means an install is still copying; leave it alone.
+        char lnk_path[MAX_PATH];
+        snprintf(lnk_path, sizeof(lnk_path), "/user/app/%s/mount.lnk", title_id);
+        if (access(lnk_path, F_OK) == 0 && record(title_id, buf, true)) {
+            log_debug("[VERIFY] %s: recorded baseline manifest", title_id);
+        }
+        return;
+    }
+    int dir_fd = open_sce_sys(title_id);
+    if (dir_fd < 0) {
+        manifest_free(&m);
+        return;
+    }
+
+    uint32_t* damaged = NULL;
+    int damaged_count = 0;
+    bool refresh = false;
+    for (uint32_t i = 0; i < m.count && !should_stop(); i++) {
+        struct ManifestEntry* e = &m.entries[i];
+        const char* name = entry_name(&m, e);
+        struct stat st;
+        uint32_t crc = 0;
+        int64_t size = -1;
+        if (fstatat(dir_fd, name, &st, 0) == 0) size = st.st_size;
+        bool ok = size == e->size &&
+                  hash_file(dir_fd, name, buf, true, &crc, &size) && size == e->size && crc == e->crc;
+        stats_add(STAT_VERIFIED_FILES, 1);
+        if (ok) {
+            // Touched but identical: just remember the new mtime
+            if (mtime_ns(&st) != e->mtime) refresh = true;
+            continue;
+        }
+        log_debug("[VERIFY] %s: %s damaged (size %lld, expected %lld%s)", title_id, name,
+                  (long long)size, (long long)e->size, size == e->size ? ", checksum mismatch" : "");
+        stats_add(STAT_VERIFY_DAMAGED, 1);
+        if (!damaged) damaged = (uint32_t*)malloc(sizeof(*damaged) * m.count);
+        if (damaged) damaged[damaged_count++] = i;
+    }
+    close(dir_fd);
+
+    if (damaged_count > 0) {
+        int repaired = repair_files(title_id, &m, damaged, damaged_count);
+        stats_add(STAT_VERIFY_REPAIRS, (unsigned long long)repaired);
+        log_debug("[VERIFY] %s: repaired %d of %d file(s)", title_id, repaired, damaged_count);
+        if (repaired > 0) refresh = true;
+    }
+    free(damaged);
+    manifest_free(&m);
+    if (refresh && !should_stop()) record(title_id, buf, true);
+}
+
+static void* verifier_main(void* arg) {
+    (void)arg;
+    char* buf = iobuf_get(VERIFY_BUF_SIZE);
+    if (!buf) return NULL;
+    char title_id[MAX_TITLE_ID];
+    bool go_on = idle(VERIFY_START_DELAY_US);
+    while (go_on && !should_stop()) {
+        if (__atomic_load_n(&budget_kbps, __ATOMIC_RELAXED) == 0) {
+            if (!idle(VERIFY_TITLE_GAP_US * 5)) break;
+            continue;
+        }
+        struct WalkDir w;
+        if (!walk_open(&w, AT_FDCWD, "/user/app")) {
+            if (!idle(VERIFY_CYCLE_US)) break;
+            continue;
+        }
+        int checked = 0;
+        struct WalkEntry e;
+        while (!should_stop() && walk_next(&w, &e)) {
+            if (e.name[0] == '.' || e.type != DT_DIR || strlen(e.name) >= sizeof(title_id)) continue;
+            snprintf(title_id, sizeof(title_id), "%s", e.name);
+            verify_title(title_id, buf);
+            checked++;
+            if (!idle(VERIFY_TITLE_GAP_US)) break;
+        }
+        walk_close(&w);
+        log_trace("[VERIFY] Cycle done, %d title(s) checked", checked);
+        if (!idle(VERIFY_CYCLE_US)) break;
+    }
+    iobuf_put(buf, VERIFY_BUF_SIZE);
+    return NULL;
+}
+
+bool verify_start(void) {
+    if (running) return true;
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&wake_cond, &attr);
+    pthread_condattr_destroy(&attr);
+    mkdir(VERIFY_DIR, 0777);
+    __atomic_store_n(&stopping, false, __ATOMIC_RELEASE);
+    if (pthread_create(&verifier, NULL, verifier_main, NULL) != 0) {
+        pthread_cond_destroy(&wake_cond);
+        return false;
+    }
+    running = true;
+    return true;
+}
+
+void verify_shutdown(void) {
+    if (!running) return;
+    pthread_mutex_lock(&wake_lock);
+    __atomic_store_n(&stopping, true, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&wake_cond);
+    pthread_mutex_unlock(&wake_lock);
+    pthread_join(verifier, NULL);
+    pthread_cond_destroy(&wake_cond);
+    running = false;
+}
+
+// --- CONFIG ---
+void verify_reload_config(void) {
+    static time_t last_mtime = 0;
+    static bool had_file = false;
+    struct stat st;
+    if (stat(VERIFY_BUDGET_FILE, &st) != 0) {
+        if (had_file) __atomic_store_n(&budget_kbps, VERIFY_BUDGET_KBPS, __ATOMIC_RELAXED);
+        had_file = false;
+        return;
+    }
+    if (had_file && st.st_mtime == last_mtime) return;
+    had_file = true;
+    last_mtime = st.st_mtime;
+
+    char buf[16] = {0};
+    FILE* f = fopen(VERIFY_BUDGET_FILE, "r");
+    if (!f) return;
+    size_t n = fread(buf, 1, sizeof(buf) - 1, f);
+    fclose(f);
+    buf[n] = '\0';
+    int kbps = atoi(buf);
+    if (kbps < 0) kbps = 0;
+    __atomic_store_n(&budget_kbps, kbps, __ATOMIC_RELAXED);
+    log_debug("[VERIFY] I/O budget set to %d KB/s%s", kbps, kbps ? "" : " (verifier paused)");
+}
@@ -0,0 +1,34 @@
+#ifndef VERIFY_H
+#define VERIFY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// --- INTEGRITY MANIFESTS ---
+// Every installed title gets a manifest of its /user/app/<id>/sce_sys files
+// (size, mtime, CRC32C) when it is installed or repaired. A low-priority
+// thread re-checks one title at a time within an I/O budget, queues only
+// the damaged files and re-copies those from the title's source folder.
+
+#define VERIFY_DIR              "/data/shadowmount/manifests"
+#define VERIFY_BUDGET_FILE      "/data/shadowmount/verify_budget" // KB/s, 0 = off
+#define VERIFY_BUDGET_KBPS      2048
+#define VERIFY_MAGIC            0x4D56534Du  // "SMVM"
+#define VERIFY_VERSION          1
+#define VERIFY_BUF_SIZE         (256 * 1024)
+#define VERIFY_MAX_FILES        8192         // Files past it are left out, and logged
+#define VERIFY_START_DELAY_US   30000000     // Stay out of the way right after boot
+#define VERIFY_TITLE_GAP_US     2000000      // Pause between titles
+#define VERIFY_CYCLE_US         600000000    // Pause after checking every title
+
+// Writes the manifest of an installed title from its current sce_sys
+bool verify_record(const char* title_id);
+
+// Background verifier thread
+bool verify_start(void);
+void verify_shutdown(void);
+
+// Re-reads VERIFY_BUDGET_FILE when it changed
+void verify_reload_config(void);
+
+#endif
@@ -0,0 +1,135 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#include "shadowmount.h"
+#include "walk.h"
+
+static unsigned long stat_opens = 0;
+static unsigned long stat_reads = 0;
+static unsigned long stat_stats = 0;
+
+#define COUNT(x) __atomic_fetch_add(&(x), 1, __ATOMIC_RELAXED)
+
+#ifdef __linux__
+// Host builds: getdents64 has the same batch semantics as getdirentries
+struct linux_dirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+static ssize_t read_batch(struct WalkDir* w) {
+    return syscall(SYS_getdents64, w->fd, w->buf, WALK_BUF_SIZE);
+}
+
+static bool decode_entry(struct WalkDir* w, const char** name, unsigned char* type) {
+    struct linux_dirent64* d = (struct linux_dirent64*)(w->buf + w->pos);
+    w->pos += d->d_reclen;
+    *name = d->d_name;
+    *type = d->d_type;
+    return d->d_ino != 0;
+}
+#else
+static ssize_t read_batch(struct WalkDir* w) {
+    return getdirentries(w->fd, w->buf, WALK_BUF_SIZE, &w->base);
+}
+
+static bool decode_entry(struct WalkDir* w, const char** name, unsigned char* type) {
+    struct dirent* d = (struct dirent*)(w->buf + w->pos);
+    if (d->d_reclen == 0) { w->pos = w->len; return false; }
+    w->pos += d->d_reclen;
+    *name = d->d_name;
+    *type = d->d_type;
+    return d->d_fileno != 0;
+}
+#endif
+
+bool walk_open(struct WalkDir* w, int parent_fd, const char* path) {
+    memset(w, 0, sizeof(*w));
+    COUNT(stat_opens);
+    w->fd = openat(parent_fd, path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (w->fd < 0) return false;
+    w->buf = (char*)malloc(WALK_BUF_SIZE);
+    if (!w->buf) {
+        close(w->fd);
+        w->fd = -1;
+        return false;
+    }
+    return true;
+}
+
+// d_type of a resolved entry; stat() followed any link, so never DT_LNK
+static unsigned char type_of(mode_t mode) {
+    if (S_ISDIR(mode)) return DT_DIR;
+    if (S_ISREG(mode)) return DT_REG;
+    if (S_ISCHR(mode)) return DT_CHR;
+    if (S_ISBLK(mode)) return DT_BLK;
+    if (S_ISFIFO(mode)) return DT_FIFO;
+    return DT_SOCK;
+}
+
+bool walk_next(struct WalkDir* w, struct WalkEntry* out) {
+    while (true) {
+        if (w->pos >= w->len) {
+            if (w->eof) return false;
+            COUNT(stat_reads);
+            ssize_t n = read_batch(w);
+            if (n <= 0) {
+                w->eof = true;
+                return false;
+            }
+            w->len = (size_t)n;
+            w->pos = 0;
+        }
+
+        const char* name;
+        unsigned char type;
+        if (!decode_entry(w, &name, &type)) continue;
+        if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) continue;
+
+        out->name = name;
+        out->has_stat = false;
+        if (type == DT_UNKNOWN || type == DT_LNK) {
+            // exFAT and friends don't fill d_type; symlinks are followed like stat()
+            if (walk_stat(w->fd, name, &out->st) != 0) continue;
+            out->has_stat = true;
+            type = type_of(out->st.st_mode);
+        }
+        out->type = type;
+        return true;
+    }
+}
+
+void walk_close(struct WalkDir* w) {
+    if (w->fd >= 0) close(w->fd);
+    free(w->buf);
+    w->fd = -1;
+    w->buf = NULL;
+}
+
+int walk_stat(int dir_fd, const char* path, struct stat* st) {
+    COUNT(stat_stats);
+    return fstatat(dir_fd, path, st, 0);
+}
+
+void walk_get_stats(struct WalkStats* out) {
+    out->opens = __atomic_load_n(&stat_opens, __ATOMIC_RELAXED);
+    out->reads = __atomic_load_n(&stat_reads, __ATOMIC_RELAXED);
+    out->stats = __atomic_load_n(&stat_stats, __ATOMIC_RELAXED);
+}
+
+void walk_reset_stats(void) {
+    __atomic_store_n(&stat_opens, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&stat_reads, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&stat_stats, 0, __ATOMIC_RELAXED);
+}
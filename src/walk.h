@@ -0,0 +1,50 @@
+#ifndef WALK_H
+#define WALK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+// --- DIRECTORY WALKER ---
+// Reads directories through a dir fd in large getdirentries() batches and
+// trusts d_type. Only DT_UNKNOWN (exFAT/USB) and symlinks cost an fstatat().
+// Children are opened relative to their parent fd, never from "/" again.
+
+#define WALK_BUF_SIZE   (32 * 1024)
+
+struct WalkDir {
+    int fd;
+    char* buf;
+    size_t pos;
+    size_t len;
+    off_t base;
+    bool eof;
+};
+
+struct WalkEntry {
+    const char* name;
+    unsigned char type;    // DT_DIR, DT_REG, ... (resolved through stat(), never DT_UNKNOWN/DT_LNK)
+    bool has_stat;         // st is filled when type had to be resolved
+    struct stat st;
+};
+
+// parent_fd may be AT_FDCWD with an absolute path
+bool walk_open(struct WalkDir* w, int parent_fd, const char* path);
+bool walk_next(struct WalkDir* w, struct WalkEntry* out); // Skips "." and ".."
+void walk_close(struct WalkDir* w);
+
+// Counted fstatat() (follows symlinks like stat())
+int walk_stat(int dir_fd, const char* path, struct stat* st);
+
+// Syscall counters since the last reset (all threads)
+struct WalkStats {
+    unsigned long opens;
+    unsigned long reads;   // getdirentries/getdents batches
+    unsigned long stats;
+};
+void walk_get_stats(struct WalkStats* out);
+void walk_reset_stats(void);
+
+#endif
@@ -0,0 +1,473 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#else
+#include <sys/types.h>
+#include <sys/event.h>
+#endif
+
+#include "shadowmount.h"
+#include "watcher.h"
+#include "util.h"
+#include "arena.h"
+
+struct Watch {
+    int handle;            // kqueue: open dir fd, inotify: watch descriptor
+    int file_handle;       // kqueue: open param.json fd of a sce_sys watch, else -1
+    int depth;
+    enum watch_kind kind;
+    bool used;
+    bool files;            // sce_sys: writes to param.json count as changes
+    path_id path;
+};
+
+struct DirtyPath {
+    path_id path;
+    int depth;
+};
+
+static struct Watch watches[WATCH_MAX];
+static int watch_slots[WATCH_MAX * 2]; // path hash -> watch index + 1
+static struct DirtyPath queue[WATCH_QUEUE_MAX];
+static int queue_len = 0;
+static int backend_fd = -1;
+static bool overflow = false;
+// Scan workers add watches and queue retries while the main thread waits
+static pthread_mutex_t watch_lock = PTHREAD_MUTEX_INITIALIZER;
+static bool roots_changed = false;
+static watcher_gone_fn gone_handler = NULL;
+
+// --- WATCH TABLE ---
+static uint32_t path_hash(path_id path) {
+    return path * 0x9E3779B1u;
+}
+
+static int find_watch(path_id path) {
+    uint32_t n = WATCH_MAX * 2;
+    if (!path) return -1;
+    for (uint32_t s = path_hash(path) % n, i = 0; i < n; s = (s + 1) % n, i++) {
+        int w = watch_slots[s];
+        if (w == 0) return -1;
+        if (w > 0 && watches[w - 1].used && watches[w - 1].path == path) return w - 1;
+    }
+    return -1;
+}
+
+static void index_watch(int w) {
+    uint32_t n = WATCH_MAX * 2;
+    uint32_t s = path_hash(watches[w].path) % n;
+    while (watch_slots[s] > 0) s = (s + 1) % n;
+    watch_slots[s] = w + 1;
+}
+
+static void unindex_watch(int w) {
+    uint32_t n = WATCH_MAX * 2;
+    for (uint32_t s = path_hash(watches[w].path) % n, i = 0; i < n && watch_slots[s] != 0; s = (s + 1) % n, i++) {
+        if (watch_slots[s] == w + 1) { watch_slots[s] = -1; return; } // tombstone
+    }
+}
+
+static int find_watch_by_handle(int handle) {
+    for (int i = 0; i < WATCH_MAX; i++) {
+        if (watches[i].used && (watches[i].handle == handle || watches[i].file_handle == handle)) return i;
+    }
+    return -1;
+}
+
+// --- DIRTY QUEUE ---
+static void queue_push(path_id path, int depth) {
+    if (!path) {
+        overflow = true; // Out of memory for the path: rescan everything
+        return;
+    }
+    for (int i = 0; i < queue_len; i++) {
+        if (queue[i].path == path) {
+            if (depth < queue[i].depth) queue[i].depth = depth;
+            return;
+        }
+    }
+    if (queue_len == WATCH_QUEUE_MAX) {
+        overflow = true;
+        return;
+    }
+    queue[queue_len].path = path;
+    queue[queue_len].depth = depth;
+    queue_len++;
+}
+
+static void queue_parent(const struct Watch* w) {
+    if (w->kind != WATCH_SCAN) { roots_changed = true; return; }
+    if (w->depth == 0) { roots_changed = true; return; } // Scan root itself vanished
+    char parent[MAX_PATH];
+    if (!path_get(w->path, parent, sizeof(parent))) return;
+    char* slash = strrchr(parent, '/');
+    if (!slash || slash == parent) return;
+    *slash = '\0';
+    queue_push(path_intern(parent), w->depth - 1);
+}
+
+static void on_changed(int w) {
+    switch (watches[w].kind) {
+        case WATCH_SCAN:     queue_push(watches[w].path, watches[w].depth); break;
+        case WATCH_ANCESTOR: roots_changed = true; break;
+        case WATCH_CONTROL:  break; // Waking up is all that is needed
+    }
+}
+
+static void on_gone(const struct Watch* w, const char* name) {
+    if (!gone_handler || w->kind != WATCH_SCAN) return;
+    char path[MAX_PATH];
+    if (!path_get(w->path, path, sizeof(path))) return;
+    if (name) {
+        size_t len = strlen(path);
+        int n = snprintf(path + len, sizeof(path) - len, "/%s", name);
+        if (n < 0 || (size_t)n >= sizeof(path) - len) return;
+    }
+    gone_handler(path);
+}
+
+static void drop_watch(int w);
+
+// A param.json that is created empty and written afterwards (FTP uploads)
+// fails to parse on its create event; sce_sys watches also report the writes
+#define WATCH_FILE_NAME "param.json"
+
+static bool is_sce_sys(const char* path) {
+    const char* base = strrchr(path, '/');
+    return base && strcmp(base + 1, "sce_sys") == 0;
+}
+
+// --- BACKENDS ---
+#ifdef __linux__
+
+#define INOTIFY_MASK (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | \
+                      IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR)
+#define INOTIFY_FILE_MASK (IN_CLOSE_WRITE | IN_MODIFY)
+
+static int wake_pipe[2] = { -1, -1 };
+
+static int backend_init(void) {
+    if (wake_pipe[0] < 0) {
+        if (pipe(wake_pipe) != 0) return -1;
+        for (int i = 0; i < 2; i++) fcntl(wake_pipe[i], F_SETFL, O_NONBLOCK);
+    }
+    return inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+}
+
+static void backend_wake(void) {
+    char c = 0;
+    if (write(wake_pipe[1], &c, 1) < 0) { } // Full pipe: a wakeup is already pending
+}
+
+static bool backend_add(struct Watch* w, const char* path) {
+    w->handle = inotify_add_watch(backend_fd, path, INOTIFY_MASK | (w->files ? INOTIFY_FILE_MASK : 0));
+    return w->handle >= 0;
+}
+
+static void backend_remove(struct Watch* w) {
+    if (w->handle >= 0) inotify_rm_watch(backend_fd, w->handle);
+}
+
+static void backend_poll(int timeout_ms) {
+    struct pollfd pfd[2] = { { .fd = backend_fd, .events = POLLIN }, { .fd = wake_pipe[0], .events = POLLIN } };
+    if (poll(pfd, 2, timeout_ms) <= 0) return;
+    if (pfd[1].revents) {
+        char drain[64];
+        while (read(wake_pipe[0], drain, sizeof(drain)) > 0) { }
+    }
+
+    pthread_mutex_lock(&watch_lock);
+    char buf[16384] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t len;
+    while ((len = read(backend_fd, buf, sizeof(buf))) > 0) {
+        for (char* p = buf; p < buf + len; ) {
+            struct inotify_event* ev = (struct inotify_event*)p;
+            p += sizeof(struct inotify_event) + ev->len;
+            if (ev->mask & IN_Q_OVERFLOW) { overflow = true; continue; }
+            int w = find_watch_by_handle(ev->wd);
+            if (w < 0) continue;
+            if (ev->mask & IN_IGNORED) {
+                // Kernel already dropped the watch; forget it without rm_watch
+                watches[w].handle = -1;
+                drop_watch(w);
+            } else if (ev->mask & (IN_DELETE_SELF | IN_MOVE_SELF)) {
+                on_gone(&watches[w], NULL);
+                queue_parent(&watches[w]);
+                drop_watch(w);
+            } else if (ev->mask & INOTIFY_FILE_MASK) {
+                // Writes to the other sce_sys files cannot complete a game
+                if (ev->len && strcmp(ev->name, WATCH_FILE_NAME) == 0) on_changed(w);
+            } else {
+                // Game folders carry no watch of their own: their parent names them
+                if ((ev->mask & IN_ISDIR) && (ev->mask & (IN_DELETE | IN_MOVED_FROM)) && ev->len) {
+                    on_gone(&watches[w], ev->name);
+                }
+                on_changed(w);
+            }
+        }
+    }
+    pthread_mutex_unlock(&watch_lock);
+}
+
+#else
+
+#define KQ_VNODE_MASK (NOTE_WRITE | NOTE_EXTEND | NOTE_LINK | NOTE_DELETE | NOTE_RENAME | NOTE_REVOKE)
+#define KQ_FILE_MASK  (NOTE_WRITE | NOTE_EXTEND | NOTE_DELETE | NOTE_RENAME | NOTE_REVOKE)
+
+static int backend_init(void) {
+    int kq = kqueue();
+#ifdef EVFILT_FS
+    // Mount/unmount notifications: a USB drive showing up re-resolves missing roots
+    if (kq >= 0) {
+        struct kevent kev;
+        EV_SET(&kev, 0, EVFILT_FS, EV_ADD | EV_CLEAR, 0, 0, 0);
+        kevent(kq, &kev, 1, NULL, 0, NULL);
+    }
+#endif
+#ifdef EVFILT_USER
+    if (kq >= 0) {
+        struct kevent kev;
+        EV_SET(&kev, 0, EVFILT_USER, EV_ADD | EV_CLEAR, 0, 0, 0);
+        kevent(kq, &kev, 1, NULL, 0, NULL);
+    }
+#endif
+    return kq;
+}
+
+static void backend_wake(void) {
+#ifdef EVFILT_USER
+    struct kevent kev;
+    EV_SET(&kev, 0, EVFILT_USER, 0, NOTE_TRIGGER, 0, 0);
+    kevent(backend_fd, &kev, 1, NULL, 0, NULL);
+#endif
+}
+
+static int kq_add(const char* path, int flags, unsigned int mask) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC | flags);
+    if (fd < 0) return -1;
+    struct kevent kev;
+    EV_SET(&kev, fd, EVFILT_VNODE, EV_ADD | EV_CLEAR, mask, 0, 0);
+    if (kevent(backend_fd, &kev, 1, NULL, 0, NULL) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Directory knotes only see entries come and go: param.json gets its own,
+// opened once it exists
+static void watch_file(struct Watch* w) {
+    char path[MAX_PATH];
+    if (!path_get(w->path, path, sizeof(path))) return;
+    size_t len = strlen(path);
+    int n = snprintf(path + len, sizeof(path) - len, "/%s", WATCH_FILE_NAME);
+    if (n < 0 || (size_t)n >= sizeof(path) - len) return;
+    w->file_handle = kq_add(path, 0, KQ_FILE_MASK);
+}
+
+static bool backend_add(struct Watch* w, const char* path) {
+    w->handle = kq_add(path, O_DIRECTORY, KQ_VNODE_MASK);
+    if (w->handle < 0) return false;
+    if (w->files) watch_file(w);
+    return true;
+}
+
+static void backend_remove(struct Watch* w) {
+    // Closing the fd removes the knote
+    if (w->handle >= 0) close(w->handle);
+    if (w->file_handle >= 0) close(w->file_handle);
+}
+
+static void backend_poll(int timeout_ms) {
+    struct kevent evs[64];
+    struct timespec ts = { timeout_ms / 1000, (timeout_ms % 1000) * 1000000L };
+    int n = kevent(backend_fd, NULL, 0, evs, 64, timeout_ms < 0 ? NULL : &ts);
+    pthread_mutex_lock(&watch_lock);
+    for (int i = 0; i < n; i++) {
+#ifdef EVFILT_FS
+        if (evs[i].filter == EVFILT_FS) { roots_changed = true; continue; }
+#endif
+#ifdef EVFILT_USER
+        if (evs[i].filter == EVFILT_USER) continue; // watcher_wake()
+#endif
+        int w = find_watch_by_handle((int)evs[i].ident);
+        if (w < 0) continue;
+        if (watches[w].file_handle == (int)evs[i].ident) {
+            // param.json written, or replaced: follow the new file
+            if (evs[i].fflags & (NOTE_DELETE | NOTE_RENAME | NOTE_REVOKE)) {
+                close(watches[w].file_handle);
+                watch_file(&watches[w]);
+            }
+            on_changed(w);
+        } else if (evs[i].fflags & (NOTE_DELETE | NOTE_RENAME | NOTE_REVOKE)) {
+            on_gone(&watches[w], NULL);
+            queue_parent(&watches[w]);
+            drop_watch(w);
+        } else {
+            // param.json may have just been created
+            if (watches[w].files && watches[w].file_handle < 0) watch_file(&watches[w]);
+            on_changed(w);
+        }
+    }
+    pthread_mutex_unlock(&watch_lock);
+}
+
+#endif
+
+static void drop_watch(int w) {
+    backend_remove(&watches[w]);
+    unindex_watch(w);
+    watches[w].used = false;
+}
+
+// --- PUBLIC API ---
+bool watcher_init(void) {
+    memset(watches, 0, sizeof(watches));
+    memset(watch_slots, 0, sizeof(watch_slots));
+    queue_len = 0;
+    backend_fd = backend_init();
+    if (backend_fd < 0) {
+        log_debug("[WATCH] Backend unavailable (%s), falling back to polling", strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+void watcher_set_gone_handler(watcher_gone_fn fn) {
+    pthread_mutex_lock(&watch_lock);
+    gone_handler = fn;
+    pthread_mutex_unlock(&watch_lock);
+}
+
+bool watcher_active(void) {
+    return backend_fd >= 0;
+}
+
+void watcher_shutdown(void) {
+    if (backend_fd < 0) return;
+    for (int i = 0; i < WATCH_MAX; i++) {
+        if (watches[i].used) drop_watch(i);
+    }
+    close(backend_fd);
+    backend_fd = -1;
+}
+
+static bool add_watch_locked(const char* path, int depth, enum watch_kind kind);
+
+bool watcher_add(const char* path, int depth, enum watch_kind kind) {
+    if (backend_fd < 0) return false;
+    pthread_mutex_lock(&watch_lock);
+    bool ok = add_watch_locked(path, depth, kind);
+    pthread_mutex_unlock(&watch_lock);
+    return ok;
+}
+
+static bool add_watch_locked(const char* path, int depth, enum watch_kind kind) {
+    path_id id = path_intern(path);
+    if (!id) return false;
+    int existing = find_watch(id);
+    if (existing >= 0) {
+        watches[existing].depth = depth;
+        watches[existing].kind = kind;
+        return true;
+    }
+
+    int w = -1;
+    for (int i = 0; i < WATCH_MAX; i++) {
+        if (!watches[i].used) { w = i; break; }
+    }
+    if (w < 0) {
+        // Out of watch slots: the safety-net scan still covers this directory
+        static bool warned = false;
+        if (!warned) log_debug("[WATCH] Watch table full (%d), relying on safety scan", WATCH_MAX);
+        warned = true;
+        return false;
+    }
+
+    watches[w].path = id;
+    watches[w].file_handle = -1;
+    watches[w].files = kind == WATCH_SCAN && is_sce_sys(path);
+    if (!backend_add(&watches[w], path)) return false;
+    watches[w].depth = depth;
+    watches[w].kind = kind;
+    watches[w].used = true;
+    index_watch(w);
+    return true;
+}
+
+void watcher_remove_tree(const char* path) {
+    if (backend_fd < 0) return;
+    pthread_mutex_lock(&watch_lock);
+    path_id root = path_find(path);
+    for (int i = 0; root && i < WATCH_MAX; i++) {
+        if (!watches[i].used || !path_is_under(watches[i].path, root)) continue;
+        // A dropped scan root gets its ancestor watch back on the next refresh
+        if (watches[i].kind == WATCH_SCAN && watches[i].depth == 0) roots_changed = true;
+        drop_watch(i);
+    }
+    pthread_mutex_unlock(&watch_lock);
+}
+
+int watcher_wait(int timeout_ms) {
+    if (backend_fd < 0) return 0;
+
+    // Paths queued meanwhile (scan workers, watcher_queue()) are ready now
+    pthread_mutex_lock(&watch_lock);
+    if (queue_len > 0) timeout_ms = 0;
+    pthread_mutex_unlock(&watch_lock);
+
+    backend_poll(timeout_ms);
+    pthread_mutex_lock(&watch_lock);
+    int ready = queue_len;
+    pthread_mutex_unlock(&watch_lock);
+    return ready;
+}
+
+bool watcher_pop(char* out_path, size_t out_size, int* out_depth) {
+    bool found = false;
+    pthread_mutex_lock(&watch_lock);
+    while (queue_len > 0 && !found) {
+        found = path_get(queue[0].path, out_path, out_size);
+        if (out_depth) *out_depth = queue[0].depth;
+        queue[0] = queue[--queue_len];
+    }
+    pthread_mutex_unlock(&watch_lock);
+    return found;
+}
+
+void watcher_queue(const char* path, int depth) {
+    if (backend_fd < 0) return;
+    pthread_mutex_lock(&watch_lock);
+    queue_push(path_intern(path), depth);
+    pthread_mutex_unlock(&watch_lock);
+}
+
+void watcher_wake(void) {
+    if (backend_fd >= 0) backend_wake();
+}
+
+bool watcher_take_overflow(void) {
+    pthread_mutex_lock(&watch_lock);
+    bool v = overflow;
+    overflow = false;
+    pthread_mutex_unlock(&watch_lock);
+    return v;
+}
+
+bool watcher_take_roots_changed(void) {
+    pthread_mutex_lock(&watch_lock);
+    bool v = roots_changed;
+    roots_changed = false;
+    pthread_mutex_unlock(&watch_lock);
+    return v;
+}
@@ -0,0 +1,54 @@
+#ifndef WATCHER_H
+#define WATCHER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// --- WATCHER ---
+// Change notifications for the scan tree: kqueue EVFILT_VNODE on the console,
+// inotify on Linux hosts. Directories that change are pushed onto a dirty
+// queue so the daemon rescans only the affected subtree.
+
+#define WATCH_MAX               1024
+#define WATCH_QUEUE_MAX         256
+#define SAFETY_SCAN_INTERVAL_US 60000000  // Full rescan safety net while watching
+
+enum watch_kind {
+    WATCH_SCAN,     // Directory the scanner descends into
+    WATCH_ANCESTOR, // Nearest existing parent of a missing scan root
+    WATCH_CONTROL   // LOG_DIR, only used to notice KILL_FILE promptly
+};
+
+// Called with the path of a scanned folder that was deleted or renamed away
+// (inotify also names the subfolders of a watched one; kqueue only reports
+// watched folders themselves). Runs on the waiting thread, must not block.
+typedef void (*watcher_gone_fn)(const char* path);
+
+bool watcher_init(void);
+void watcher_set_gone_handler(watcher_gone_fn fn);
+bool watcher_active(void);
+void watcher_shutdown(void);
+
+// Registers a watch (no-op if the path is already watched)
+bool watcher_add(const char* path, int depth, enum watch_kind kind);
+
+// Drops the watch on path and on everything below it (path itself need
+// not be watched: a drive's folder drops the watches on all its roots)
+void watcher_remove_tree(const char* path);
+
+// Blocks until something changed or timeout_ms elapsed (-1 = forever).
+// Returns the number of dirty paths ready to pop.
+int watcher_wait(int timeout_ms);
+bool watcher_pop(char* out_path, size_t out_size, int* out_depth);
+
+// Queue path for an immediate rescan
+void watcher_queue(const char* path, int depth);
+
+// Makes a pending (or the next) watcher_wait() return right away
+void watcher_wake(void);
+
+// One-shot flags raised by watcher_wait()
+bool watcher_take_overflow(void);      // Queue/watch table overflowed: do a full scan
+bool watcher_take_roots_changed(void); // A missing root may have appeared
+
+#endif